@@ -1,11 +1,28 @@
 #pragma once
 
 #include <chrono>
+#include <string>
 
 #include "world.h"
 #include "ivr_engine.h"
 #include "input_manager.h"
 
+//options that can be set from the command line
+struct IVRAppOptions {
+	IVREngineConfig EngineConfig;
+
+	//headless runs have no window to close, so they stop after this many frames
+	uint32_t HeadlessFrameCount = 1000;
+	//if set (and headless), the last rendered frame is read back and written to this ppm file
+	std::string ReadbackPath;
+	//if set, profiling is enabled and a chrome://tracing / Perfetto trace is written to this json file on exit
+	std::string TracePath;
+	//threads preparing models and decoding textures while the scene loads, 0 uses one per hardware thread
+	uint32_t LoadingThreadCount = 0;
+
+	static IVRAppOptions ParseCommandLine(int argc, char** argv);
+};
+
 class IVRApp {
 private:
 
@@ -13,13 +30,17 @@ private:
 	std::shared_ptr<IVREngine> Engine_;
 	std::shared_ptr<IVRInputManager> InputManager_;
 
+	IVRAppOptions Options_;
+
 	std::chrono::high_resolution_clock::time_point CurrentTime_;
 	std::chrono::high_resolution_clock::time_point PreviousTime_;
 	float FrameTime_;
 
+	bool ShouldKeepRunning(uint32_t frames_rendered);
+
 public:
 
-	IVRApp();
+	IVRApp(IVRAppOptions options = IVRAppOptions());
 	~IVRApp() {};
 	void Mainloop();
-};
\ No newline at end of file
+};
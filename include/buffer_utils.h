@@ -1,27 +1,42 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <iostream>
+#include <vector>
 
 #include "singlecommand_utils.h"
+#include "memory_allocator.h"
 
 class IVRBufferUtilities {
 public:
+    //the memory of the buffer is sub-allocated from the allocator's blocks, host visible buffers come back mapped (buffer_allocation.MappedData)
+    //category : what the memory is accounted under in the allocator's stats
+    //with two or more queue_families the buffer is shared between them (concurrent), otherwise it is owned by one queue family at a time
     static void Spawn(
-        VkDevice logical_device,
-        VkPhysicalDevice physical_device,
+        std::shared_ptr<IVRMemoryAllocator> allocator,
         VkDeviceSize size,
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
+        IVRMemoryCategory category,
         VkBuffer& buffer,
-        VkDeviceMemory& buffer_memory
+        IVRAllocation& buffer_allocation,
+        IVRAllocationStrategy strategy = IVRAllocationStrategy::Buddy,
+        const std::vector<uint32_t>& queue_families = {}
     )
     {
+        VkDevice logical_device = allocator->GetLogicalDevice();
+
         VkBufferCreateInfo buffer_info{};
         buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         buffer_info.size = size; //size of the buffer in bytes
         buffer_info.usage = usage; //purpose of this buffer (it is possible to specify multiple usage with bitwise OR)
         buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE; //like swapchain images, buffers can also be owned by a specific queue family or shared between multiple
         //this buffer will only be used by the graphics queue, so it is kept exclusive
+        if (queue_families.size() > 1)
+        {
+            buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            buffer_info.queueFamilyIndexCount = static_cast<uint32_t>(queue_families.size());
+            buffer_info.pQueueFamilyIndices = queue_families.data();
+        }
 
         if (vkCreateBuffer(logical_device, &buffer_info, nullptr, &buffer) != VK_SUCCESS)
         {
@@ -31,61 +46,14 @@ public:
         VkMemoryRequirements memory_requirements;
         vkGetBufferMemoryRequirements(logical_device, buffer, &memory_requirements);
 
-        VkMemoryAllocateInfo alloc_info{};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = memory_requirements.size;
-        alloc_info.memoryTypeIndex = FindMemoryType(physical_device, memory_requirements.memoryTypeBits, properties);
-
-        if(vkAllocateMemory(logical_device, &alloc_info, nullptr, &buffer_memory) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to allocate buffer memory!");
-        }
-
-        vkBindBufferMemory(logical_device, buffer, buffer_memory, 0);
+        buffer_allocation = allocator->Allocate(memory_requirements, properties, category, strategy, false);
+        vkBindBufferMemory(logical_device, buffer, buffer_allocation.Memory, buffer_allocation.Offset);
     }
 
-    static uint32_t FindMemoryType(
-        VkPhysicalDevice physical_device,
-        uint32_t type_filter, 
-        VkMemoryPropertyFlags properties)
+    static void Destroy(std::shared_ptr<IVRMemoryAllocator> allocator, VkBuffer buffer, IVRAllocation& buffer_allocation)
     {
-        //graphic cards can offer different types of memory to allocate from
-        //each memory varies in terms of allowed operations and performance characteristics
-        //we need to find the right type of memory to use
-
-        VkPhysicalDeviceMemoryProperties memory_properties;
-        vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
-
-        //memory_properties has two arrays : memoryTypes and memoryHeaps
-        // memoryHeaps are distinct memory resources like dedicated VRAM and swap space in RAM (if VRAM runs out)
-        // right now we are only concerned with memoryType and not the heap where it comes from
-
-        for(uint32_t i = 0; i < memory_properties.memoryTypeCount; i++)
-        {
-            //dont completely understand this if statement yet
-            if((type_filter & (1 << i)) && 
-            (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
-            {
-                return i;
-            }
-        }
-
-        return 0;
+        vkDestroyBuffer(allocator->GetLogicalDevice(), buffer, nullptr);
+        allocator->Free(buffer_allocation);
     }
 
-    static void TransferBufferData(VkDevice logical_device, VkPhysicalDevice physical_device, uint32_t queue_family_index,
-                                    VkQueue queue, VkBuffer& src_buffer, VkBuffer& dst_buffer, VkDeviceSize buffer_size)
-    {
-        VkCommandPool command_pool = IVRSingleCommandUtil::CreateCommandPool(logical_device, queue_family_index);
-        VkCommandBuffer command_buffer = IVRSingleCommandUtil::BeginSingleTimeCommands(logical_device, command_pool);
-
-        VkBufferCopy copy_region{};
-        copy_region.srcOffset = 0;
-        copy_region.dstOffset = 0;
-        copy_region.size = buffer_size;
-        vkCmdCopyBuffer(command_buffer, src_buffer, dst_buffer, 1, &copy_region);
-
-        IVRSingleCommandUtil::SubmitAndEndSingleTimeCommands(logical_device, queue, command_buffer, command_pool);
-    }   
-
 };
\ No newline at end of file
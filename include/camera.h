@@ -36,11 +36,15 @@ public:
     float CameraMoveSpeed = 10.0f;
     float CameraTurnSpeed = 2.0f;
 
+    //when disabled MoveCamera ignores the mouse and keyboard, the camera is then only moved through SetPosition/LookAt
+    bool IsInputEnabled = true;
+
 
     glm::mat4 GetViewMatrix();
     glm::mat4 GetProjectionMatrix();
     
     void SetPosition(glm::vec3 position);
+    void LookAt(glm::vec3 position, glm::vec3 target);
 
     void MoveCamera(float dt);
 
@@ -0,0 +1,34 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+
+struct IVRCameraPathPoint
+{
+	glm::vec3 Position;
+	glm::vec3 Target; //the point the camera looks at when it is at Position
+};
+
+//A closed catmull-rom spline through a list of camera positions and look at targets
+//Used to drive the camera deterministically (benchmarks) instead of through mouse and keyboard input
+class IVRCameraPath
+{
+private:
+	std::vector<IVRCameraPathPoint> Points_;
+
+	static glm::vec3 CatmullRom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float t);
+
+public:
+	IVRCameraPath(std::vector<IVRCameraPathPoint> points);
+
+	//json file containing an array of { "position" : [x, y, z], "target" : [x, y, z] }
+	static IVRCameraPath LoadFromJson(const std::string& file_path);
+	//a circle around center at the given radius and height, always looking at center
+	static IVRCameraPath CreateOrbit(glm::vec3 center, float radius, float height, uint32_t point_count);
+
+	//t in [0, 1] covers the whole loop once
+	IVRCameraPathPoint Evaluate(float t);
+};
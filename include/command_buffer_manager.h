@@ -1,6 +1,7 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include <memory>
+#include <vector>
 
 #include "pipeline_manager.h"
 #include "device_setup.h"
@@ -12,25 +13,46 @@ class IVRCBManager
 {
 private:
 
-    VkCommandPool CommandPool_;
-    VkCommandBuffer CommandBuffer_;
+    //one pool and one command buffer per frame in flight, so a frame can be re-recorded while the previous one is still executing
+    std::vector<VkCommandPool> CommandPools_;
+    std::vector<VkCommandBuffer> CommandBuffers_;
+    uint32_t FramesInFlight_;
+
+    //secondary command buffers for multithreaded recording, one pool per frame in flight per recording thread
+    //indexed as [frame_index][thread_index]. A thread only ever touches its own pool, so no locking is needed
+    std::vector<std::vector<VkCommandPool>> SecondaryCommandPools_;
+    std::vector<std::vector<std::vector<VkCommandBuffer>>> SecondaryCommandBuffers_;
+    std::vector<std::vector<uint32_t>> UsedSecondaryCommandBufferCounts_;
 
     std::shared_ptr<IVRDeviceManager> DeviceManager_;
 
 public:
 
-    IVRCBManager(std::shared_ptr<IVRDeviceManager> device_manager);
+    IVRCBManager(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight);
+    ~IVRCBManager();
 
-    void CreateCommandPool();
-    void DestroyCommandPool();
-    void CreateCommandBuffer();
+    void CreateCommandPools();
+    void DestroyCommandPools();
+    void CreateCommandBuffers();
 
     //void RecordCommandBuffer(VkCommandBuffer command_buffer, uint32_t image_index, 
     //                        VkRenderPass renderpass, std::shared_ptr<IVRSwapchainManager> swapchain_manager,
     //                        VkPipeline graphics_pipeline, std::shared_ptr<IVRModel> model);
 
-    void StartCommandBuffer();
-    void EndCommandBuffer();
-
-    VkCommandBuffer GetCommandBuffer() { return CommandBuffer_; }
+    void ResetCommandBuffer(uint32_t frame_index);
+    void StartCommandBuffer(uint32_t frame_index);
+    void EndCommandBuffer(uint32_t frame_index);
+
+    VkCommandBuffer GetCommandBuffer(uint32_t frame_index) { return CommandBuffers_[frame_index]; }
+
+    void CreateSecondaryCommandPools(uint32_t thread_count);
+    void DestroySecondaryCommandPools();
+    //resets every secondary pool of this frame, only safe once the in flight fence of this frame has been waited on
+    void ResetSecondaryCommandPools(uint32_t frame_index);
+    //returns a secondary command buffer that is recording and continues the given renderpass (subpass 0)
+    //must only be called from the recording thread with the given thread index
+    //framebuffer can be VK_NULL_HANDLE if the buffer will be executed with several framebuffers
+    //is_reused : the buffer will be executed again in later frames instead of being re-recorded
+    VkCommandBuffer BeginSecondaryCommandBuffer(uint32_t frame_index, uint32_t thread_index, VkRenderPass renderpass, VkFramebuffer framebuffer, bool is_reused);
+    void EndSecondaryCommandBuffer(VkCommandBuffer command_buffer);
 };
\ No newline at end of file
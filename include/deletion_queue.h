@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+#include "buffer_utils.h"
+#include "image_utils.h"
+#include "memory_allocator.h"
+#include "debug_logger_utils.h"
+
+//Defers the destruction of gpu resources until the gpu has finished every frame that may reference them.
+//A released resource is tagged with the number of the frame that is being recorded (submitted frames + 1), frames before it may
+//already reference it and so may the frame being recorded. The engine reports every submission and, once it knows a frame has
+//finished (its fence or the frame timeline semaphore), collects the resources of every frame up to it.
+//Releasing a resource does not re-record cached command buffers : whatever drew with it must be changed (and the world's
+//structure marked as changed) before the frame it was released in is submitted.
+//Release functions are thread safe, Collect and SetSubmittedFrameCount are called by the engine on the thread that submits frames.
+class IVRDeletionQueue
+{
+private:
+
+	struct Entry
+	{
+		uint64_t FrameValue; //destroyed once this many frames have finished
+		std::function<void()> Destroy;
+	};
+
+	VkDevice LogicalDevice_;
+	std::shared_ptr<IVRMemoryAllocator> Allocator_;
+
+	std::mutex Mutex_;
+	std::deque<Entry> Entries_; //in release order, so frame values never decrease from front to back
+	uint64_t SubmittedFrameCount_;
+	uint64_t DestroyedCount_; //since creation, for the stats
+
+public:
+
+	IVRDeletionQueue(VkDevice logical_device, std::shared_ptr<IVRMemoryAllocator> allocator);
+	//destroys everything still queued, the device must be idle
+	~IVRDeletionQueue();
+
+	//destroy runs once the gpu is done with the frames recorded so far, it must not release into this queue itself
+	void Release(std::function<void()> destroy);
+
+	void ReleaseBuffer(VkBuffer buffer, const IVRAllocation& allocation);
+	void ReleaseImage(VkImage image, const IVRAllocation& allocation);
+	void ReleaseImageView(VkImageView image_view);
+	void ReleaseSampler(VkSampler sampler);
+	void ReleasePipeline(VkPipeline pipeline);
+	void ReleasePipelineLayout(VkPipelineLayout pipeline_layout);
+	//the pool has to be created with VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+	void ReleaseDescriptorSets(VkDescriptorPool descriptor_pool, const std::vector<VkDescriptorSet>& descriptor_sets);
+
+	//called after every frame submission with the number of frames submitted so far
+	void SetSubmittedFrameCount(uint64_t submitted_frame_count);
+	//destroys the resources released while recording frames 1 to completed_frame_count (counting from 1), which the gpu has finished
+	void Collect(uint64_t completed_frame_count);
+	//destroys everything regardless of the frames, the device must be idle (shutdown, scene switches after vkDeviceWaitIdle)
+	void DestroyAll();
+
+	size_t GetPendingCount();
+
+	void LogStats();
+};
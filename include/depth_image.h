@@ -13,9 +13,10 @@ class IVRDepthImage{
 
 private:
     VkImage DepthImage_;
-    VkDeviceMemory DepthImageMemory_;
+    IVRAllocation DepthImageAllocation_;
     VkImageView DepthImageView_;
     VkExtent2D DepthImageExtent_;
+    IVRMemoryCategory Category_;
     std::shared_ptr<IVRDeviceManager> DeviceManager_;
 
     VkFormat FindSupportedFormat_(const std::vector<VkFormat>& candidates,
@@ -23,7 +24,9 @@ private:
 
 public:
 
-    IVRDepthImage(std::shared_ptr<IVRDeviceManager> device_manager, VkExtent2D depth_image_extent);
+    //category : DepthBuffer for the main pass, ShadowMap for the shadow pass
+    IVRDepthImage(std::shared_ptr<IVRDeviceManager> device_manager, VkExtent2D depth_image_extent,
+        IVRMemoryCategory category = IVRMemoryCategory::DepthBuffer);
 
     void CreateDepthResources();
         
@@ -5,6 +5,7 @@
 #include <memory>
 
 #include "device_setup.h"
+#include "deletion_queue.h"
 
 
 struct IVRDescriptorSetInfo {
@@ -36,9 +37,13 @@ private:
 
 public:
 	IVRDescriptorManager(std::shared_ptr<IVRDeviceManager> device_manager);
+	//the pool goes through the deletion queue too, behind the sets released from it (whoever holds its sets also holds this manager)
+	~IVRDescriptorManager();
 
 	VkDescriptorSetLayout CreateDescriptorSetLayout(IVRDescriptorSetInfo& descriptor_set_info);
 	void CreateDescriptorPool(std::vector<VkDescriptorPoolSize>& descriptor_pool_sizes, uint32_t max_sets);
 	VkDescriptorSet CreateDescriptorSet(VkDescriptorSetLayout descriptor_set_layout);
+	//the sets go back to the pool once the frames in flight no longer bind them
+	void ReleaseDescriptorSets(const std::vector<VkDescriptorSet>& descriptor_sets);
 
 };
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <vector>
 #include <set>
 #include <stdexcept>
+#include <memory>
 
 struct QueueFamilyIndices 
 {
@@ -12,14 +13,25 @@ struct QueueFamilyIndices
     uint32_t presentFamily = 0;
     bool isPresentFamilyIndexSet = false;
 
+    //a family with transfer support but no graphics support (usually backed by the gpu's copy engines)
+    //equal to graphicsFamily when the device has no such family
+    uint32_t transferFamily = 0;
+    bool isDedicatedTransferFamily = false;
+
     bool isComplete()
     {
         return isGraphicsFamilyIndexSet && isPresentFamilyIndexSet;
     }
 };
 
+//when surface is VK_NULL_HANDLE (headless) there is nothing to present to, and the graphics family doubles as the present family
 QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
 
+class IVRUploadManager;
+class IVRMemoryAllocator;
+class IVRStagingRing;
+class IVRDeletionQueue;
+
 /**
  * @brief respoinsible for creating the logical and physical devices
  * 
@@ -27,7 +39,7 @@ QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surfa
 class IVRDeviceManager {
 
 private:
-    const std::vector<const char*> DeviceExtensions_ = {
+    std::vector<const char*> DeviceExtensions_ = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
     }; //the above macro simply gets converted to "VK_KHR_swapchain"
     //the reason for using the macro is so that compiler can catch error in case there is a mispelling
@@ -37,17 +49,33 @@ private:
 
     VkQueue GraphicsQueue_;
     VkQueue PresentQueue_;
+    VkQueue TransferQueue_; //same as GraphicsQueue_ without a dedicated transfer family
+
+    std::shared_ptr<IVRMemoryAllocator> MemoryAllocator_;
+    std::shared_ptr<IVRStagingRing> StagingRing_;
+    const VkDeviceSize StagingRingSize_ = 32ull * 1024 * 1024;
+    std::shared_ptr<IVRUploadManager> UploadManager_;
+    std::shared_ptr<IVRDeletionQueue> DeletionQueue_;
+
+    bool IsHeadless_ = false;
+    bool IsTimelineSemaphoreEnabled_ = false;
+    bool IsMemoryBudgetEnabled_ = false; //VK_EXT_memory_budget, optional, lets the memory allocator read the heap budgets
 
     QueueFamilyIndices PickedPhysicalDeviceQueueFamilyIndices_;
 
     bool IsDeviceSuitable_(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
     
     bool CheckDeviceExtensionSupport_(VkPhysicalDevice physical_device);
+    bool IsDeviceExtensionAvailable_(VkPhysicalDevice physical_device, const char* extension_name);
 
 public:
     IVRDeviceManager();
     ~IVRDeviceManager();
 
+    //headless devices do not need the swapchain extension, must be called before picking the physical device
+    void EnableHeadlessMode();
+    bool IsHeadless();
+
     void PickPhysicalDevice(VkSurfaceKHR surface, VkInstance instance);
     void CreateLogicalDevice(VkSurfaceKHR surface);
 
@@ -56,7 +84,23 @@ public:
 
     VkQueue GetGraphicsQueue();
     VkQueue GetPresentQueue();
+    VkQueue GetTransferQueue();
+
+    //created together with the logical device, all buffer and image memory comes from it
+    std::shared_ptr<IVRMemoryAllocator> GetMemoryAllocator();
+
+    //created together with the logical device, the staging memory of every upload comes from it
+    std::shared_ptr<IVRStagingRing> GetStagingRing();
+
+    //created together with the logical device, all buffer and image uploads go through it
+    std::shared_ptr<IVRUploadManager> GetUploadManager();
+
+    //created together with the logical device, resources that frames may still be using are released into it instead of being destroyed
+    std::shared_ptr<IVRDeletionQueue> GetDeletionQueue();
 
     QueueFamilyIndices GetDeviceQueueFamilies();
 
+    //only valid after the logical device has been created
+    bool IsTimelineSemaphoreEnabled();
+
 };
\ No newline at end of file
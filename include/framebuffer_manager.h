@@ -1,9 +1,10 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <vector>
+#include <array>
 
 #include "device_setup.h"
-#include "swapchain_manager.h"
 #include "depth_image.h"
 #include "debug_logger_utils.h"
 
@@ -12,7 +13,9 @@ class IVRFramebufferManager
 private:
 
 	std::shared_ptr<IVRDeviceManager> DeviceManager_;
-	std::shared_ptr<IVRSwapchainManager> SwapchainManager_;
+	//one framebuffer per color image view (swapchain images when windowed, offscreen images when headless)
+	std::vector<VkImageView> ColorImageViews_;
+	VkExtent2D Extent_;
 	std::shared_ptr<IVRDepthImage> DepthImage_;
 	VkRenderPass Renderpass_;
 
@@ -21,7 +24,7 @@ private:
 public:
 
 	IVRFramebufferManager(std::shared_ptr<IVRDeviceManager> device_manager, VkRenderPass renderpass,
-							std::shared_ptr<IVRSwapchainManager> swapchain_manager,	std::shared_ptr<IVRDepthImage> depth_image);
+							std::vector<VkImageView> color_image_views, VkExtent2D extent, std::shared_ptr<IVRDepthImage> depth_image);
 	~IVRFramebufferManager();
 
 	void CreateFramebuffers();
@@ -30,29 +30,6 @@ public:
 		}
 	}
 
-	static void CopyBufferToImage(VkDevice logical_device, uint32_t queue_family_index, VkQueue queue, uint32_t layer_count, VkBuffer src_buffer, VkImage image, uint32_t width, uint32_t height)
-	{
-		VkCommandPool command_pool = IVRSingleCommandUtil::CreateCommandPool(logical_device, queue_family_index);
-		VkCommandBuffer command_buffer = IVRSingleCommandUtil::BeginSingleTimeCommands(logical_device, command_pool);
-
-		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = layer_count;
-
-		region.imageOffset = { 0,0,0 };
-		region.imageExtent = { width, height, 1 };
-
-		vkCmdCopyBufferToImage(command_buffer, src_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-		IVRSingleCommandUtil::SubmitAndEndSingleTimeCommands(logical_device, queue, command_buffer, command_pool);
-	}
-
 	static void TransitionImageLayout(VkDevice logical_device, uint32_t queue_family_index, VkQueue queue,
 		VkImage image, VkFormat format, uint32_t layer_count, VkImageLayout old_layout, VkImageLayout new_layout)
 	{
@@ -160,11 +137,13 @@ public:
         IVRSingleCommandUtil::SubmitAndEndSingleTimeCommands(logical_device, queue, command_buffer, command_pool);
 	}
 
-    static void CreateImageAndBindMemory(VkDevice logical_device, VkPhysicalDevice physical_device,
+    static void CreateImageAndBindMemory(std::shared_ptr<IVRMemoryAllocator> allocator,
         uint32_t width, uint32_t height, VkFormat format, uint32_t array_layers,
         VkImageTiling tiling, VkImageCreateFlags image_create_flags, VkImageUsageFlags usage, VkMemoryPropertyFlags memory_property_flags,
-        VkImage& image, VkDeviceMemory& image_memory)
+        IVRMemoryCategory category, VkImage& image, IVRAllocation& image_allocation)
     {
+        VkDevice logical_device = allocator->GetLogicalDevice();
+
         VkImageCreateInfo image_info{};
         image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         image_info.imageType = VK_IMAGE_TYPE_2D;
@@ -201,18 +180,16 @@ public:
         VkMemoryRequirements memory_requirements;
         vkGetImageMemoryRequirements(logical_device, image, &memory_requirements);
 
-        VkMemoryAllocateInfo alloc_info{};
-        alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize = memory_requirements.size;
-        alloc_info.memoryTypeIndex = IVRBufferUtilities::FindMemoryType(physical_device,
-            memory_requirements.memoryTypeBits, memory_property_flags);
-
-        if (vkAllocateMemory(logical_device, &alloc_info, nullptr, &image_memory) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to allocate image memory");
-        }
+        //optimal tiling images must not share a bufferImageGranularity page with buffers, the allocator keeps them apart
+        image_allocation = allocator->Allocate(memory_requirements, memory_property_flags, category, IVRAllocationStrategy::Buddy,
+            tiling == VK_IMAGE_TILING_OPTIMAL);
+        vkBindImageMemory(logical_device, image, image_allocation.Memory, image_allocation.Offset);
+    }
 
-        vkBindImageMemory(logical_device, image, image_memory, 0);
+    static void DestroyImage(std::shared_ptr<IVRMemoryAllocator> allocator, VkImage image, IVRAllocation& image_allocation)
+    {
+        vkDestroyImage(allocator->GetLogicalDevice(), image, nullptr);
+        allocator->Free(image_allocation);
     }
 
     static bool HasStencilComponent(VkFormat format)
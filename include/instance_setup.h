@@ -13,6 +13,7 @@ private:
     std::string AppName_ = "IVR";
     VkInstance Instance_;
     bool EnableValidationLayers_ = true;
+    bool IsHeadless_ = false; //when headless there is no glfw window, so the surface extensions are not requested
     const std::vector<const char*> ValidationLayers_ = {"VK_LAYER_KHRONOS_validation"
                                                         //,"VK_LAYER_LUNARG_api_dump"  
                                                         };
@@ -24,6 +25,7 @@ public:
 
     void SetAppName(std::string app_name);
     void EnableValidationLayersForInstanceCreation();
+    void EnableHeadlessMode();
     VkInstance CreateVulkanInstance();    
     bool CheckValidationLayerSupport();
     VkInstance GetInstance();
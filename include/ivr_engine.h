@@ -1,5 +1,6 @@
 #include <vulkan/vulkan.h>
 #include <memory>
+#include <string>
 
 #include "instance_setup.h"
 #include "ivr_window.h"
@@ -14,6 +15,47 @@
 #include "sync_objects_manager.h"
 #include "command_buffer_manager.h"
 #include "shadow_map.h"
+#include "offscreen_target.h"
+#include "profiler.h"
+#include "thread_pool.h"
+#include "resolution_scaler.h"
+
+struct IVREngineConfig {
+	uint32_t Width = 2160;
+	uint32_t Height = 1440;
+
+	//headless : no window, surface or swapchain. Frames are rendered into engine owned images and never presented
+	bool IsHeadless = false;
+	//headless only : copy every rendered frame into a host visible buffer so it can be read on the cpu
+	bool IsReadbackEnabled = false;
+
+	uint32_t MaxFramesInFlight = 2;
+
+	//gpu timestamps and cpu scopes are only collected when enabled
+	bool IsProfilingEnabled = false;
+
+	//threads recording secondary command buffers, 0 uses one per hardware thread
+	uint32_t RecordingThreadCount = 0;
+
+	//record the secondary command buffers of each frame index once and replay them until the world structure changes
+	bool IsCommandBufferCachingEnabled = false;
+
+	//render the main pass below the output resolution and upscale it, the scale follows the gpu frame time
+	bool IsDynamicResolutionEnabled = false;
+	float TargetFrameTimeMs = 1000.0f / 60.0f;
+	float MinResolutionScale = 0.5f;
+
+	//windowed only : used if the surface supports it, fifo otherwise
+	VkPresentModeKHR PresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+	//frames the cpu may have submitted but the gpu not yet finished when it starts recording a new one, 0 means MaxFramesInFlight
+	//fewer queued frames means the input a frame is built from is older by fewer frames when it reaches the screen
+	uint32_t MaxQueuedFrames = 0;
+
+	//every this many submitted frames the gpu memory usage (per category and against the heap budgets) is logged, 0 disables it
+	uint32_t MemoryReportIntervalFrames = 0;
+	//if set, the report is also written to this json file, overwritten on every report
+	std::string MemoryReportPath;
+};
 
 
 class IVREngine {
@@ -31,11 +73,88 @@ private:
 	std::shared_ptr<IVRSyncObjectsManager> SyncObjectsManager_;
 	std::shared_ptr<IVRCBManager> CBManager_;
 	std::shared_ptr<IVRShadowMap> ShadowMap_;
+	std::shared_ptr<IVROffscreenTarget> OffscreenTarget_; //only used when headless
+	std::shared_ptr<IVRProfiler> Profiler_;
+	std::shared_ptr<IVRThreadPool> RecordingThreadPool_;
+	std::shared_ptr<IVROffscreenTarget> ScaledTarget_; //main pass color images when dynamic resolution is on, one per frame in flight
+	std::shared_ptr<IVRResolutionScaler> ResolutionScaler_;
+
+	IVREngineConfig Config_;
+
+	//extent and format of the color images the main pass renders into (swapchain images or offscreen images)
+	VkExtent2D RenderExtent_;
+	VkFormat RenderImageFormat_;
+	//the part of the main pass targets that is rendered into, equal to RenderExtent_ unless dynamic resolution lowered it
+	VkExtent2D ScaledRenderExtent_;
+	uint64_t LastScaledGPUFrameCount_;
+
+	uint32_t CurrentSwapchainImageIndex_; //when headless this is the index of the offscreen image
 
-	uint32_t CurrentSwapchainImageIndex_;
+	//number of frames the cpu is allowed to record ahead of the gpu
+	//per frame resources (command buffers, sync objects, uniform buffers, descriptor sets, shadow maps) are created this many times
+	uint32_t MaxFramesInFlight_;
+	uint32_t CurrentFrameIndex_; //cycles from 0 to MaxFramesInFlight_ - 1
+	uint32_t LastSubmittedFrameIndex_;
+
+	uint64_t SubmittedFrameCount_; //also the value the frame timeline semaphore reaches when the last submitted frame finishes
+	uint32_t MaxQueuedFrames_;
+
+	//profiler time (us) of the last MarkInputSampled, consumed by the next submission
+	double InputSampleTimeUs_;
+	bool HasInputSample_;
+	double LastInputToSubmitMs_;
+
+	//blocks until at most MaxQueuedFrames_ - 1 submitted frames are unfinished
+	void WaitForQueuedFrames();
+	//number of submitted frames the gpu is known to have finished, only after the current frame index's fence has been waited for
+	uint64_t GetCompletedFrameCount();
+
+	uint32_t LastFrameDrawCallCount_; //shadow and main pass draws recorded by the last DrawFrame
+
+	void CreateWindowedRenderTargets();
+	void CreateHeadlessRenderTargets();
+	void CreateScaledRenderTargets();
+
+	//feeds the latest gpu frame time to the resolution scaler and applies the new scale
+	void UpdateResolutionScale();
+	//logs (and writes, if a path is configured) the memory allocator stats every MemoryReportIntervalFrames frames
+	void ReportMemoryUsage();
+	//upsamples the scaled main pass image into the swapchain (or headless output) image
+	void RecordUpscaleBlit(VkCommandBuffer command_buffer);
+	//the scaled targets are per frame in flight, the output images are per swapchain image
+	uint32_t GetMainFramebufferIndex() { return ScaledTarget_ ? CurrentFrameIndex_ : CurrentSwapchainImageIndex_; }
+
+	//a range of render objects that one recording thread records into one secondary command buffer
+	struct RecordingTask {
+		std::shared_ptr<IVRBaseMaterial> BaseMaterial; //null for the shadow pass
+		std::vector<std::shared_ptr<IVRRenderObject>>* RenderObjects;
+		size_t First;
+		size_t Count;
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		uint32_t DrawCallCount = 0;
+	};
+	static const size_t MinObjectsPerRecordingTask_ = 64;
+
+	//recorded secondary command buffers of every frame index, kept around for replay when caching is enabled
+	std::vector<std::vector<RecordingTask>> ShadowPassTasks_;
+	std::vector<std::vector<RecordingTask>> MainPassTasks_;
+	std::vector<bool> IsRecordingValid_;
+	std::vector<uint64_t> RecordedStructureVersions_; //world structure version at the time each frame index was recorded
+
+	void RecordSecondaryCommandBuffers(uint32_t frame_index);
+
+	size_t GetRecordingChunkSize(size_t object_count);
+	void SetViewportAndScissor(VkCommandBuffer command_buffer, VkExtent2D extent);
+	//binds the mesh arena page holding the model's geometry, with the index type of its indices, unless it is already bound
+	void BindMeshArenaPage(VkCommandBuffer command_buffer, std::shared_ptr<IVRModel> model, VkBuffer& bound_vertex_buffer, VkIndexType& bound_index_type);
+	uint32_t RecordShadowDraws(VkCommandBuffer command_buffer, uint32_t frame_index, std::vector<std::shared_ptr<IVRRenderObject>>& render_objects, size_t first, size_t count);
+	uint32_t RecordMaterialDraws(VkCommandBuffer command_buffer, uint32_t frame_index, std::shared_ptr<IVRBaseMaterial> base_material,
+		std::vector<std::shared_ptr<IVRRenderObject>>& render_objects, size_t first, size_t count);
+	//executes the secondary command buffers of the tasks in order and adds up their draw calls
+	void ExecuteRecordingTasks(VkCommandBuffer command_buffer, std::vector<RecordingTask>& tasks);
 
 public:
-	IVREngine();
+	IVREngine(IVREngineConfig config = IVREngineConfig());
 	~IVREngine() {};
 
 	//initialize the various resources for the rendering engine
@@ -45,12 +164,33 @@ public:
 	void CreatePipelines();
 	void PostWorldInit();
 
+	//DrawFrame is RecordFrame followed by SubmitFrame. The command buffers only reference the uniform buffers, so the world can be
+	//updated between the two : this lets input be sampled after recording, right before submission
 	void DrawFrame();
+	void RecordFrame();
+	void SubmitFrame();
+	//call when the input used by the current frame has been read, the time until the frame is submitted is its input latency on the cpu
+	void MarkInputSampled();
+	double GetLastInputToSubmitMs() { return LastInputToSubmitMs_; }
+	//forces every frame index to be re-recorded, for engine side changes (pipelines, render extent) the world does not know about
+	void InvalidateCachedCommandBuffers();
 
 	std::shared_ptr<IVRDeviceManager> GetDeviceManager() { return DeviceManager_; }
 	std::shared_ptr<IVRWindow> GetWindow() { return Window_; }
+	std::shared_ptr<IVRProfiler> GetProfiler() { return Profiler_; }
 	void SetWorld(std::shared_ptr<IVRWorld> world) { World_ = world; }
 
 	uint32_t QueryForSwapchainIndex();
+	uint32_t GetMaxFramesInFlight() { return MaxFramesInFlight_; }
+	uint32_t GetMaxQueuedFrames() { return MaxQueuedFrames_; }
+	bool IsHeadless() { return Config_.IsHeadless; }
+	VkExtent2D GetRenderExtent() { return RenderExtent_; }
+	VkExtent2D GetScaledRenderExtent() { return ScaledRenderExtent_; }
+
+	//waits on the fence of the last submitted frame and writes its readback buffer to a ppm file (headless with readback only)
+	void SaveLastFrame(const std::string& file_path);
+	uint32_t GetCurrentFrameIndex() { return CurrentFrameIndex_; }
+	uint32_t GetLastFrameDrawCallCount() { return LastFrameDrawCallCount_; }
+	uint32_t GetRecordingThreadCount() { return RecordingThreadPool_->GetThreadCount(); }
 	std::shared_ptr<IVRSwapchainManager> GetSwapchainManager() { return SwapchainManager_; }
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include "descriptors.h"
 #include "pipeline_config.h"
+#include "ub_structs.h"
 
 class IVRBaseMaterial {
 
@@ -13,26 +14,34 @@ private:
 
 	VkDescriptorSetLayout DescriptorSetLayout_;
 	IVRDescriptorSetInfo DescriptorSetInfo_;
-	VkPipelineLayout PipelineLayout_;
-	VkPipeline Pipeline_;
+	VkPushConstantRange PushConstantRange_;
+	VkPipelineLayout PipelineLayout_ = VK_NULL_HANDLE;
+	VkPipeline Pipeline_ = VK_NULL_HANDLE;
 
 	uint32_t LightCount_;
 	uint32_t TextureCount_;
-	uint32_t SwapchainImageCount_;
+	uint32_t FramesInFlight_;
 
 	bool IsCubemap = false;
+	//of the meshes drawn with this material, the vertex shader reads this layout
+	IVRVertexLayout VertexLayout_;
 
 public:
 	IVRBaseMaterial(std::string name, std::string vertex_shader_path, std::string fragment_shader_path, std::string default_texture,
-		uint32_t light_count, uint32_t texture_count, uint32_t swapchain_image_count, bool is_cubemap);
+		uint32_t light_count, uint32_t texture_count, uint32_t frames_in_flight, bool is_cubemap, IVRVertexLayout vertex_layout = IVRVertexLayout::Full);
 
 	std::string GetVertexShaderPath();
 	std::string  GetFragmentShaderPath();
 	std::string GetDefaultTexture();
+	IVRVertexLayout GetVertexLayout() { return VertexLayout_; }
 
 	void CreateDescriptorSetLayoutInfo();
 	IVRDescriptorSetInfo GetDescriptorSetInfo();
 
+	//the per draw data (ObjectPushConstants) the material's shaders read
+	void CreatePushConstantRange();
+	VkPushConstantRange GetPushConstantRange() { return PushConstantRange_; }
+
 	void SetDescriptorSetLayout(VkDescriptorSetLayout descriptor_set_layout);
 	VkDescriptorSetLayout GetDescriptorSetLayout();
 
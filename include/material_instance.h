@@ -2,12 +2,17 @@
 
 #include <vulkan/vulkan.h>
 #include <string>
+#include <unordered_map>
 
 #include "texture.h"
 #include "texture_2d.h"
 #include "texture_cube.h"
 #include "texture_depth.h"
+#include "texture_cache.h"
 #include "uniform_buffer_manager.h"
+#include "uniform_arena.h"
+#include "material_table.h"
+#include "transform_buffer.h"
 #include "descriptors.h"
 #include "ivr_path.h"
 #include "ub_structs.h"
@@ -21,46 +26,63 @@ private:
 	std::shared_ptr<IVRBaseMaterial> BaseMaterial_;
 
 	std::vector<std::string> TextureNames_;
-	std::vector<std::shared_ptr<IVRTexture>> Textures_;
+	std::vector<std::shared_ptr<IVRTexture>> Textures_; //shared with the other material instances sampling the same files, through the texture cache
 	std::vector<std::shared_ptr<IVRTextureDepth>> DepthTextures_;
 
 	std::vector<VkDescriptorSet> DescriptorSets_;
-
-	std::vector<std::shared_ptr<IVRUBManager>> MVPMatrixUBs_;
+	std::shared_ptr<IVRDescriptorManager> DescriptorManager_; //the sets were allocated from its pool, kept alive until they are released
 
 	std::shared_ptr<IVRDeviceManager> DeviceManager_;
+	std::shared_ptr<IVRUniformArena> UniformArena_;
+	std::shared_ptr<IVRMaterialTable> MaterialTable_;
+	std::shared_ptr<IVRTransformBuffer> TransformBuffer_;
 
-	MaterialPropertiesUBObj MaterialProperties_;
-
-	uint32_t SwapchainImageCount_;
+	uint32_t FramesInFlight_;
 
-	//2D vector of lights (there are multiple lights for each swapchain image) (first index is swapchain image index, second index is light index)
+	//2D vector of lights (there are multiple lights for each frame in flight) (first index is frame-in-flight index, second index is light index)
 	//even though light will generally remain constant, it can be changed every frame (for example, if the light is attached to a moving object)
 	std::vector<std::vector<std::shared_ptr<IVRUBManager>>> LightUBs_; 
 	uint32_t LightCount_;
-	std::vector<std::shared_ptr<IVRUBManager>> MaterialPropertiesUBs_;
-	std::vector<std::shared_ptr<IVRUBManager>> LightMVPUBManagers_;
+
+	//offsets in the uniform arena (the same in every frame's buffer)
+	uint32_t CameraOffset_; //shared by every object, written by the world
+	uint32_t LightOffset_; //shared by every object, written by the world
+	//one per dynamic uniform buffer binding, in binding order : camera, light view projection (once per light)
+	std::vector<uint32_t> DynamicOffsets_;
+
+	uint32_t MaterialIndex_; //entry in the material table, pushed with the draws
 
 public:
-	IVRMaterialInstance(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRBaseMaterial> base_material,
-				std::vector<std::string> texture_names, MaterialPropertiesUBObj properties, uint32_t swapchain_image_count, 
-				std::vector<std::vector<std::shared_ptr<IVRUBManager>>>& light_ubos);
+	IVRMaterialInstance(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRUniformArena> uniform_arena,
+				std::shared_ptr<IVRMaterialTable> material_table, std::shared_ptr<IVRTextureCache> texture_cache, std::shared_ptr<IVRBaseMaterial> base_material,
+				std::vector<std::string> texture_names, MaterialPropertiesUBObj properties, uint32_t frames_in_flight, 
+				std::vector<std::vector<std::shared_ptr<IVRUBManager>>>& light_ubos,
+				const std::unordered_map<std::string, std::shared_ptr<IVRDecodedImage>>& decoded_images = {});
+	//the descriptor sets go back to the pool through the deletion queue, once the frames in flight no longer bind them
+	~IVRMaterialInstance();
+
+	//where a texture of the material is read from (a folder of faces for cubemaps), the key of decoded_images
+	static std::string GetTexturePath(const std::string& texture_name, bool is_cubemap);
 	
 	void AssignDepthTextures(std::vector<std::shared_ptr<IVRTextureDepth>> depth_textures);
 
-	void AssignDescriptorSet(VkDescriptorSet descriptor_set);
-	VkDescriptorSet GetDescriptorSet(uint32_t swapchain_image_index);
+	void AssignDescriptorSet(VkDescriptorSet descriptor_set, std::shared_ptr<IVRDescriptorManager> descriptor_manager);
+	VkDescriptorSet GetDescriptorSet(uint32_t frame_index);
 
-	//only the mvp matrix uniform buffer is written to the descriptor set (this is updated every frame)
-	void WriteMVPMatrixToDescriptorSet(uint32_t swapchain_image_index);
-	void WriteToDescriptorSet(uint32_t swapchain_image_index);
+	void WriteToDescriptorSet(uint32_t frame_index);
 
-	void InitMVPMatrixUBs();
-	std::shared_ptr<IVRUBManager> GetMVPMatrixUB(uint32_t swapchain_image_index);
 	void SetLightsUBs(std::vector<std::shared_ptr<IVRUBManager>> light_ubs);
-	void InitMaterialPropertiesUBs();
 
-	void AssignLightMVPUniformBuffers(std::shared_ptr<IVRUBManager> light_mvp_ubos);
+	//the uniform arena offsets of the per frame camera and light data
+	void AssignFrameUniformOffsets(uint32_t camera_offset, uint32_t light_offset);
+	void AssignTransformBuffer(std::shared_ptr<IVRTransformBuffer> transform_buffer) { TransformBuffer_ = transform_buffer; }
+	//passed to vkCmdBindDescriptorSets together with the descriptor set
+	const std::vector<uint32_t>& GetDynamicOffsets() { return DynamicOffsets_; }
+
+	uint32_t GetMaterialIndex() { return MaterialIndex_; }
+	//edits only this instance's entry, each frame's copy of the table gets it with that frame's next flush
+	void SetMaterialProperties(const MaterialPropertiesUBObj& properties) { MaterialTable_->Update(MaterialIndex_, properties); }
+	const MaterialPropertiesUBObj& GetMaterialProperties() { return MaterialTable_->Get(MaterialIndex_); }
 
 	std::shared_ptr<IVRBaseMaterial> GetBaseMaterial();
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include "buffer_utils.h"
+#include "memory_allocator.h"
+#include "upload_manager.h"
+#include "device_setup.h"
+#include "ub_structs.h"
+#include "debug_logger_utils.h"
+
+//The material properties of every material instance, in device local storage buffers that the shaders index with the
+//material index pushed with each draw. Every frame in flight has its own copy of the table, so that an edit never overwrites
+//entries a frame still executing on the gpu may be reading.
+//Add and Update only change the cpu copy and mark the entry in every frame's copy. Flush(frame_index) uploads the entries marked
+//in that frame's copy (runs of consecutive entries are one upload). It has to be called once the frame's fence was waited on :
+//the previous reads of that copy are then finished, and the upload is ordered before the frame's submission.
+//An edit so reaches each frame's copy the next time that frame index comes around.
+//Not thread safe, Flush has to be called on the thread that submits frames (like every upload).
+class IVRMaterialTable
+{
+private:
+
+	std::shared_ptr<IVRDeviceManager> DeviceManager_;
+
+	//one per frame in flight
+	std::vector<VkBuffer> Buffers_;
+	std::vector<IVRAllocation> Allocations_;
+	uint32_t Capacity_; //entries
+
+	std::vector<MaterialPropertiesUBObj> Entries_;
+	//entries changed since they were last uploaded to each frame's copy (first index is the frame index)
+	std::vector<std::vector<bool>> IsEntryDirty_;
+	std::vector<uint32_t> DirtyCounts_;
+	uint32_t UploadedEntryCount_; //since creation, for the stats
+
+	void MarkDirty(uint32_t index);
+
+public:
+
+	IVRMaterialTable(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, uint32_t capacity);
+	~IVRMaterialTable();
+
+	//returns the material index of the new entry, throws when the table is full
+	uint32_t Add(const MaterialPropertiesUBObj& properties);
+	void Update(uint32_t index, const MaterialPropertiesUBObj& properties);
+	const MaterialPropertiesUBObj& Get(uint32_t index) { return Entries_[index]; }
+
+	//uploads the entries added or updated since the last flush of frame_index's copy, does nothing when there are none
+	//the frame's fence has to have been waited on
+	void Flush(uint32_t frame_index);
+	//flushes every frame's copy, only while no frame is in flight (when loading)
+	void FlushAll();
+
+	VkBuffer GetBuffer(uint32_t frame_index) { return Buffers_[frame_index]; }
+	uint32_t GetCount() { return static_cast<uint32_t>(Entries_.size()); }
+
+	void LogStats();
+};
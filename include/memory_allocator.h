@@ -0,0 +1,174 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <array>
+#include <string>
+#include <stdexcept>
+
+#include "debug_logger_utils.h"
+
+enum class IVRAllocationStrategy {
+	//power of two nodes that are split and merged again, for resources with independent lifetimes
+	Buddy,
+	//bump allocation, a block is only reused once everything in it has been freed. For short lived resources freed together (staging)
+	Linear
+};
+
+//what an allocation is used for, every allocation is accounted under one
+enum class IVRMemoryCategory {
+	Mesh, //vertex and index buffers (mesh arena pages)
+	Texture, //sampled images
+	Uniform, //uniform buffers and the uniform arena
+	DepthBuffer, //depth attachment of the main pass
+	ShadowMap, //depth images of the shadow pass
+	RenderTarget, //offscreen color images and readback buffers
+	Staging, //upload staging memory
+	Other,
+	Count
+};
+
+//a range of a VkDeviceMemory block handed out by IVRMemoryAllocator
+//default constructed allocations are empty, freeing them does nothing
+struct IVRAllocation
+{
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+	void* MappedData = nullptr; //host visible memory is kept mapped, this already points at Offset
+
+	uint32_t PoolIndex = 0;
+	uint32_t BlockIndex = 0;
+	bool IsDedicated = false; //has its own VkDeviceMemory, used for allocations too large for a block
+	bool IsOptimalImage = false;
+	IVRMemoryCategory Category = IVRMemoryCategory::Other;
+	uint32_t HeapIndex = 0;
+};
+
+struct IVRMemoryCategoryStats
+{
+	uint32_t AllocationCount = 0;
+	VkDeviceSize UsedBytes = 0; //requested bytes of the live allocations
+	VkDeviceSize PeakBytes = 0; //highest UsedBytes so far
+};
+
+//usage of one memory heap
+//with VK_EXT_memory_budget the budget and usage come from the driver and include other processes and allocations we do not make,
+//otherwise the budget is a fixed share of the heap size and the usage is the memory this allocator got from the driver
+struct IVRHeapBudget
+{
+	VkDeviceSize HeapSize = 0;
+	bool IsDeviceLocal = false;
+	VkDeviceSize BudgetBytes = 0;
+	VkDeviceSize UsageBytes = 0;
+	VkDeviceSize AllocatedBytes = 0; //blocks and dedicated allocations of this allocator
+};
+
+struct IVRMemoryStats
+{
+	uint32_t BlockCount = 0;
+	VkDeviceSize BlockBytes = 0; //memory allocated from the driver for blocks
+	uint32_t DedicatedAllocationCount = 0;
+	VkDeviceSize DedicatedBytes = 0;
+	uint32_t AllocationCount = 0; //sub-allocations and dedicated allocations
+	VkDeviceSize UsedBytes = 0; //requested bytes of all live allocations
+
+	std::array<IVRMemoryCategoryStats, static_cast<size_t>(IVRMemoryCategory::Count)> Categories;
+};
+
+//Sub-allocates buffers and images from a few large VkDeviceMemory blocks instead of one vkAllocateMemory per resource
+//(drivers limit the number of allocations, maxMemoryAllocationCount, and each one is slow)
+//There is a pool of blocks per memory type and strategy. Host visible blocks are mapped once when they are created.
+//Linear resources (buffers) and optimal tiling images must not share a bufferImageGranularity page, buddy nodes are never smaller
+//than the granularity and linear blocks pad to it when the kind of resource changes
+//Every allocation is tagged with a category and the memory taken from each heap is tracked against the heap's budget. Going over the
+//budget logs a warning (the driver may start paging to system memory), a failed vkAllocateMemory throws with the heap usage in the message.
+class IVRMemoryAllocator
+{
+private:
+
+	struct MemoryBlock
+	{
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		VkDeviceSize Size = 0;
+		void* MappedData = nullptr;
+
+		//buddy : free node offsets per level, level 0 is the whole block and every level halves the node size
+		std::vector<std::set<VkDeviceSize>> FreeNodes;
+		std::unordered_map<VkDeviceSize, uint32_t> AllocatedLevels; //offset -> level
+
+		//linear
+		VkDeviceSize LinearOffset = 0;
+		bool IsLastLinearOptimalImage = false;
+
+		uint32_t AllocationCount = 0;
+		VkDeviceSize UsedBytes = 0;
+	};
+
+	struct MemoryPool
+	{
+		uint32_t MemoryTypeIndex = 0;
+		IVRAllocationStrategy Strategy = IVRAllocationStrategy::Buddy;
+		std::vector<std::unique_ptr<MemoryBlock>> Blocks; //null once a block has been released, so that block indices stay valid
+	};
+
+	VkDevice LogicalDevice_;
+	VkPhysicalDevice PhysicalDevice_;
+	VkPhysicalDeviceMemoryProperties MemoryProperties_;
+
+	VkDeviceSize BufferImageGranularity_;
+	VkDeviceSize MinNodeSize_;
+	static const VkDeviceSize DefaultBlockSize_ = 64ull * 1024 * 1024;
+
+	std::vector<MemoryPool> Pools_; //memory type index * 2 + strategy
+	IVRMemoryStats Stats_;
+
+	bool IsMemoryBudgetEnabled_; //VK_EXT_memory_budget is enabled on the device
+	std::vector<VkDeviceSize> HeapAllocatedBytes_;
+	std::vector<bool> IsHeapOverBudget_; //so that going over the budget is only warned about once until usage drops below it again
+	static constexpr double FallbackBudgetFraction_ = 0.8; //of the heap size, without VK_EXT_memory_budget
+
+	std::mutex Mutex_;
+
+	uint32_t FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties);
+	VkDeviceSize GetBlockSize(uint32_t memory_type_index);
+
+	//expects Mutex_ to be held
+	std::vector<IVRHeapBudget> QueryHeapBudgets();
+	VkDeviceMemory AllocateDeviceMemory(uint32_t memory_type_index, VkDeviceSize size, IVRMemoryCategory category, void** mapped_data);
+	void ReleaseDeviceMemory(uint32_t memory_type_index, VkDeviceMemory memory, VkDeviceSize size);
+	MemoryBlock* CreateBlock(MemoryPool& pool, IVRMemoryCategory category, uint32_t& block_index);
+
+	bool AllocateBuddy(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	void FreeBuddy(MemoryBlock& block, VkDeviceSize offset);
+	bool AllocateLinear(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, bool is_optimal_image, VkDeviceSize& offset);
+
+public:
+
+	//is_memory_budget_enabled : VK_EXT_memory_budget was enabled on the device
+	IVRMemoryAllocator(VkDevice logical_device, VkPhysicalDevice physical_device, bool is_memory_budget_enabled = false);
+	~IVRMemoryAllocator();
+
+	//is_optimal_image : the resource is an image with optimal tiling (anything else, including buffers, counts as linear)
+	IVRAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, IVRMemoryCategory category,
+		IVRAllocationStrategy strategy = IVRAllocationStrategy::Buddy, bool is_optimal_image = false);
+	void Free(IVRAllocation& allocation);
+
+	IVRMemoryStats GetStats();
+	//one entry per memory heap
+	std::vector<IVRHeapBudget> GetHeapBudgets();
+	bool IsMemoryBudgetEnabled() { return IsMemoryBudgetEnabled_; }
+
+	void LogStats();
+	//writes the stats, per category and per heap, to a json file
+	void WriteStatsJson(const std::string& file_path);
+
+	static const char* GetCategoryName(IVRMemoryCategory category);
+
+	VkDevice GetLogicalDevice() { return LogicalDevice_; }
+	VkPhysicalDevice GetPhysicalDevice() { return PhysicalDevice_; }
+};
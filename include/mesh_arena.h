@@ -0,0 +1,97 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <map>
+#include <memory>
+#include <stdexcept>
+
+#include "device_setup.h"
+#include "buffer_utils.h"
+#include "memory_allocator.h"
+#include "upload_manager.h"
+#include "debug_logger_utils.h"
+
+//where a mesh lives in the arena : the draw uses FirstIndex and VertexOffset with the page's buffers bound,
+//the index buffer bound with IndexType (FirstIndex counts indices of that type)
+struct IVRMeshAllocation
+{
+	uint32_t PageIndex = 0;
+	uint32_t VertexOffset = 0;
+	uint32_t VertexCount = 0;
+	uint32_t FirstIndex = 0;
+	uint32_t IndexCount = 0;
+	VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+	bool IsValid = false;
+};
+
+//Packs the geometry of every model into a few large device local vertex and index buffers (pages), so that a pass binds
+//its geometry once (once per page) instead of once per object.
+//Every page keeps a free list of vertex and index ranges, freeing a mesh gives its ranges back and merges them with their neighbours.
+//Meshes are placed first fit into the first page that has room, a mesh larger than a page gets a page of its own.
+//16 and 32 bit indices share the index buffers : index ranges are kept in 16 bit units, 32 bit indices take two units
+//and start on an even unit so that their offset in the buffer is a multiple of 4 bytes.
+//All the meshes of an arena use the same vertex layout (vertex stride), there is one arena per layout.
+//Pages are shared between the graphics and the transfer queue family (concurrent sharing) when uploads run on a dedicated
+//transfer queue, so that a range can be uploaded without transferring the ownership of the whole buffer.
+class IVRMeshArena
+{
+private:
+
+	//offset -> count of free elements
+	class RangeFreeList
+	{
+	private:
+		std::map<uint32_t, uint32_t> FreeRanges_;
+	public:
+		void Init(uint32_t capacity);
+		//offset is a multiple of alignment
+		bool Allocate(uint32_t count, uint32_t alignment, uint32_t& offset);
+		void Free(uint32_t offset, uint32_t count);
+		uint32_t GetFreeCount();
+	};
+
+	struct Page
+	{
+		VkBuffer VertexBuffer;
+		IVRAllocation VertexAllocation;
+		VkBuffer IndexBuffer;
+		IVRAllocation IndexAllocation;
+		uint32_t VertexCapacity;
+		uint32_t IndexCapacity; //16 bit units
+		RangeFreeList FreeVertices;
+		RangeFreeList FreeIndices;
+	};
+
+	std::shared_ptr<IVRDeviceManager> DeviceManager_;
+	uint32_t VertexStride_;
+
+	std::vector<std::unique_ptr<Page>> Pages_;
+	static const uint32_t DefaultPageVertexCount_ = 512 * 1024;
+	static const uint32_t DefaultPageIndexUnitCount_ = 4 * 1024 * 1024;
+
+	uint32_t MeshCount_;
+
+	Page& CreatePage(uint32_t vertex_capacity, uint32_t index_unit_capacity);
+	bool AllocateInPage(Page& page, uint32_t vertex_count, uint32_t index_count, VkIndexType index_type, IVRMeshAllocation& allocation);
+
+	static uint32_t GetIndexUnitCount(VkIndexType index_type) { return index_type == VK_INDEX_TYPE_UINT16 ? 1 : 2; }
+
+public:
+
+	IVRMeshArena(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t vertex_stride);
+	~IVRMeshArena();
+
+	//uploads the geometry (through the upload manager, so it can be batched) and returns where it lives
+	//indices are uint16_t or uint32_t depending on index_type (VK_INDEX_TYPE_UINT16 or VK_INDEX_TYPE_UINT32)
+	IVRMeshAllocation Allocate(const void* vertices, uint32_t vertex_count, const void* indices, uint32_t index_count, VkIndexType index_type);
+	//the gpu must no longer be reading the mesh
+	void Free(IVRMeshAllocation& allocation);
+
+	VkBuffer GetVertexBuffer(uint32_t page_index) { return Pages_[page_index]->VertexBuffer; }
+	VkBuffer GetIndexBuffer(uint32_t page_index) { return Pages_[page_index]->IndexBuffer; }
+	uint32_t GetPageCount() { return static_cast<uint32_t>(Pages_.size()); }
+	uint32_t GetVertexStride() { return VertexStride_; }
+
+	void LogStats();
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "model.h"
+
+//A read only memory mapping of a whole file (mmap, or a file mapping on windows)
+class IVRMappedFile
+{
+private:
+	IVRMappedFile(const IVRMappedFile&) = delete;
+
+	const uint8_t* Data_;
+	size_t Size_;
+#ifdef _WIN32
+	void* File_;
+	void* Mapping_;
+#else
+	int FileDescriptor_;
+#endif
+
+public:
+	IVRMappedFile();
+	~IVRMappedFile();
+
+	//false if the file does not exist or cannot be mapped (empty files cannot be mapped either)
+	bool Open(const std::string& path);
+	void Close();
+
+	const uint8_t* GetData() { return Data_; }
+	size_t GetSize() { return Size_; }
+};
+
+//what a model's geometry looks like once processed, in the form it is uploaded in
+struct IVRMeshCacheData
+{
+	IVRVertexLayout VertexLayout = IVRVertexLayout::Full;
+	uint32_t VertexCount = 0;
+	VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+	uint32_t IndexCount = 0;
+	glm::vec3 BoundsMin = glm::vec3(0.0f);
+	glm::vec3 BoundsMax = glm::vec3(0.0f);
+	glm::mat4 DequantizationMatrix = glm::mat4(1.0f);
+	std::vector<IVRSubmesh> Submeshes;
+
+	//VertexCount vertices of VertexLayout and IndexCount indices of IndexType. When read from a cache file they point into its mapping
+	const void* VertexData = nullptr;
+	const void* IndexData = nullptr;
+};
+
+//The processed geometry of a model (deduplicated, optimized and encoded in the vertex layout and index type it is uploaded with),
+//stored next to the source file as <source>.<layout>.ivrmesh so that later loads skip parsing and processing.
+//A cache file is read by mapping it, its vertex and index streams are copied straight into staging memory.
+//It records the size, modification time and hash of the source it was made from. It is used when size and time match, or when they
+//do not but the hash still does (the file was touched or copied without changing), the cache then records the new time so that
+//later loads take the fast path again. It is also ignored when its version differs,
+//Version_ has to be bumped whenever the processing or the encoding changes.
+class IVRMeshCache
+{
+private:
+	static const uint32_t Version_ = 1;
+
+	IVRMappedFile CacheFile_;
+	IVRMeshCacheData Data_;
+
+	static uint64_t HashFile(const std::string& path);
+	static int64_t GetModifiedTime(const std::string& path);
+	//rewrites the source time recorded in the header of the (unmapped) cache file
+	static bool UpdateSourceModifiedTime(const std::string& cache_path, int64_t source_modified_time);
+
+	//can_update_time : when only the hash matches, record the source's new time and open the cache again
+	bool OpenCacheFile(const std::string& source_path, IVRVertexLayout vertex_layout, bool can_update_time);
+
+public:
+	IVRMeshCache() {}
+
+	static std::string GetCachePath(const std::string& source_path, IVRVertexLayout vertex_layout);
+
+	//maps the cache file of source_path, false if there is none or it is stale, of another version or damaged
+	//the data stays valid until the cache is destroyed
+	bool Open(const std::string& source_path, IVRVertexLayout vertex_layout);
+	const IVRMeshCacheData& GetData() { return Data_; }
+
+	//writes (or replaces) the cache file of source_path, logs a warning and returns false if it cannot
+	static bool Write(const std::string& source_path, const IVRMeshCacheData& data);
+};
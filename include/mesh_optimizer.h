@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+//Index buffer and vertex order optimizations for indexed triangle lists, run once when a model is loaded.
+//In the order they are meant to be applied :
+//1. OptimizeVertexCache reorders the triangles so that vertices are reused while they are still in the post transform cache
+//   (Forsyth's linear speed vertex cache optimisation)
+//2. OptimizeOverdraw splits the result where the cache restarts anyway and sorts those clusters outside in,
+//   so that front faces tend to be drawn before what they hide, giving up at most a little of the cache efficiency
+//3. OptimizeVertexFetch renumbers the vertices in the order the index buffer first uses them, so vertex fetches read memory front to back
+class IVRMeshOptimizer
+{
+public:
+
+	//average number of vertices transformed per triangle with a fifo cache of cache_size entries
+	//1.0 is about the best a real mesh gets, 3.0 means no vertex is ever reused
+	static float ComputeACMR(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size = 16);
+
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count);
+
+	//threshold : how much the ACMR may grow (1.05 allows 5% more vertex transforms)
+	static void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, float threshold = 1.05f);
+
+	//rewrites the indices and returns the new index of every vertex (remap[old] = new, ~0u for vertices no triangle uses)
+	static std::vector<uint32_t> OptimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertex_count);
+};
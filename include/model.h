@@ -1,16 +1,28 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
 #include <vector>
+#include <memory>
 #include <vulkan/vulkan.h>
 #include <iostream>
 #include <cstring>
 
 #include "buffer_utils.h"
 #include "device_setup.h"
+#include "upload_manager.h"
+#include "mesh_arena.h"
+#include "deletion_queue.h"
 #include "geometry_structs.h"
 #include "ivr_path.h"
 
 
+//how the vertices of a mesh are stored, every base material draws one layout (its pipeline's vertex input)
+enum class IVRVertexLayout {
+    Full, //Vertex, 32 bytes
+    Compressed, //CompressedVertex, 16 bytes
+    Count
+};
+
 struct Vertex {
     //vertex has 2 attributes
     glm::vec3 pos;
@@ -61,6 +73,65 @@ struct Vertex {
 };
 
 
+//Half the size of Vertex :
+// position : 16 bit snorm, relative to the mesh's bounds. The model's dequantization matrix (folded into its model matrix) scales it back
+// normal : octahedral encoding (the unit sphere folded onto a square) in two 16 bit snorms, decoded in the vertex shader
+// texture coordinate : two half floats
+//the shaders read the position and texture coordinate like the full layout's, only the normal needs decoding
+struct CompressedVertex {
+    uint16_t pos[4]; //the fourth component only pads the position to 8 bytes
+    uint16_t normal[2];
+    uint16_t texCoord[2];
+
+    static VkVertexInputBindingDescription getBindingDescription()
+    {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(CompressedVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        return bindingDescription;
+    }
+
+    static std::vector<VkVertexInputAttributeDescription> getAttributeDescription()
+    {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
+
+        //snorm formats are converted to floats in [-1, 1] by the vertex input
+        attributeDescriptions[0].binding = 0;
+        attributeDescriptions[0].location = 0;
+        attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+        attributeDescriptions[0].offset = offsetof(CompressedVertex, pos);
+
+        attributeDescriptions[1].binding = 0;
+        attributeDescriptions[1].location = 1;
+        attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+        attributeDescriptions[1].offset = offsetof(CompressedVertex, normal);
+
+        attributeDescriptions[2].binding = 0;
+        attributeDescriptions[2].location = 2;
+        attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+        attributeDescriptions[2].offset = offsetof(CompressedVertex, texCoord);
+
+        return attributeDescriptions;
+    }
+
+    //quantized is the position relative to the center of the bounds, divided by the largest half extent
+    static CompressedVertex Encode(const Vertex& vertex, glm::vec3 quantized_position);
+};
+
+
+//the triangles of one shape (obj object or group) of a model, a range of its index buffer
+struct IVRSubmesh {
+    uint32_t FirstIndex;
+    uint32_t IndexCount;
+};
+
+struct IVRMeshCacheData;
+class IVRMeshCache;
+
+//the geometry of one model file in one vertex layout, shared by every render object that draws it (see IVRModelRegistry)
+//where an object is placed is the render object's own transform
 class IVRModel {
 
 private:
@@ -68,39 +139,78 @@ private:
 
     std::string Name_;
 
-    VkDeviceMemory VertexBufferMemory_;
     uint32_t VertexCount_;
-    VkDeviceMemory IndexBufferMemory_;
 
     std::shared_ptr<IVRDeviceManager> DeviceManager_;
+    std::shared_ptr<IVRMeshArena> MeshArena_;
+    IVRMeshAllocation MeshAllocation_;
     std::string ModelPath_;
 
-    IVRTransform Transform_;
-    VkBuffer VertexBuffer_;
-    VkBuffer IndexBuffer_;
+    IVRVertexLayout VertexLayout_;
+    //takes the stored positions to model space, identity unless the positions are quantized
+    glm::mat4 DequantizationMatrix_;
+
+    //model space bounds of the vertex positions
+    glm::vec3 BoundsMin_;
+    glm::vec3 BoundsMax_;
+    std::vector<IVRSubmesh> Submeshes_;
+
+    //the processed geometry between PrepareMesh and UploadMesh, pointing into the mapped cache file or the encoded streams below
+    std::unique_ptr<IVRMeshCache> MeshCache_;
+    std::unique_ptr<IVRMeshCacheData> PreparedMesh_;
+    std::vector<CompressedVertex> EncodedVertices_;
+    std::vector<uint16_t> EncodedShortIndices_;
+
+    std::vector<CompressedVertex> CompressVertices();
+    //maps the mesh cache file, or parses, processes and encodes the obj file and writes the cache. Only touches the cpu
+    void PrepareMesh();
+    //reorders the triangles (of each submesh) for the vertex cache and overdraw and the vertices for fetching, logs the gain
+    //corner_count : number of face corners in the source file (the vertex count without deduplication)
+    void OptimizeMesh(uint32_t corner_count);
+    //allocates the mesh in the arena and uploads its streams, from a freshly processed model or a mesh cache file
+    void UploadMesh(const IVRMeshCacheData& mesh_data);
 
 public:
-    IVRModel(std::shared_ptr<IVRDeviceManager> device_manager, std::string model_name, std::string model_path);
+    //mesh_arena has to store vertices of vertex_layout
+    //is_upload_deferred : the constructor only prepares the mesh (no vulkan calls, so it can run on a loading thread),
+    //UploadMesh has to be called before the model is drawn
+    IVRModel(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRMeshArena> mesh_arena, std::string model_name, std::string model_path,
+        IVRVertexLayout vertex_layout = IVRVertexLayout::Full, bool is_upload_deferred = false);
     ~IVRModel();
 
+    static uint32_t GetVertexStride(IVRVertexLayout vertex_layout);
+    //"full" or "compressed", throws for anything else
+    static IVRVertexLayout VertexLayoutFromString(const std::string& vertex_layout);
+
+    //the parsed geometry, empty once it is uploaded (and when the mesh came from its cache file)
     std::vector<Vertex> Vertices;
     std::vector<uint32_t> Indices;
 
+    //parses the obj file into Vertices and Indices (deduplicated and optimized)
     void LoadModel();
 
-    void CreateVertexBuffer();
-    void CreateIndexBuffer();
+    //encodes Vertices and Indices in the model's vertex layout and writes them to the mesh cache, UploadMesh uploads them
+    void CreateMesh();
+
+    //uploads the prepared mesh into the arena and frees the cpu copy, called from the thread that records uploads
+    void UploadMesh();
 
     //not used anywhere. what is the purpose of this?
     uint32_t FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties);
 
-    IVRTransform GetTransform();
-    void SetPosition(glm::vec3 position);
-    void SetRotation(glm::vec3 rotation);
-    void SetScale(glm::vec3 scale);
+    //takes the stored positions to model space, applied before the render object's transform
+    glm::mat4 GetDequantizationMatrix() { return DequantizationMatrix_; }
+    IVRVertexLayout GetVertexLayout() { return VertexLayout_; }
+    glm::vec3 GetBoundsMin() { return BoundsMin_; }
+    glm::vec3 GetBoundsMax() { return BoundsMax_; }
+    const std::vector<IVRSubmesh>& GetSubmeshes() { return Submeshes_; }
+    bool IsUploaded() { return MeshAllocation_.IsValid; }
 
+    //the arena page buffers the model's geometry lives in, shared with other models
     VkBuffer GetVertexBuffer();
     VkBuffer GetIndexBuffer();
+    //draws use its FirstIndex, VertexOffset and IndexType
+    const IVRMeshAllocation& GetMeshAllocation();
     
 
 };
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "model.h"
+#include "mesh_arena.h"
+#include "device_setup.h"
+#include "debug_logger_utils.h"
+
+//Hands out one IVRModel per model file and vertex layout, shared by every render object that uses the file.
+//The registry only keeps weak references : a model is counted by the shared_ptrs of its users, and once the last one is gone
+//the model is destroyed and its arena ranges are released (through the deletion queue). Later requests load it again.
+//Not thread safe, models are looked up and registered on the thread that records uploads. PrepareModel only reads
+//the registry's settings, so loading threads can call it.
+class IVRModelRegistry
+{
+private:
+
+	std::shared_ptr<IVRDeviceManager> DeviceManager_;
+	std::vector<std::shared_ptr<IVRMeshArena>> MeshArenas_; //indexed by IVRVertexLayout
+
+	typedef std::pair<std::string, IVRVertexLayout> ModelKey;
+	std::map<ModelKey, std::weak_ptr<IVRModel>> Models_;
+
+	uint32_t LoadCount_; //models uploaded since creation
+
+	//forgets the models nobody uses anymore
+	void PruneExpired();
+
+public:
+
+	IVRModelRegistry(std::shared_ptr<IVRDeviceManager> device_manager, std::vector<std::shared_ptr<IVRMeshArena>> mesh_arenas);
+
+	//the loaded model of model_path (relative to the 3d_models folder) in vertex_layout, nullptr if nobody uses one
+	std::shared_ptr<IVRModel> Find(const std::string& model_path, IVRVertexLayout vertex_layout);
+	//Find, or loads and uploads the model and registers it
+	std::shared_ptr<IVRModel> Acquire(const std::string& model_path, IVRVertexLayout vertex_layout);
+
+	//a model prepared but not uploaded nor registered, safe to call from any thread
+	std::shared_ptr<IVRModel> PrepareModel(const std::string& model_path, IVRVertexLayout vertex_layout);
+	//uploads a model from PrepareModel and registers it. Returns the model already registered instead if there is one
+	std::shared_ptr<IVRModel> Add(const std::string& model_path, IVRVertexLayout vertex_layout, std::shared_ptr<IVRModel> model);
+
+	uint32_t GetLoadedModelCount();
+	void LogStats();
+};
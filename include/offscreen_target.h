@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "device_setup.h"
+#include "image_utils.h"
+#include "buffer_utils.h"
+#include "debug_logger_utils.h"
+
+//Engine owned color images that stand in for the swapchain images when the engine runs headless (no window, no surface)
+//(also used as the lower resolution main pass target when dynamic resolution is on)
+//There is one image per frame in flight, so the image index is simply the frame index
+//Optionally each image also gets a host visible buffer that the rendered image is copied into at the end of the frame
+class IVROffscreenTarget
+{
+private:
+
+	std::shared_ptr<IVRDeviceManager> DeviceManager_;
+
+	VkExtent2D Extent_;
+	VkFormat Format_;
+	uint32_t ImageCount_;
+	bool IsReadbackEnabled_;
+
+	std::vector<VkImage> Images_;
+	std::vector<IVRAllocation> ImageAllocations_;
+	std::vector<VkImageView> ImageViews_;
+
+	std::vector<VkBuffer> ReadbackBuffers_;
+	std::vector<IVRAllocation> ReadbackBufferAllocations_;
+	std::vector<void*> ReadbackMappedData_;
+
+public:
+
+	IVROffscreenTarget(std::shared_ptr<IVRDeviceManager> device_manager, VkExtent2D extent, VkFormat format, uint32_t image_count, bool enable_readback);
+	~IVROffscreenTarget();
+
+	void CreateImages();
+	void DestroyImages();
+	void CreateReadbackBuffers();
+	void DestroyReadbackBuffers();
+
+	//records a copy of the image (expected to be in TRANSFER_SRC_OPTIMAL layout) into its readback buffer
+	//the data can be read on the cpu once the fence of the submission that contains this copy has been signaled
+	void RecordReadbackCopy(VkCommandBuffer command_buffer, uint32_t image_index);
+	const void* GetReadbackData(uint32_t image_index);
+	VkDeviceSize GetReadbackSize();
+	void WriteReadbackToPPM(uint32_t image_index, const std::string& file_path);
+
+	bool IsReadbackEnabled() { return IsReadbackEnabled_; }
+	std::vector<VkImageView> GetImageViews() { return ImageViews_; }
+	VkImage GetImage(uint32_t image_index) { return Images_[image_index]; }
+	uint32_t GetImageCount() { return ImageCount_; }
+	VkExtent2D GetExtent() { return Extent_; }
+	VkFormat GetFormat() { return Format_; }
+};
@@ -52,16 +52,31 @@ struct IVRFixedFunctionPipelineConfig {
 		SetDefaultValues();
 	}
 
-	void SetDefaultValues()
+	//the vertex buffer layout the pipeline reads, the vertex shader has to declare matching inputs
+	void SetVertexLayout(IVRVertexLayout vertex_layout)
 	{
-		VertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		VertexInput.pNext = nullptr;
+		if (vertex_layout == IVRVertexLayout::Compressed)
+		{
+			VertexBindingDescription = CompressedVertex::getBindingDescription();
+			VertexAttributeDescriptions = CompressedVertex::getAttributeDescription();
+		}
+		else
+		{
+			VertexBindingDescription = Vertex::getBindingDescription();
+			VertexAttributeDescriptions = Vertex::getAttributeDescription();
+		}
+
 		VertexInput.vertexBindingDescriptionCount = 1;
-		VertexBindingDescription = Vertex::getBindingDescription();
 		VertexInput.pVertexBindingDescriptions = &VertexBindingDescription;
-		VertexAttributeDescriptions = Vertex::getAttributeDescription();
 		VertexInput.vertexAttributeDescriptionCount = VertexAttributeDescriptions.size();
 		VertexInput.pVertexAttributeDescriptions = VertexAttributeDescriptions.data();
+	}
+
+	void SetDefaultValues()
+	{
+		VertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		VertexInput.pNext = nullptr;
+		SetVertexLayout(IVRVertexLayout::Full);
 
 		InputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 		InputAssembly.pNext = nullptr;
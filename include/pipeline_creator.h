@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.h>
 #include <memory>
+#include <vector>
 
 #include "device_setup.h"
 #include "pipeline_config.h"
@@ -18,7 +19,7 @@ public:
 	VkPipeline CreatePipeline(VkRenderPass render_pass, IVRFixedFunctionPipelineConfig ff_pipeline_config, VkPipelineLayout pipeline_layout,
 								std::string vertex_shader_path, std::string fragment_shader_path);
 
-	VkPipelineLayout CreatePipelineLayout(VkDescriptorSetLayout descriptor_set_layouts);
+	VkPipelineLayout CreatePipelineLayout(VkDescriptorSetLayout descriptor_set_layouts, std::vector<VkPushConstantRange> push_constant_ranges = {});
 
 	VkShaderModule CreateShaderModule(std::string shader_path);
 
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "device_setup.h"
+#include "debug_logger_utils.h"
+
+//a single complete event ("ph" : "X") in the chrome://tracing / Perfetto json format
+struct IVRTraceEvent
+{
+	std::string Name;
+	std::string Category;
+	double StartUs; //relative to the creation of the profiler
+	double DurationUs;
+	uint32_t ThreadId; //0 is the gpu track, cpu threads start at 1
+};
+
+struct IVRGPUScopeResult
+{
+	std::string Name;
+	double DurationMs;
+};
+
+//Collects cpu scope timings and gpu timestamp timings and writes them out as a chrome trace
+//GPU timestamps are written into a query pool that has a separate range of queries for every frame in flight
+//The results of a frame are read when its frame index comes around again (after its fence has been waited on),
+//so reading them never stalls the cpu
+class IVRProfiler
+{
+private:
+
+	struct PendingGPUScope
+	{
+		std::string Name;
+		uint32_t StartQuery;
+		uint32_t EndQuery;
+	};
+
+	std::shared_ptr<IVRDeviceManager> DeviceManager_;
+
+	bool IsEnabled_;
+	bool IsGPUTimingSupported_;
+	uint32_t FramesInFlight_;
+
+	float TimestampPeriod_; //nanoseconds per timestamp tick
+	uint64_t TimestampMask_; //only timestampValidBits of the results are meaningful
+
+	VkQueryPool QueryPool_;
+	static const uint32_t MaxGPUQueriesPerFrame_ = 64;
+
+	//everything below is indexed by frame index
+	std::vector<std::vector<PendingGPUScope>> PendingGPUScopes_;
+	std::vector<std::vector<uint32_t>> OpenGPUScopes_; //indices into PendingGPUScopes_, so that scopes can be nested
+	std::vector<uint32_t> NextQuery_;
+	std::vector<double> SubmitTimesUs_;
+	std::vector<bool> HasPendingResults_;
+
+	std::vector<IVRGPUScopeResult> LastGPUResults_;
+	std::vector<double> GPUFrameTimesMs_; //first timestamp to last timestamp of every collected frame, in collection order (only kept when enabled)
+	double LastGPUFrameTimeMs_;
+	uint64_t CollectedGPUFrameCount_;
+
+	std::chrono::steady_clock::time_point StartTime_;
+
+	//cpu scopes can be recorded from any thread
+	std::mutex EventsMutex_;
+	std::vector<IVRTraceEvent> Events_;
+	std::unordered_map<std::thread::id, uint32_t> ThreadIds_;
+	static const size_t MaxTraceEvents_ = 1000000;
+	bool HasDroppedEvents_;
+
+	void AddEvent(IVRTraceEvent event);
+
+public:
+
+	//enabled : collect cpu and gpu events for traces and keep the gpu frame time history
+	//enable_gpu_timing : only measure gpu frame times (GetLastGPUFrameTimeMs), without keeping any history
+	IVRProfiler(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, bool enabled, bool enable_gpu_timing = false);
+	~IVRProfiler();
+
+	void CreateQueryPool();
+	void DestroyQueryPool();
+
+	//resets the queries of this frame index, must be recorded outside of a renderpass before any gpu scope of the frame
+	void BeginFrame(VkCommandBuffer command_buffer, uint32_t frame_index);
+	void BeginGPUScope(VkCommandBuffer command_buffer, uint32_t frame_index, const std::string& name);
+	void EndGPUScope(VkCommandBuffer command_buffer, uint32_t frame_index);
+	//the cpu time at submission is used to place the frame's gpu scopes on the trace timeline
+	void MarkFrameSubmitted(uint32_t frame_index);
+	//only call once the fence of the last submission with this frame index has been waited on
+	void CollectGPUResults(uint32_t frame_index);
+	//collects the results of every frame index, expects the device to be idle
+	void CollectAllGPUResults();
+
+	void RecordCPUEvent(const std::string& name, double start_us, double duration_us);
+	double GetTimeUs();
+
+	//expects the device to be idle so that every submitted frame has results
+	void WriteChromeTrace(const std::string& file_path);
+
+	bool IsEnabled() { return IsEnabled_; }
+	//gpu scope timings of the most recently collected frame
+	const std::vector<IVRGPUScopeResult>& GetLastGPUResults() { return LastGPUResults_; }
+	const std::vector<double>& GetGPUFrameTimesMs() { return GPUFrameTimesMs_; }
+	double GetLastGPUFrameTimeMs() { return LastGPUFrameTimeMs_; }
+	//increases every time a frame's gpu results are collected, used to tell if GetLastGPUFrameTimeMs has a new value
+	uint64_t GetCollectedGPUFrameCount() { return CollectedGPUFrameCount_; }
+};
+
+//records the time between its construction and destruction as a cpu event. Does nothing if the profiler is null or disabled
+class IVRCPUProfileScope
+{
+private:
+	IVRProfiler* Profiler_;
+	const char* Name_;
+	double StartUs_;
+
+public:
+	IVRCPUProfileScope(const std::shared_ptr<IVRProfiler>& profiler, const char* name);
+	~IVRCPUProfileScope();
+};
@@ -11,6 +11,7 @@
 #include "pipeline_config.h"
 
 //serves as the link between the model and the material
+//the model's geometry may be shared with other render objects, the transform is the object's own
 class IVRRenderObject {
 
 private:
@@ -19,21 +20,31 @@ private:
 	std::shared_ptr<IVRMaterialInstance> Material_;
 	std::shared_ptr<IVRShadowmapMaterial> ShadowmapMaterial_;
 	std::shared_ptr<IVRCamera> Camera_;
-	MVPUBObj MVPMatrixObj;
-	ShadowMapLightMVPUBObj LightMVPUBObj;
-	uint32_t SwapchainImageCount_;
+	uint32_t FramesInFlight_;
+	uint32_t TransformIndex_; //of the object's model matrix in the transform buffer
+	IVRTransform Transform_;
 
 public:
 	
-	IVRRenderObject(std::shared_ptr<IVRModel> model, std::shared_ptr<IVRMaterialInstance> material, std::shared_ptr<IVRCamera> camera, uint32_t swapchain_image_count);
+	IVRRenderObject(std::shared_ptr<IVRModel> model, std::shared_ptr<IVRMaterialInstance> material, std::shared_ptr<IVRCamera> camera, uint32_t frames_in_flight);
 
 	std::shared_ptr<IVRModel> GetModel();
 	std::shared_ptr<IVRMaterialInstance> GetMaterialInstance();
-	std::shared_ptr<IVRUBManager> GetMVPMatrixUB(uint32_t swapchain_image_index);
 
-	void UpdateMVPMatrixUB(uint32_t swapchain_image_index);
-	void UpdateLightMVPUB(uint32_t swapchain_image_index, glm::mat4 light_view, glm::mat4 light_proj);
-	void AssignLightMVPUBToMaterialInstance();
+	IVRTransform GetTransform() { return Transform_; }
+	//the world writes the model matrix into the transform buffer every frame, so these can be called at any time
+	void SetPosition(glm::vec3 position) { Transform_.Position = position; }
+	void SetRotation(glm::vec3 rotation) { Transform_.Rotation = rotation; }
+	void SetScale(glm::vec3 scale) { Transform_.Scale = scale; }
+	//the transform's model matrix combined with the dequantization of the model's positions, what the transform buffer holds
+	glm::mat4 GetModelMatrix() { return Transform_.GetModelMatrix() * Model_->GetDequantizationMatrix(); }
+
+	void SetTransformIndex(uint32_t transform_index) { TransformIndex_ = transform_index; }
+	uint32_t GetTransformIndex() { return TransformIndex_; }
+
+	//records the transform and material indices (ObjectPushConstants) for the following draw
+	//stage_flags has to match the pipeline layout's push constant range
+	void PushConstants(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout, VkShaderStageFlags stage_flags);
 
 	void AssignShadowmapMaterial(std::shared_ptr<IVRShadowmapMaterial> shadowmap_material);
 	std::shared_ptr<IVRShadowmapMaterial> GetShadowmapMaterial();
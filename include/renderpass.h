@@ -29,7 +29,8 @@ public:
 
 	void CreateRenderpass();
 
-	void BeginRenderPass(VkCommandBuffer command_buffer, VkFramebuffer framebuffer, VkExtent2D extent);
+	//contents is VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS when the draws are recorded into secondary command buffers
+	void BeginRenderPass(VkCommandBuffer command_buffer, VkFramebuffer framebuffer, VkExtent2D extent, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 	void EndRenderPass(VkCommandBuffer command_buffer);
 
 	VkRenderPass GetRenderpass();
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+
+//Picks the resolution scale of the main pass from the measured gpu frame time so that the frame time stays under a target
+//The scale applies to both axes, so the shaded pixel count goes with scale * scale
+class IVRResolutionScaler
+{
+private:
+	float TargetFrameTimeMs_;
+	float MinScale_;
+	float MaxScale_;
+	float Scale_;
+
+	double SmoothedFrameTimeMs_; //exponential moving average, single frames are too noisy to react to
+	bool HasSample_;
+	uint32_t FramesSinceChange_;
+
+	//scale changes are quantized and rate limited so the resolution does not flicker between values every frame
+	static constexpr float ScaleStep_ = 0.05f;
+	static constexpr double SmoothingFactor_ = 0.1;
+	static constexpr uint32_t FramesBetweenChanges_ = 30;
+	//only scale back up once there is this much headroom, otherwise the scale oscillates around the target
+	static constexpr double IncreaseThreshold_ = 0.85;
+
+public:
+	IVRResolutionScaler(float target_frame_time_ms, float min_scale, float max_scale = 1.0f);
+
+	//feed one gpu frame time, returns true if the scale changed
+	bool Update(double gpu_frame_time_ms);
+
+	float GetScale() { return Scale_; }
+	double GetSmoothedFrameTimeMs() { return SmoothedFrameTimeMs_; }
+};
@@ -8,7 +8,6 @@
 #include "framebuffer_manager.h"
 #include "pipeline_creator.h"
 #include "descriptors.h"
-#include "uniform_buffer_manager.h"
 #include "ub_structs.h"
 #include "light_manager.h"
 
@@ -23,35 +22,34 @@ private:
 	std::vector<std::shared_ptr<IVRDepthImage>> DepthImages_;
 	std::shared_ptr<IVRPipelineCreator> PipelineCreator_;
 	
-	uint32_t SwapchainImageCount_;
+	uint32_t FramesInFlight_;
 	VkExtent2D SwapchainExtent_;
 	
 	VkRenderPass SMRenderpass_;
 	std::vector<VkFramebuffer> SMFramebuffers_;
 	VkPipelineLayout SMPipelineLayout_;
-	VkPipeline SMPipeline_;
-
-	std::vector<ShadowMapLightMVPUBObj> LightMVPUBObjs_;
-	std::vector<std::shared_ptr<IVRUBManager>> LightMVPUBManagers_;
+	//one pipeline per vertex layout, they only differ in the vertex input (the dequantization is part of the model matrix)
+	std::vector<VkPipeline> SMPipelines_;
 
 public:
 
-	IVRShadowMap(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRLightManager> light_manager, VkExtent2D swapchain_extent, uint32_t swapchain_image_count);
+	IVRShadowMap(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRLightManager> light_manager, VkExtent2D swapchain_extent, uint32_t frames_in_flight);
 
 	void CreateDepthImage();
 	void CreateRenderpass();
 	void CreateFramebuffer();
-	void CreateLightMVPUniformBuffers();
 	void CreatePipeline();
 
-	void UpdateLightMVPUB(uint32_t swapchain_index, glm::mat4& model_mat);
-
-	void BeginRenderPass(VkCommandBuffer command_buffer, uint32_t swapchain_index);
+	void BeginRenderPass(VkCommandBuffer command_buffer, uint32_t frame_index, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 	void EndRenderPass(VkCommandBuffer command_buffer);
 
 	IVRDescriptorSetInfo GetDescriptorSetInfo();
-	VkPipeline GetPipeline();
+	//the transform index of the object being drawn (ObjectPushConstants)
+	VkPushConstantRange GetPushConstantRange();
+	VkPipeline GetPipeline(IVRVertexLayout vertex_layout);
 	VkPipelineLayout GetPipelineLayout();
+	VkRenderPass GetRenderpass() { return SMRenderpass_; }
+	VkFramebuffer GetFramebuffer(uint32_t frame_index) { return SMFramebuffers_[frame_index]; }
 
 	std::vector<std::shared_ptr<IVRDepthImage>> GetDepthImages();
 };
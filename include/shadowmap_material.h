@@ -2,23 +2,32 @@
 
 #include "descriptors.h"
 #include "ub_structs.h"
-#include "uniform_buffer_manager.h"
+#include "uniform_arena.h"
+#include "transform_buffer.h"
 
+//one shadowmap material is shared by every render object : the light's view projection is the same for all of them
+//and the model matrices are in the transform buffer, so the shadow pass binds its descriptor set once
 class IVRShadowmapMaterial {
 
 private:
 	IVRDescriptorSetInfo SMDescriptorSetInfo_;
 	std::vector<VkDescriptorSet> SMDescriptorSets_;
+	std::shared_ptr<IVRDescriptorManager> SMDescriptorManager_; //the sets were allocated from its pool, kept alive until they are released
 	VkDescriptorSetLayout SMDescriptorSetLayout_;
 	VkDescriptorPool SMDescriptorPool_;
-	std::vector<std::shared_ptr<IVRUBManager>> LightMVPUBManagers_;
+	uint32_t LightOffset_; //of the light view projection in the uniform arena, the same in every frame's buffer
 
 	std::shared_ptr<IVRDeviceManager> DeviceManager_;
-	uint32_t SwapchainImageCount_;
+	std::shared_ptr<IVRUniformArena> UniformArena_;
+	std::shared_ptr<IVRTransformBuffer> TransformBuffer_;
+	uint32_t FramesInFlight_;
 
 public:
 
-	IVRShadowmapMaterial(std::shared_ptr<IVRDeviceManager> device_manager, IVRDescriptorSetInfo descriptor_set_info, uint32_t swapchain_image_count);
+	IVRShadowmapMaterial(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRUniformArena> uniform_arena, uint32_t light_offset,
+		std::shared_ptr<IVRTransformBuffer> transform_buffer, IVRDescriptorSetInfo descriptor_set_info, uint32_t frames_in_flight);
+	//the descriptor sets go back to the pool through the deletion queue, once the frames in flight no longer bind them
+	~IVRShadowmapMaterial();
 	
 	IVRDescriptorSetInfo& GetDescriptorSetInfo();
 
@@ -26,11 +35,11 @@ public:
 	std::vector<VkDescriptorPoolSize> GetDescriptorPoolSize();
 	void AssignDescriptorSetLayout(VkDescriptorSetLayout descriptor_set_layout);
 	VkDescriptorSetLayout GetDescriptorSetLayout();
-	void AssignDescriptorSet(VkDescriptorSet descriptor_set);
-	void WriteToDescriptorSet(uint32_t swapchain_index);
-	VkDescriptorSet GetDescriptorSet(uint32_t swapchain_index);
+	void AssignDescriptorSet(VkDescriptorSet descriptor_set, std::shared_ptr<IVRDescriptorManager> descriptor_manager);
+	void WriteToDescriptorSet(uint32_t frame_index);
+	VkDescriptorSet GetDescriptorSet(uint32_t frame_index);
 
-	void InitLightMVPUBs();
-	std::shared_ptr<IVRUBManager> GetLightMVPUB(uint32_t swapchain_image_index);
+	//the dynamic offset the descriptor set is bound with
+	uint32_t GetLightOffset() { return LightOffset_; }
 
 };
\ No newline at end of file
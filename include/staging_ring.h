@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+#include "buffer_utils.h"
+#include "memory_allocator.h"
+
+//One persistently mapped, host visible buffer that upload staging data is sub-allocated from, front to back and wrapping around.
+//Allocations are first unsubmitted. MarkSubmitted tags all of them with the value that signals the end of the submission reading them,
+//and Reclaim gives their space back once that value has been reached. Values have to increase from one submission to the next.
+//Not thread safe, the upload manager serializes access.
+class IVRStagingRing
+{
+private:
+
+	struct Region
+	{
+		VkDeviceSize Begin;
+		VkDeviceSize End;
+		uint64_t CompletionValue;
+		bool IsSubmitted;
+	};
+
+	std::shared_ptr<IVRMemoryAllocator> Allocator_;
+
+	VkBuffer Buffer_;
+	IVRAllocation Allocation_;
+	VkDeviceSize Size_;
+
+	VkDeviceSize Head_; //where the next allocation starts looking, the oldest region is the tail
+	std::deque<Region> Regions_; //oldest first
+
+public:
+
+	IVRStagingRing(std::shared_ptr<IVRMemoryAllocator> allocator, VkDeviceSize size);
+	~IVRStagingRing();
+
+	//false when there is not enough contiguous free space right now
+	bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+	void MarkSubmitted(uint64_t completion_value);
+	void Reclaim(uint64_t completed_value);
+
+	bool HasUnsubmittedRegions();
+	//false when nothing is in use, or when the oldest region has not been submitted yet
+	bool GetOldestCompletionValue(uint64_t& completion_value);
+
+	VkBuffer GetBuffer() { return Buffer_; }
+	void* GetMappedData() { return Allocation_.MappedData; }
+	VkDeviceSize GetSize() { return Size_; }
+};
@@ -2,6 +2,7 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <array>
+#include <string>
 
 #include "image_utils.h"
 #include "device_setup.h"
@@ -38,9 +39,12 @@ private:
     std::shared_ptr<IVRDeviceManager> DeviceManager_;
     std::shared_ptr<IVRWindow> Window_;
 
+    VkPresentModeKHR PreferredPresentMode_; //used if the surface supports it, otherwise fifo
+    VkPresentModeKHR PresentMode_; //the present mode the swapchain was created with
+
 public:
 
-    IVRSwapchainManager(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRWindow> window);
+    IVRSwapchainManager(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRWindow> window, VkPresentModeKHR preferred_present_mode = VK_PRESENT_MODE_MAILBOX_KHR);
     ~IVRSwapchainManager(){};
 
     bool IsSwapchainAdequate(VkPhysicalDevice physical_device, VkSurfaceKHR surface);
@@ -49,6 +53,10 @@ public:
     VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& available_present_modes);
     VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
+    //command line names : immediate, mailbox, fifo, fifo-relaxed
+    static VkPresentModeKHR PresentModeFromString(const std::string& name);
+    static std::string PresentModeToString(VkPresentModeKHR present_mode);
+
     void CreateSwapchain();
     void DestroySwapchain();
     void RetrieveSwapchainImages();
@@ -60,10 +68,13 @@ public:
     void DestroyImageViews();
     uint16_t GetImageViewCount();
     VkImageView GetImageViewByIndex(uint16_t index);
+    std::vector<VkImageView> GetImageViews();
+    VkImage GetSwapchainImage(uint32_t index) { return SwapchainImages_[index]; }
 
     VkFormat GetSwapchainImageFormat();
     VkExtent2D GetSwapchainExtent();
     VkSwapchainKHR GetSwapchain();
+    VkPresentModeKHR GetPresentMode() { return PresentMode_; }
 
     void CreateFramebuffers(VkRenderPass renderPass, VkImageView depth_image_view);
     void DestroyFramebuffers();
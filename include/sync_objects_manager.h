@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <vector>
 
 #include "device_setup.h"
 #include "debug_logger_utils.h"
@@ -10,14 +11,24 @@ struct IVRSyncObjectsManager
 private:
 
 	std::shared_ptr<IVRDeviceManager> DeviceManager_;	
+	uint32_t FramesInFlight_;
+	uint32_t PresentImageCount_;
 
 public:
 
-	VkSemaphore ImageAvailableSemaphore;
-	VkSemaphore RenderFinishedSemaphore;
-	VkFence InFlightFence;
+	//one set of sync objects per frame in flight, indexed by the engine's current frame index
+	//this lets the cpu record frame N+1 while the gpu is still working on frame N
+	std::vector<VkSemaphore> ImageAvailableSemaphores;
+	std::vector<VkFence> InFlightFences;
 
-	IVRSyncObjectsManager(std::shared_ptr<IVRDeviceManager> device_manager);
+	//one per presentable image, indexed by the swapchain image index
+	//the present engine holds the wait on it until that image is acquired again, so a per frame semaphore could be re-signaled while still pending
+	std::vector<VkSemaphore> RenderFinishedSemaphores;
+
+	//timeline semaphore whose value is the number of frames the gpu has finished, VK_NULL_HANDLE if the device does not support timelines
+	VkSemaphore FrameTimelineSemaphore = VK_NULL_HANDLE;
+
+	IVRSyncObjectsManager(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, uint32_t present_image_count);
 	~IVRSyncObjectsManager();
 
 	void CreateSemaphores();
@@ -3,6 +3,9 @@
 #include <vulkan/vulkan.h>
 #include <iostream>
 #include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
 
 
 #include "stb_image.h"
@@ -11,8 +14,27 @@
 #include "buffer_utils.h"
 #include "image_utils.h"
 #include "singlecommand_utils.h"
+#include "upload_manager.h"
+#include "deletion_queue.h"
 #include "debug_logger_utils.h"
 
+//rgba pixels of one or more images of the same size (the faces of a cubemap), decoded with stb_image
+//decoding only touches the cpu, so it can run on any thread ahead of the texture that uploads the pixels
+struct IVRDecodedImage {
+    int Width = 0;
+    int Height = 0;
+    std::vector<stbi_uc*> Layers;
+
+    IVRDecodedImage() {}
+    IVRDecodedImage(const IVRDecodedImage&) = delete;
+    ~IVRDecodedImage();
+
+    //4 bytes per pixel, stbi_load is always asked for rgba
+    VkDeviceSize GetLayerSize() { return static_cast<VkDeviceSize>(Width) * Height * 4; }
+
+    //one layer per path, throws if a file cannot be decoded or the images differ in size
+    static std::shared_ptr<IVRDecodedImage> Decode(const std::vector<std::string>& paths);
+};
 
 class IVRTexture {
 
@@ -25,7 +47,7 @@ protected:
     std::shared_ptr<IVRDeviceManager> DeviceManager_;
 
     VkImage TextureImage_;
-    VkDeviceMemory TextureImageMemory_;
+    IVRAllocation TextureImageAllocation_;
     VkImageView TextureImageView_;
     VkSampler TextureSampler_;
     
@@ -34,6 +56,13 @@ protected:
     VkFormat TextureFormat_;
     uint32_t LayerCount_ = 1;
 
+    //pixels decoded before the texture was created, uploaded (and dropped) by CreateTextureImage
+    std::shared_ptr<IVRDecodedImage> DecodedImage_;
+
+    //the pixels decoded ahead of time if there are some, otherwise decodes paths now
+    std::shared_ptr<IVRDecodedImage> TakeDecodedImage(const std::vector<std::string>& paths);
+
+    //releases the image, view and sampler into the deletion queue, they are destroyed once no frame in flight samples them
     void CleanUp();
 
 public:
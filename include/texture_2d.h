@@ -10,7 +10,12 @@ private:
 	std::string TexturePath_;
 
 public:
-	IVRTexture2D(std::shared_ptr<IVRDeviceManager> device_manager, std::string texture_path);
+	//the settings every 2D texture is created with, part of its texture cache key
+	static const VkFormat Format = VK_FORMAT_R8G8B8A8_SRGB;
+	static const VkSamplerAddressMode AddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+
+	//decoded_image : the pixels of texture_path if they were decoded ahead of time, otherwise the file is decoded here
+	IVRTexture2D(std::shared_ptr<IVRDeviceManager> device_manager, std::string texture_path, std::shared_ptr<IVRDecodedImage> decoded_image = nullptr);
 	~IVRTexture2D() override; //virtual destructor
 	
 	void CreateTextureImage() override;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+
+#include "texture.h"
+#include "texture_2d.h"
+#include "texture_cube.h"
+#include "device_setup.h"
+#include "debug_logger_utils.h"
+
+//what makes two textures the same : the image file (the folder of the faces for cubemaps) and the settings it is created with
+struct IVRTextureKey
+{
+	std::string Path;
+	VkImageViewType ViewType;
+	VkFormat Format;
+	VkSamplerAddressMode AddressMode;
+
+	bool operator<(const IVRTextureKey& other) const
+	{
+		return std::tie(Path, ViewType, Format, AddressMode) < std::tie(other.Path, other.ViewType, other.Format, other.AddressMode);
+	}
+};
+
+//Hands out one texture (image, view and sampler) per key, shared by every material instance that samples it.
+//Like the model registry it only keeps weak references : the users' shared_ptrs count a texture, and once the last one is gone
+//the texture is released into the deletion queue. Later requests create it again.
+//Not thread safe, textures are created on the thread that records uploads.
+class IVRTextureCache
+{
+private:
+
+	std::shared_ptr<IVRDeviceManager> DeviceManager_;
+
+	std::map<IVRTextureKey, std::weak_ptr<IVRTexture>> Textures_;
+
+	uint32_t CreatedCount_; //textures uploaded since creation
+
+	//forgets the textures nobody uses anymore
+	void PruneExpired();
+
+public:
+
+	IVRTextureCache(std::shared_ptr<IVRDeviceManager> device_manager);
+
+	static IVRTextureKey GetKey(const std::string& texture_path, bool is_cubemap);
+
+	//the texture of texture_path if somebody uses it, nullptr otherwise
+	std::shared_ptr<IVRTexture> Find(const std::string& texture_path, bool is_cubemap);
+	//Find, or creates the texture and caches it. decoded_image : the pixels if they were decoded ahead of time, otherwise the file is decoded here
+	std::shared_ptr<IVRTexture> Acquire(const std::string& texture_path, bool is_cubemap, std::shared_ptr<IVRDecodedImage> decoded_image = nullptr);
+
+	uint32_t GetTextureCount();
+	void LogStats();
+};
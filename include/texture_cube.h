@@ -12,7 +12,15 @@ private:
 
 
 public:
-	IVRTextureCube(std::shared_ptr<IVRDeviceManager> device_manager, std::string cubemap_folder_path);
+	//the settings every cubemap is created with, part of its texture cache key
+	static const VkFormat Format = VK_FORMAT_R8G8B8A8_SRGB;
+	static const VkSamplerAddressMode AddressMode = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+
+	//decoded_image : the faces of the cubemap if they were decoded ahead of time, otherwise the files are decoded here
+	IVRTextureCube(std::shared_ptr<IVRDeviceManager> device_manager, std::string cubemap_folder_path, std::shared_ptr<IVRDecodedImage> decoded_image = nullptr);
+
+	//the face images in the folder, in layer order (+x, -x, +y, -y, +z, -z)
+	static std::vector<std::string> GetFacePaths(const std::string& cubemap_folder_path);
 	~IVRTextureCube() override; //virtual destructor
 
 	void CreateTextureImage() override;
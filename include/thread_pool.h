@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <algorithm>
+
+//Fixed set of worker threads that run submitted tasks in submission order
+//Each task gets the index of the worker running it, so workers can use per thread resources (like command pools) without locking
+class IVRThreadPool
+{
+private:
+	std::vector<std::thread> Workers_;
+	std::queue<std::function<void(uint32_t)>> Tasks_;
+
+	std::mutex Mutex_;
+	std::condition_variable TaskAvailable_;
+	std::condition_variable AllTasksDone_;
+
+	uint32_t ActiveTaskCount_;
+	bool IsStopping_;
+	std::exception_ptr FirstException_; //rethrown on the waiting thread
+
+	void WorkerLoop(uint32_t thread_index);
+
+public:
+	//thread_count 0 uses one thread per hardware thread
+	IVRThreadPool(uint32_t thread_count);
+	~IVRThreadPool();
+
+	void Submit(std::function<void(uint32_t thread_index)> task);
+	//blocks until every submitted task has finished, rethrows the first exception thrown by a task
+	void Wait();
+
+	uint32_t GetThreadCount() { return static_cast<uint32_t>(Workers_.size()); }
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#include "buffer_utils.h"
+#include "memory_allocator.h"
+#include "device_setup.h"
+#include "ub_structs.h"
+#include "debug_logger_utils.h"
+
+//The model matrix of every render object (ObjectTransform, 3x4) in one persistently mapped storage buffer per frame in flight.
+//The world rewrites a frame's buffer front to back once per frame and the vertex shaders index it with the transform index pushed
+//with each draw, so moving an object only changes the buffer's contents and never the recorded command buffers.
+class IVRTransformBuffer
+{
+private:
+
+	std::shared_ptr<IVRMemoryAllocator> Allocator_;
+	uint32_t FramesInFlight_;
+	uint32_t Capacity_; //transforms in each frame's buffer
+
+	std::vector<VkBuffer> Buffers_;
+	std::vector<IVRAllocation> Allocations_;
+
+public:
+
+	IVRTransformBuffer(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, uint32_t capacity);
+	~IVRTransformBuffer();
+
+	//Capacity_ transforms, the gpu must not be reading frame_index's buffer (the frame's fence has been waited for)
+	ObjectTransform* GetMappedTransforms(uint32_t frame_index) { return static_cast<ObjectTransform*>(Allocations_[frame_index].MappedData); }
+
+	VkBuffer GetBuffer(uint32_t frame_index) { return Buffers_[frame_index]; }
+	VkDeviceSize GetBufferSize() { return static_cast<VkDeviceSize>(Capacity_) * sizeof(ObjectTransform); }
+	uint32_t GetCapacity() { return Capacity_; }
+};
@@ -5,18 +5,36 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-struct MVPUBObj {
-    glm::mat4 Model;
+//written once per frame and shared by every object, the model matrices are in the transform buffer
+struct CameraUBObj {
     glm::mat4 View;
     glm::mat4 Proj;
 };
 
-struct ShadowMapLightMVPUBObj {
-	glm::mat4 Model;
+struct ShadowMapLightUBObj {
 	glm::mat4 LightView;
 	glm::mat4 LightProjection;
 };
 
+//an object's model matrix in the transform buffer : the first three rows, the last row of an affine transform is always (0, 0, 0, 1)
+struct ObjectTransform {
+	glm::vec4 Rows[3];
+
+	static ObjectTransform FromModelMatrix(const glm::mat4& model)
+	{
+		//glm is column major, the rows of the model matrix are the columns of its transpose
+		glm::mat4 transposed = glm::transpose(model);
+		return { { transposed[0], transposed[1], transposed[2] } };
+	}
+};
+
+//pushed with every draw (vkCmdPushConstants), only indices so that they do not change when an object moves
+struct ObjectPushConstants {
+	uint32_t TransformIndex;
+	uint32_t MaterialIndex;
+};
+
+//an entry of the material table (storage buffer), the layout matches the std430 struct in the shaders
 struct MaterialPropertiesUBObj {
 	float SpecularPower = 0;
 	uint32_t IsCubemap = 0;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <stdexcept>
+
+#include "buffer_utils.h"
+#include "memory_allocator.h"
+#include "device_setup.h"
+#include "debug_logger_utils.h"
+
+//One persistently mapped uniform buffer per frame in flight that the uniform data of the scene (camera and light matrices)
+//is packed into, back to back. Descriptors bind these buffers as UNIFORM_BUFFER_DYNAMIC and every
+//draw passes the offsets of the data it reads as dynamic offsets.
+//Offsets are handed out linearly when objects are created and are the same in every frame's buffer, so command buffers recorded
+//for one frame index stay valid while the data is rewritten each frame. Objects created in order write in order, which keeps
+//the per frame updates one front to back stream.
+//Allocate is not thread safe, Write to different offsets is.
+class IVRUniformArena
+{
+private:
+
+	std::shared_ptr<IVRMemoryAllocator> Allocator_;
+	uint32_t FramesInFlight_;
+
+	std::vector<VkBuffer> Buffers_;
+	std::vector<IVRAllocation> Allocations_;
+
+	VkDeviceSize Capacity_; //of each frame's buffer
+	VkDeviceSize Alignment_; //minUniformBufferOffsetAlignment
+	VkDeviceSize Head_;
+	uint32_t AllocationCount_;
+
+public:
+
+	IVRUniformArena(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, VkDeviceSize capacity);
+	~IVRUniformArena();
+
+	//reserves size bytes in every frame's buffer and returns the (dynamic) offset, throws when the arena is full
+	uint32_t Allocate(VkDeviceSize size);
+
+	//the gpu must not be reading frame_index's buffer (the frame's fence has been waited for)
+	void Write(uint32_t frame_index, uint32_t offset, const void* data, VkDeviceSize size);
+	//for data that does not change from frame to frame, only before the frames using it are in flight
+	void WriteAllFrames(uint32_t offset, const void* data, VkDeviceSize size);
+
+	VkBuffer GetBuffer(uint32_t frame_index) { return Buffers_[frame_index]; }
+	VkDeviceSize GetUsedSize() { return Head_; }
+
+	void LogStats();
+};
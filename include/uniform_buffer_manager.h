@@ -9,6 +9,7 @@
 
 #include "buffer_utils.h"
 #include "device_setup.h"
+#include "deletion_queue.h"
 
 class IVRUBManager {
 private:
@@ -31,7 +32,7 @@ public:
     //we dont want to update the buffer in preparation of the next frame while a previous one is still reading from it
     //Thus we need to have as many buffers as we have frames in flight, and write to a uniform buffer that is not currently being read by the GPU
     VkBuffer UniformBuffer;
-    VkDeviceMemory UniformBuffersMemory;
+    IVRAllocation UniformBufferAllocation;
     void* UniformBuffersMapped;
 
     //call this function to write to the uniform buffer
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <functional>
+
+#include "buffer_utils.h"
+#include "staging_ring.h"
+#include "debug_logger_utils.h"
+
+//Copies data from the cpu into device local buffers and images
+//When the device has a transfer only queue family (and timeline semaphores), the copies run on that queue so they do not queue up
+//behind rendering work. The resource is then released by the transfer queue family and acquired by the graphics queue family
+//(exclusive sharing mode), the graphics side waiting on the transfer side through a timeline semaphore.
+//Without a dedicated transfer queue the copies and the barriers for reading are recorded into graphics queue submissions.
+//Staging data is written into the staging ring, in chunks of at most a quarter of the ring. Each chunk's space is reclaimed once the
+//submission copying it has completed, and a full ring submits what has been recorded so far and waits for the oldest submission.
+//With timeline semaphores the upload functions return once the upload is submitted (the source data can be freed right away) and the
+//copy finishes in the background. Any later graphics queue submission is ordered after it. Without them every submission is waited for.
+//Between BeginBatch and EndBatch uploads are only recorded and EndBatch submits them. Loading a scene this way costs one submission
+//(or one per ring full of data) instead of one or more per resource.
+//Graphics queue submissions are not synchronized with the engine's, uploads must happen on the thread that submits frames.
+class IVRUploadManager
+{
+private:
+
+	//a submission that is still executing, its command buffer is freed once the timeline of its queue passes its value
+	struct PendingCommandBuffer
+	{
+		VkCommandBuffer CommandBuffer;
+		VkCommandPool CommandPool;
+		uint64_t TimelineValue;
+		bool IsAcquire; //tracked by AcquireTimeline_, otherwise by CopyTimeline_
+	};
+
+	std::shared_ptr<IVRMemoryAllocator> Allocator_;
+	std::shared_ptr<IVRStagingRing> StagingRing_;
+	VkDevice LogicalDevice_;
+
+	uint32_t GraphicsFamily_;
+	uint32_t TransferFamily_;
+	VkQueue GraphicsQueue_;
+	VkQueue TransferQueue_;
+	bool IsDedicatedTransferEnabled_;
+	bool IsTimelineEnabled_; //uploads complete in the background, tracked by the timelines below. Otherwise UploadFence_ is waited for
+	VkExtent3D CopyGranularity_; //minImageTransferGranularity of the queue family the copies run on
+
+	VkCommandPool GraphicsCommandPool_;
+	VkCommandPool TransferCommandPool_; //VK_NULL_HANDLE without a dedicated transfer queue
+
+	//each timeline is only signaled from one queue, so its values increase in the order that queue executes them
+	VkFence UploadFence_;
+	VkSemaphore CopyTimeline_; //signaled by the copy submissions, on the queue the copies run on
+	uint64_t CopyTimelineValue_; //last value signaled (or, with the fence, the number of submissions)
+	VkSemaphore AcquireTimeline_; //signaled by the acquire submissions on the graphics queue, VK_NULL_HANDLE without a dedicated transfer queue
+	uint64_t AcquireTimelineValue_;
+	std::vector<PendingCommandBuffer> PendingCommandBuffers_;
+
+	VkDeviceSize MaxChunkSize_;
+	static const VkDeviceSize StagingAlignment_ = 16; //covers the texel size of every format we upload (bufferOffset has to be a multiple of it)
+
+	//the open recording, uploads are added to it until it is submitted
+	VkCommandBuffer CopyCommandBuffer_;
+	VkCommandBuffer AcquireCommandBuffer_; //VK_NULL_HANDLE without a dedicated transfer queue, the copy command buffer is used instead
+	VkPipelineStageFlags AcquireStages_;
+
+	bool IsBatchOpen_;
+	uint32_t BatchUploadCount_;
+	uint32_t BatchSubmissionCount_;
+	VkDeviceSize BatchUploadedBytes_;
+
+	std::mutex Mutex_;
+
+	VkCommandBuffer BeginCommands(VkCommandPool command_pool);
+	void BeginRecording();
+	//submits the copy commands (and the graphics side acquire commands when the transfer queue is dedicated)
+	void SubmitRecording();
+	//offset of size bytes in the staging ring, submitting the open recording or waiting for older submissions when the ring is full
+	VkDeviceSize AllocateStaging(VkDeviceSize size);
+	//records the graphics side of the upload, then submits it unless a batch is open
+	//acquire_stage : the first stage the graphics queue uses the resource in, it waits there for the copy to finish
+	void EndUpload(VkDeviceSize size, const std::function<void(VkCommandBuffer)>& record_acquire, VkPipelineStageFlags acquire_stage);
+
+	VkSemaphore CreateTimeline();
+	//last_value is returned without timeline semaphores, every submission has been waited for then
+	uint64_t GetCompletedValue(VkSemaphore timeline, uint64_t last_value);
+	void WaitForValue(VkSemaphore timeline, uint64_t value);
+	//frees the command buffers and staging ring space of finished submissions
+	void ReleaseFinished();
+
+public:
+
+	//transfer_family == graphics_family (or no timeline semaphores) means there is no dedicated transfer queue
+	IVRUploadManager(std::shared_ptr<IVRMemoryAllocator> allocator, std::shared_ptr<IVRStagingRing> staging_ring, uint32_t graphics_family, VkQueue graphics_queue,
+		uint32_t transfer_family, VkQueue transfer_queue, bool is_timeline_semaphore_enabled);
+	~IVRUploadManager();
+
+	//dst_buffer needs TRANSFER_DST usage, dst_stage/dst_access describe how the graphics queue reads it afterwards
+	//is_shared : dst_buffer was created with GetSharedQueueFamilies(). Its ownership is not transferred, so a range of it can be
+	//uploaded while the graphics queue reads the rest. Does nothing when size is 0
+	void UploadToBuffer(const void* data, VkDeviceSize size, VkBuffer dst_buffer, VkDeviceSize dst_offset, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access,
+		bool is_shared = false);
+	//one pointer per array layer, each layer_size bytes. The image is taken from UNDEFINED to SHADER_READ_ONLY_OPTIMAL
+	//does nothing when there is no data (no layers, or an empty image)
+	void UploadToImage(const std::vector<const void*>& layers, VkDeviceSize layer_size, VkImage image, uint32_t width, uint32_t height);
+
+	void BeginBatch();
+	void EndBatch();
+
+	//waits for every upload submission, expects no other thread to be uploading
+	void WaitIdle();
+
+	bool IsDedicatedTransferEnabled() { return IsDedicatedTransferEnabled_; }
+	//the queue families buffers that are uploaded to in parts should be shared between (empty when uploads use the graphics queue)
+	std::vector<uint32_t> GetSharedQueueFamilies();
+};
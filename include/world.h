@@ -13,6 +13,7 @@
 #include "material_instance.h"
 #include "shadow_map.h"
 #include "shadowmap_material.h"
+#include "transform_buffer.h"
 
 //there should be only one world. Render objects can be grouped together into a scene (for now doing it directly)
 class IVRWorld {
@@ -21,8 +22,28 @@ private:
 	std::shared_ptr <IVRDescriptorManager> DescriptorManager_; //this class creates it own descriptor manager
 	std::shared_ptr<IVRDeviceManager> DeviceManager_;
 
+	//geometry of every render object's model, one arena per vertex layout (indexed by IVRVertexLayout)
+	//declared before the render objects so that they outlive them
+	std::vector<std::shared_ptr<IVRMeshArena>> MeshArenas_;
+	//one model per model file (and vertex layout), shared by the render objects using it
+	std::shared_ptr<IVRModelRegistry> ModelRegistry_;
+	//one texture per image file (and settings), shared by the material instances sampling it
+	std::shared_ptr<IVRTextureCache> TextureCache_;
+	//per frame uniform data (camera and light matrices) of every frame in flight
+	std::shared_ptr<IVRUniformArena> UniformArena_;
+	const VkDeviceSize UniformArenaSize_ = 4ull * 1024 * 1024;
+	//camera and light view projection, written once per frame and read by every object's draws
+	uint32_t CameraUBOffset_;
+	uint32_t LightUBOffset_;
+	//material properties of every material instance, indexed by the material index pushed with each draw
+	std::shared_ptr<IVRMaterialTable> MaterialTable_;
+	const uint32_t MaterialTableCapacity_ = 4096;
+	//model matrix of every render object (indexed by its transform index), rewritten every frame
+	std::shared_ptr<IVRTransformBuffer> TransformBuffer_;
+
 	std::shared_ptr<IVRShadowMap> ShadowMapper_;
 	std::shared_ptr<IVRDescriptorManager> SMDescriptorManager_;
+	std::shared_ptr<IVRShadowmapMaterial> ShadowmapMaterial_; //shared by every render object
 
 	std::vector<std::shared_ptr<IVRRenderObject>> RenderObjects_;
 	std::vector<std::shared_ptr<IVRBaseMaterial>> BaseMaterials_;
@@ -33,11 +54,18 @@ private:
 	
 	std::shared_ptr<IVRLightManager> LightManager_;
 	
-	uint32_t SwapchainImageCount_;
+	uint32_t FramesInFlight_;
+	uint32_t LoadingThreadCount_; //passed to the world loader
+	std::string SceneDirectory_;
+
+	//bumped whenever something that is baked into recorded command buffers changes (render objects, materials, descriptor sets)
+	uint64_t StructureVersion_;
 
 public:
 
-	IVRWorld(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t swapchain_image_count);
+	//loading_thread_count threads load the scene, 0 uses one per hardware thread
+	//scene_directory holds the scene json files, an empty string means the default scene folder
+	IVRWorld(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, uint32_t loading_thread_count = 0, std::string scene_directory = "");
 
 	void SetupCamera();
 	void SetCameraAspectRatio(float aspect_ratio);
@@ -57,12 +85,25 @@ public:
 
 	void Init();
 	void PostShadowMapperInit();
-	void Update(float dt, uint32_t swapchain_index);
+	void Update(float dt, uint32_t frame_index);
 
 	std::shared_ptr<IVRLightManager> GetLightManager();
+	std::shared_ptr<IVRCamera> GetCamera() { return Camera_; }
+	std::shared_ptr<IVRMeshArena> GetMeshArena(IVRVertexLayout vertex_layout) { return MeshArenas_[static_cast<uint32_t>(vertex_layout)]; }
+	std::shared_ptr<IVRModelRegistry> GetModelRegistry() { return ModelRegistry_; }
+	std::shared_ptr<IVRTextureCache> GetTextureCache() { return TextureCache_; }
+	std::shared_ptr<IVRUniformArena> GetUniformArena() { return UniformArena_; }
+	std::shared_ptr<IVRMaterialTable> GetMaterialTable() { return MaterialTable_; }
+	std::shared_ptr<IVRTransformBuffer> GetTransformBuffer() { return TransformBuffer_; }
 	std::vector<std::shared_ptr<IVRRenderObject>>& GetRenderObjects();
 	std::vector<std::shared_ptr<IVRBaseMaterial>>& GetBaseMaterials();
 	void OrganizeRenderObjectsByBaseMaterial();
+
+	//anything that changes which objects are drawn, or with which material/pipeline/descriptor sets, must call this
+	//so that cached command buffers get re-recorded. Changes to uniform buffer contents do not need it, and neither does
+	//moving an object (model matrices are read from the transform buffer)
+	void MarkStructureChanged() { StructureVersion_++; }
+	uint64_t GetStructureVersion() { return StructureVersion_; }
 	std::unordered_map<std::shared_ptr<IVRBaseMaterial>, std::vector<std::shared_ptr<IVRRenderObject>>>& GetBaseMaterialRenderObjectMap();
 
 };
\ No newline at end of file
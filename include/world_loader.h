@@ -2,26 +2,44 @@
 
 #include "json.hpp"
 
+#include <fstream>
+#include <string>
+
 #include "renderobject.h"
 #include "device_setup.h"
 #include "light_manager.h"
+#include "model_registry.h"
+#include "texture_cache.h"
 
 class IVRWorldLoader {
 private:
 	std::vector<IVRLight> Lights_;
 
 	std::shared_ptr<IVRDeviceManager> DeviceManager_;
+	std::shared_ptr<IVRModelRegistry> ModelRegistry_;
+	std::shared_ptr<IVRTextureCache> TextureCache_;
+	std::shared_ptr<IVRUniformArena> UniformArena_;
+	std::shared_ptr<IVRMaterialTable> MaterialTable_;
 	std::shared_ptr<IVRLightManager> LightManager_;
 	std::shared_ptr<IVRCamera> Camera_;
-	uint32_t SwapchainImageCount_;
+	uint32_t FramesInFlight_;
+	std::string SceneDirectory_; //directory holding base_materials.json, objects.json and lights.json
+	uint32_t LoadingThreadCount_; //threads preparing models and decoding textures, 0 is one per hardware thread
 
 	std::unordered_map<std::string, std::shared_ptr<IVRBaseMaterial>> NameBaseMaterialMap_;
 
+	std::ifstream OpenSceneFile(const std::string& file_name);
+	//the textures listed for an object in objects.json, or its base material's default texture if it lists none
+	std::vector<std::string> GetTextureNames(nlohmann::json& object);
+
 public:
-	IVRWorldLoader(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRLightManager> light_manager, std::shared_ptr<IVRCamera> camera, uint32_t swapchain_image_count);
+	IVRWorldLoader(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRModelRegistry> model_registry, std::shared_ptr<IVRTextureCache> texture_cache, std::shared_ptr<IVRUniformArena> uniform_arena,
+		std::shared_ptr<IVRMaterialTable> material_table, std::shared_ptr<IVRLightManager> light_manager, std::shared_ptr<IVRCamera> camera, uint32_t frames_in_flight,
+		std::string scene_directory, uint32_t loading_thread_count);
 	~IVRWorldLoader();
 
 	std::vector<std::shared_ptr<IVRBaseMaterial>> LoadBaseMaterialsFromJson();
+	//prepares the models and decodes the textures in parallel, then uploads them and creates the render objects in file order
 	std::vector<std::shared_ptr<IVRRenderObject>>  LoadRenderObjectsFromJson();
 	std::vector<IVRLight>&& LoadLightsFromJson();
 };
@@ -1,4 +1,5 @@
 F:\VulkanStuff\sdk\Bin\glslc.exe shaders/simple_texture_mapped.vert -o shaders/simple_texture_mapped.vert.spv
+F:\VulkanStuff\sdk\Bin\glslc.exe -DIVR_COMPRESSED_VERTICES shaders/simple_texture_mapped.vert -o shaders/simple_texture_mapped_compressed.vert.spv
 F:\VulkanStuff\sdk\Bin\glslc.exe shaders/simple_texture_mapped.frag -o shaders/simple_texture_mapped.frag.spv
 
 F:\VulkanStuff\sdk\Bin\glslc.exe shaders/cubemap.vert -o shaders/cubemap.vert.spv
@@ -1,5 +1,9 @@
 /usr/local/bin/glslc shaders/simple_texture_mapped.vert -o shaders/simple_texture_mapped.vert.spv
+/usr/local/bin/glslc -DIVR_COMPRESSED_VERTICES shaders/simple_texture_mapped.vert -o shaders/simple_texture_mapped_compressed.vert.spv
 /usr/local/bin/glslc shaders/simple_texture_mapped.frag -o shaders/simple_texture_mapped.frag.spv
 
 /usr/local/bin/glslc shaders/cubemap.vert -o shaders/cubemap.vert.spv
-/usr/local/bin/glslc shaders/cubemap.frag -o shaders/cubemap.frag.spv
\ No newline at end of file
+/usr/local/bin/glslc shaders/cubemap.frag -o shaders/cubemap.frag.spv
+
+/usr/local/bin/glslc shaders/shadow_map.vert -o shaders/shadow_map.vert.spv
+/usr/local/bin/glslc shaders/shadow_map.frag -o shaders/shadow_map.frag.spv
\ No newline at end of file
@@ -14,14 +14,18 @@ layout(binding=1) uniform LightUniformBufferObject {
 
 layout(binding=3) uniform sampler2D diffuse_tex_sampler;
 
-layout(binding=4) uniform MaterialUniformBufferObject {
-    vec3 specular_color;
+struct MaterialProperties {
     float specular_power;
+    int is_cube_map;
+    vec3 specular_color;
     vec3 diffuse_color;
-    bool is_cube_map;
-} material;
+};
+
+layout(std430, binding=4) readonly buffer MaterialTable {
+    MaterialProperties materials[];
+} material_table;
 
-layout(binding = 5) uniform samplerCube cubemap;
+layout(binding = 6) uniform samplerCube cubemap;
 
 void main() {
     outColor = texture(cubemap, cube_tex_coord);
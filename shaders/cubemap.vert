@@ -1,12 +1,30 @@
 #version 450
 
 //the following binding will be referenced in the descriptor layout
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(binding = 0) uniform CameraUniformBufferObject {
     mat4 view;
     mat4 proj;
 } ubo;
 
+//first three rows of every object's model matrix
+struct ObjectTransform {
+    vec4 rows[3];
+};
+
+layout(std430, binding = 5) readonly buffer TransformBuffer {
+    ObjectTransform transforms[];
+} transform_buffer;
+
+layout(push_constant) uniform ObjectPushConstants {
+    uint transform_index;
+    uint material_index;
+} object;
+
+mat4 GetModelMatrix() {
+    ObjectTransform transform = transform_buffer.transforms[object.transform_index];
+    return transpose(mat4(transform.rows[0], transform.rows[1], transform.rows[2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
+
 layout(location=0) in vec3 inPosition; //dvec3 uses 2 slots, so the location of inColor must be 2 higher
 layout(location=1) in vec3 inNormal;
 layout(location=2) in vec2 inTexCoord;
@@ -15,7 +33,7 @@ layout(location = 0) out vec3 cube_tex_coord;
 
 void main() {
 
-    vec3 position = mat3(ubo.view * ubo.model) * inPosition.xyz; //remove translation from the view matrix
+    vec3 position = mat3(ubo.view * GetModelMatrix()) * inPosition.xyz; //remove translation from the view matrix
     gl_Position = (ubo.proj * vec4(position, 1.0)).xyzz;
     cube_tex_coord = inPosition; //the texture coordinate for the cube is the direction from the center of the cube to the vertex (this does not have to be normalized)
 }
\ No newline at end of file
@@ -1,11 +1,29 @@
 #version 450
 
 //the following binding will be referenced in the descriptor layout
-layout(binding = 0) uniform LightMVPUbo{
-    mat4 model;
+layout(binding = 0) uniform LightUbo{
     mat4 view;
     mat4 proj;
-} light_mvp;
+} light;
+
+//first three rows of every object's model matrix
+struct ObjectTransform {
+    vec4 rows[3];
+};
+
+layout(std430, binding = 1) readonly buffer TransformBuffer {
+    ObjectTransform transforms[];
+} transform_buffer;
+
+layout(push_constant) uniform ObjectPushConstants {
+    uint transform_index;
+    uint material_index;
+} object;
+
+mat4 GetModelMatrix() {
+    ObjectTransform transform = transform_buffer.transforms[object.transform_index];
+    return transpose(mat4(transform.rows[0], transform.rows[1], transform.rows[2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
 
 layout(location=0) in vec3 inPosition; //dvec3 uses 2 slots, so the location of inColor must be 2 higher
 layout(location=1) in vec3 inNormal;
@@ -16,6 +34,6 @@ layout(location=0) out vec4 frag_pos;
 
 
 void main() {
-    gl_Position = light_mvp.proj * light_mvp.view * light_mvp.model * vec4(inPosition, 1.0);
+    gl_Position = light.proj * light.view * GetModelMatrix() * vec4(inPosition, 1.0);
     frag_pos = gl_Position;
 }
\ No newline at end of file
@@ -16,17 +16,29 @@ layout(binding=1) uniform LightUniformBufferObject {
     vec3 specular_color;
 } dir_light;
 
-layout(binding=4) uniform MaterialUniformBufferObject {
+struct MaterialProperties {
     float specular_power;
     int is_cube_map;
     vec3 specular_color;
     vec3 diffuse_color;
-} material;
+};
+
+//every material's properties, indexed by the material index pushed with the draw
+layout(std430, binding=4) readonly buffer MaterialTable {
+    MaterialProperties materials[];
+} material_table;
+
+layout(push_constant) uniform ObjectPushConstants {
+    uint transform_index;
+    uint material_index;
+} object;
 
 layout(binding = 3) uniform sampler2D depth_tex_sampler;
-layout(binding = 5) uniform sampler2D tex_sampler;
+layout(binding = 6) uniform sampler2D tex_sampler;
 
 void main() {
+    MaterialProperties material = material_table.materials[object.material_index];
+
     vec3 view_direction = camera_world_pos - frag_position;
 
     vec3 halfway_vector = normalize(-normalize(dir_light.direction) + normalize(view_direction));
@@ -1,8 +1,7 @@
 #version 450
 
 //the following binding will be referenced in the descriptor layout
-layout(binding = 0) uniform UniformBufferObject {
-    mat4 model;
+layout(binding = 0) uniform CameraUniformBufferObject {
     mat4 view;
     mat4 proj;
 } ubo;
@@ -15,16 +14,52 @@ layout(binding=1) uniform LightUniformBufferObject {
     vec3 specular_color;
 } dir_light;
 
-layout(binding = 2) uniform LightMVPUbo{
-    mat4 model;
+layout(binding = 2) uniform LightViewProjUbo{
     mat4 view;
     mat4 proj;
-} light_mvp;
+} light_view_proj;
+
+//first three rows of every object's model matrix
+struct ObjectTransform {
+    vec4 rows[3];
+};
+
+layout(std430, binding = 5) readonly buffer TransformBuffer {
+    ObjectTransform transforms[];
+} transform_buffer;
+
+layout(push_constant) uniform ObjectPushConstants {
+    uint transform_index;
+    uint material_index;
+} object;
+
+mat4 GetModelMatrix() {
+    ObjectTransform transform = transform_buffer.transforms[object.transform_index];
+    return transpose(mat4(transform.rows[0], transform.rows[1], transform.rows[2], vec4(0.0, 0.0, 0.0, 1.0)));
+}
 
 layout(location=0) in vec3 inPosition; //dvec3 uses 2 slots, so the location of inColor must be 2 higher
+#ifdef IVR_COMPRESSED_VERTICES
+//octahedral encoded normal (CompressedVertex), the position is quantized but the model matrix dequantizes it
+layout(location=1) in vec2 inNormal;
+#else
 layout(location=1) in vec3 inNormal;
+#endif
 layout(location=2) in vec2 inTexCoord;
 
+vec3 GetNormal() {
+#ifdef IVR_COMPRESSED_VERTICES
+    vec3 normal = vec3(inNormal, 1.0 - abs(inNormal.x) - abs(inNormal.y));
+    //unfold the lower half of the octahedron
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+#else
+    return inNormal;
+#endif
+}
+
 layout(location = 0) out vec4 frag_position;
 layout(location = 1) out vec3 frag_normal;
 layout(location = 2) out vec2 frag_tex_coord;
@@ -38,15 +73,16 @@ const mat4 bias = mat4(
 0.5, 0.5, 0.0, 1.0 );
 
 void main() {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+    mat4 model = GetModelMatrix();
+    gl_Position = ubo.proj * ubo.view * model * vec4(inPosition, 1.0);
     
-    //frag_position = (ubo.model * vec4(inPosition, 1.0)).xyz;
-    frag_position = ubo.model * vec4(inPosition, 1.0);
-    frag_normal = (ubo.model * vec4(inNormal, 0.0)).xyz;
+    //frag_position = (model * vec4(inPosition, 1.0)).xyz;
+    frag_position = model * vec4(inPosition, 1.0);
+    frag_normal = (model * vec4(GetNormal(), 0.0)).xyz;
     frag_tex_coord = inTexCoord;
 
     camera_world_pos = (inverse(ubo.view)[3]).xyz;
 
     //for shadow mapping
-    light_space_pos = (light_mvp.proj * light_mvp.view * light_mvp.model * vec4(inPosition, 1.0));
+    light_space_pos = (light_view_proj.proj * light_view_proj.view * model * vec4(inPosition, 1.0));
 }
\ No newline at end of file
@@ -1,35 +1,182 @@
 #include "app.h"
 
-IVRApp::IVRApp()
+IVRAppOptions IVRAppOptions::ParseCommandLine(int argc, char** argv)
 {
-	Engine_ = std::make_shared<IVREngine>();
-	InputManager_ = std::make_shared<IVRInputManager>(Engine_->GetWindow());
-	World_ = std::make_shared<IVRWorld>(Engine_->GetDeviceManager(), Engine_->GetSwapchainManager()->GetImageViewCount());
+	IVRAppOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+
+		if (arg == "--headless")
+		{
+			options.EngineConfig.IsHeadless = true;
+		}
+		else if (arg == "--frames" && has_value)
+		{
+			options.HeadlessFrameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--readback" && has_value)
+		{
+			options.ReadbackPath = argv[++i];
+			options.EngineConfig.IsReadbackEnabled = true;
+		}
+		else if (arg == "--trace" && has_value)
+		{
+			options.TracePath = argv[++i];
+			options.EngineConfig.IsProfilingEnabled = true;
+		}
+		else if (arg == "--cache-command-buffers")
+		{
+			options.EngineConfig.IsCommandBufferCachingEnabled = true;
+		}
+		else if (arg == "--dynamic-resolution" && has_value)
+		{
+			options.EngineConfig.IsDynamicResolutionEnabled = true;
+			options.EngineConfig.TargetFrameTimeMs = 1000.0f / std::stof(argv[++i]);
+		}
+		else if (arg == "--min-resolution-scale" && has_value)
+		{
+			options.EngineConfig.MinResolutionScale = std::stof(argv[++i]);
+		}
+		else if (arg == "--recording-threads" && has_value)
+		{
+			options.EngineConfig.RecordingThreadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--loading-threads" && has_value)
+		{
+			options.LoadingThreadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--present-mode" && has_value)
+		{
+			options.EngineConfig.PresentMode = IVRSwapchainManager::PresentModeFromString(argv[++i]);
+		}
+		else if (arg == "--max-queued-frames" && has_value)
+		{
+			options.EngineConfig.MaxQueuedFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--memory-report" && has_value)
+		{
+			options.EngineConfig.MemoryReportIntervalFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--memory-report-path" && has_value)
+		{
+			options.EngineConfig.MemoryReportPath = argv[++i];
+		}
+		else if (arg == "--width" && has_value)
+		{
+			options.EngineConfig.Width = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--height" && has_value)
+		{
+			options.EngineConfig.Height = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else
+		{
+			throw std::runtime_error("unknown or incomplete command line argument : " + arg +
+				"\nusage : ivr [--headless] [--frames <count>] [--readback <file.ppm>] [--trace <file.json>] [--recording-threads <count>] [--loading-threads <count>] [--cache-command-buffers] [--dynamic-resolution <target fps>] [--min-resolution-scale <scale>]"
+				" [--present-mode immediate|mailbox|fifo|fifo-relaxed] [--max-queued-frames <count>] [--memory-report <frames>] [--memory-report-path <file.json>]"
+				" [--width <px>] [--height <px>]");
+		}
+	}
+
+	if (options.EngineConfig.IsReadbackEnabled && !options.EngineConfig.IsHeadless)
+	{
+		throw std::runtime_error("--readback can only be used together with --headless");
+	}
+
+	return options;
+}
+
+IVRApp::IVRApp(IVRAppOptions options) :
+	Options_(options)
+{
+	Engine_ = std::make_shared<IVREngine>(Options_.EngineConfig);
+	if (!Engine_->IsHeadless())
+	{
+		InputManager_ = std::make_shared<IVRInputManager>(Engine_->GetWindow());
+	}
+	//the world's per frame resources (uniform buffers, descriptor sets) are duplicated per frame in flight, not per swapchain image
+	World_ = std::make_shared<IVRWorld>(Engine_->GetDeviceManager(), Engine_->GetMaxFramesInFlight(), Options_.LoadingThreadCount);
 	World_->Init(); //setting the world contents
 	Engine_->SetWorld(World_);
 	Engine_->PostWorldInit();
 	PreviousTime_ = std::chrono::high_resolution_clock::now();
 }
 
+bool IVRApp::ShouldKeepRunning(uint32_t frames_rendered)
+{
+	if (Engine_->IsHeadless())
+	{
+		return frames_rendered < Options_.HeadlessFrameCount;
+	}
+	return !glfwWindowShouldClose(Engine_->GetWindow()->GetGLFWWindow());
+}
+
 void IVRApp::Mainloop()
 {
-	while (!glfwWindowShouldClose(Engine_->GetWindow()->GetGLFWWindow()))
+	uint32_t frames_rendered = 0;
+	double total_input_to_submit_ms = 0.0;
+	std::chrono::high_resolution_clock::time_point loop_start_time = std::chrono::high_resolution_clock::now();
+
+	while (ShouldKeepRunning(frames_rendered))
 	{
+		Engine_->QueryForSwapchainIndex(); //also waits until the resources of the current frame index are free to be overwritten
+		//recording does not depend on the camera, the lights or the objects' model matrices (those live in the uniform arena and the per frame
+		//transform buffer written by the world update, only the transform and material indices are pushed while recording), so the frame is recorded first and the input is read as late as possible, right before the update and submission
+		Engine_->RecordFrame();
+
+		if (InputManager_)
+		{
+			InputManager_->PollInputs(); //there is no input when headless, the camera stays where the scene put it
+		}
+		Engine_->MarkInputSampled();
+
 		CurrentTime_ = std::chrono::high_resolution_clock::now();
 		FrameTime_ = std::chrono::duration<float>(CurrentTime_ - PreviousTime_).count();
 		PreviousTime_ = CurrentTime_;
+		{
+			IVRCPUProfileScope profile_scope(Engine_->GetProfiler(), "IVRWorld::Update");
+			World_->Update(FrameTime_, Engine_->GetCurrentFrameIndex());
+		}
+		Engine_->SubmitFrame();
+		total_input_to_submit_ms += Engine_->GetLastInputToSubmitMs();
+		frames_rendered++;
+	}
+
+	//frames may still be in flight when the window closes, let them finish before anything gets destroyed
+	vkDeviceWaitIdle(Engine_->GetDeviceManager()->GetLogicalDevice());
+	Engine_->GetDeviceManager()->GetDeletionQueue()->DestroyAll();
+	Engine_->GetDeviceManager()->GetDeletionQueue()->LogStats();
+
+	if (!Options_.TracePath.empty())
+	{
+		Engine_->GetProfiler()->WriteChromeTrace(Options_.TracePath);
+	}
+
+	if (frames_rendered > 0)
+	{
+		IVR_LOG_INFO("Average input to submit latency : {:.3f} ms", total_input_to_submit_ms / frames_rendered);
+	}
+
+	if (Engine_->IsHeadless())
+	{
+		float total_time = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - loop_start_time).count();
+		IVR_LOG_INFO("Rendered {} headless frames in {:.3f} s ({:.3f} ms per frame)", frames_rendered, total_time,
+			frames_rendered > 0 ? 1000.0f * total_time / frames_rendered : 0.0f);
 
-		uint32_t current_swapchain_index = Engine_->QueryForSwapchainIndex();
-		InputManager_->PollInputs();
-		World_->Update(FrameTime_, current_swapchain_index);
-		Engine_->DrawFrame();
+		if (!Options_.ReadbackPath.empty() && frames_rendered > 0)
+		{
+			Engine_->SaveLastFrame(Options_.ReadbackPath);
+		}
 	}
 }
 
 
-int main()
+int main(int argc, char** argv)
 {
-	IVRApp app;
+	IVRApp app(IVRAppOptions::ParseCommandLine(argc, argv));
 	app.Mainloop();
 	return 0;
-}
\ No newline at end of file
+}
@@ -29,8 +29,26 @@ void IVRCamera::SetPosition(glm::vec3 position)
     CameraPosition_ = position;
 }
 
+void IVRCamera::LookAt(glm::vec3 position, glm::vec3 target)
+{
+    CameraPosition_ = position;
+    CameraDirection_ = glm::normalize(target - position);
+
+    //keep yaw and pitch in sync so that input driven movement continues from this orientation
+    Pitch = glm::degrees(asin(CameraDirection_.y));
+    Yaw = glm::degrees(atan2(CameraDirection_.z, CameraDirection_.x));
+
+    CameraRight_ = glm::cross(CameraDirection_, WorldUp_);
+    CameraUp_ = glm::cross(CameraRight_, CameraDirection_);
+}
+
 void IVRCamera::MoveCamera(float dt)
 {
+    if (!IsInputEnabled)
+    {
+        return;
+    }
+
     int XOffset = IVRMouseStatus::MouseX_ - PreviousMouseX;
     int YOffset = IVRMouseStatus::MouseY_ - PreviousMouseY;
     PreviousMouseX = IVRMouseStatus::MouseX_;
@@ -0,0 +1,83 @@
+#include "camera_path.h"
+
+#include <fstream>
+#include <cmath>
+#include <stdexcept>
+
+#include "json.hpp"
+
+IVRCameraPath::IVRCameraPath(std::vector<IVRCameraPathPoint> points) :
+	Points_(points)
+{
+	if (Points_.size() < 2)
+	{
+		throw std::runtime_error("a camera path needs at least 2 points");
+	}
+}
+
+IVRCameraPath IVRCameraPath::LoadFromJson(const std::string& file_path)
+{
+	std::ifstream path_file(file_path);
+	if (!path_file.is_open())
+	{
+		throw std::runtime_error("failed to open camera path file : " + file_path);
+	}
+	nlohmann::json path_json_data = nlohmann::json::parse(path_file);
+
+	std::vector<IVRCameraPathPoint> points;
+	for (uint32_t i = 0; i < path_json_data.size(); i++)
+	{
+		nlohmann::json point_data = path_json_data[i];
+
+		IVRCameraPathPoint point;
+		point.Position = glm::vec3(point_data["position"][0], point_data["position"][1], point_data["position"][2]);
+		point.Target = glm::vec3(point_data["target"][0], point_data["target"][1], point_data["target"][2]);
+		points.push_back(point);
+	}
+
+	return IVRCameraPath(points);
+}
+
+IVRCameraPath IVRCameraPath::CreateOrbit(glm::vec3 center, float radius, float height, uint32_t point_count)
+{
+	std::vector<IVRCameraPathPoint> points;
+	for (uint32_t i = 0; i < point_count; i++)
+	{
+		float angle = 2.0f * 3.14159265f * i / point_count;
+
+		IVRCameraPathPoint point;
+		point.Position = center + glm::vec3(radius * cos(angle), height, radius * sin(angle));
+		point.Target = center;
+		points.push_back(point);
+	}
+
+	return IVRCameraPath(points);
+}
+
+glm::vec3 IVRCameraPath::CatmullRom(glm::vec3 p0, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+
+	return ((p1 * 2.0f) + (p2 - p0) * t + (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * t2 + (p1 * 3.0f - p0 - p2 * 3.0f + p3) * t3) * 0.5f;
+}
+
+IVRCameraPathPoint IVRCameraPath::Evaluate(float t)
+{
+	uint32_t point_count = static_cast<uint32_t>(Points_.size());
+
+	//the path is closed, so the segment after the last point goes back to the first one
+	float scaled_t = (t - floor(t)) * point_count;
+	uint32_t segment = static_cast<uint32_t>(scaled_t) % point_count;
+	float local_t = scaled_t - floor(scaled_t);
+
+	const IVRCameraPathPoint& p0 = Points_[(segment + point_count - 1) % point_count];
+	const IVRCameraPathPoint& p1 = Points_[segment];
+	const IVRCameraPathPoint& p2 = Points_[(segment + 1) % point_count];
+	const IVRCameraPathPoint& p3 = Points_[(segment + 2) % point_count];
+
+	IVRCameraPathPoint point;
+	point.Position = CatmullRom(p0.Position, p1.Position, p2.Position, p3.Position, local_t);
+	point.Target = CatmullRom(p0.Target, p1.Target, p2.Target, p3.Target, local_t);
+	return point;
+}
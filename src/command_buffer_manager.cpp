@@ -1,13 +1,19 @@
 #include "command_buffer_manager.h"
 
-IVRCBManager::IVRCBManager(std::shared_ptr<IVRDeviceManager> device_manager) :
-    DeviceManager_(device_manager)
+IVRCBManager::IVRCBManager(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight) :
+    FramesInFlight_(frames_in_flight), DeviceManager_(device_manager)
 {
-    CreateCommandPool();
-	CreateCommandBuffer();
+    CreateCommandPools();
+	CreateCommandBuffers();
 } 
 
-void IVRCBManager::CreateCommandPool()
+IVRCBManager::~IVRCBManager()
+{
+    DestroySecondaryCommandPools();
+    DestroyCommandPools();
+}
+
+void IVRCBManager::CreateCommandPools()
 {
     VkCommandPoolCreateInfo pool_info{};
     pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
@@ -15,52 +21,176 @@ void IVRCBManager::CreateCommandPool()
     //we will record a command buffer every frame, so we want to be able to reset and rerecord over it. Therefore we are using the above bit.
     pool_info.queueFamilyIndex = DeviceManager_->GetDeviceQueueFamilies().graphicsFamily;
 
+    //each frame in flight gets its own pool so that resetting one frame never touches memory the gpu may still be reading for another
+    CommandPools_.resize(FramesInFlight_);
+
     //Command buffers are executed by submitting them on one of the device queues (like the graphics and presentation queues we retrieved)
-    if(vkCreateCommandPool(DeviceManager_->GetLogicalDevice(), &pool_info, nullptr, &CommandPool_) != VK_SUCCESS)
+    for (uint32_t i = 0; i < FramesInFlight_; i++)
     {
-        throw std::runtime_error("failed to create command pool!");
+        if(vkCreateCommandPool(DeviceManager_->GetLogicalDevice(), &pool_info, nullptr, &CommandPools_[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to create command pool!");
+        }
     }
 
 }
 
-void IVRCBManager::DestroyCommandPool()
+void IVRCBManager::DestroyCommandPools()
 {
-    vkDestroyCommandPool(DeviceManager_->GetLogicalDevice(), CommandPool_, nullptr);
+    //destroying a pool frees all the command buffers allocated from it
+    for (VkCommandPool command_pool : CommandPools_)
+    {
+        vkDestroyCommandPool(DeviceManager_->GetLogicalDevice(), command_pool, nullptr);
+    }
+    CommandPools_.clear();
+    CommandBuffers_.clear();
 }
 
-void IVRCBManager::CreateCommandBuffer()
+void IVRCBManager::CreateCommandBuffers()
 {
-    VkCommandBufferAllocateInfo alloc_info{};
-    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    alloc_info.commandPool = CommandPool_;
-    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; //can be submitted to a queue for execution, but cannot be called from other command buffers 
-    // (SECONDARY cannot be submitted directly but can be called primary command buffers)
-    alloc_info.commandBufferCount = 1;
-
-    if(vkAllocateCommandBuffers(DeviceManager_->GetLogicalDevice(), &alloc_info, &CommandBuffer_) != VK_SUCCESS)
+    CommandBuffers_.resize(FramesInFlight_);
+
+    for (uint32_t i = 0; i < FramesInFlight_; i++)
     {
-        throw std::runtime_error("failed to allocate command buffer!");
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.commandPool = CommandPools_[i];
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; //can be submitted to a queue for execution, but cannot be called from other command buffers 
+        // (SECONDARY cannot be submitted directly but can be called primary command buffers)
+        alloc_info.commandBufferCount = 1;
+
+        if(vkAllocateCommandBuffers(DeviceManager_->GetLogicalDevice(), &alloc_info, &CommandBuffers_[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate command buffer!");
+        }
     }
 }
 
-void IVRCBManager::StartCommandBuffer()
+void IVRCBManager::ResetCommandBuffer(uint32_t frame_index)
+{
+    //only safe once the in flight fence of this frame has been waited on
+    vkResetCommandBuffer(CommandBuffers_[frame_index], 0);
+}
+
+void IVRCBManager::StartCommandBuffer(uint32_t frame_index)
 {
     VkCommandBufferBeginInfo begin_info{};
 	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	begin_info.flags = 0; //optional
 	begin_info.pInheritanceInfo = nullptr; //optional
-    if (vkBeginCommandBuffer(CommandBuffer_, &begin_info) != VK_SUCCESS)
+    if (vkBeginCommandBuffer(CommandBuffers_[frame_index], &begin_info) != VK_SUCCESS)
     {
 		throw std::runtime_error("failed to begin recording command buffer");
 	}
 }
 
-void IVRCBManager::EndCommandBuffer()
+void IVRCBManager::EndCommandBuffer(uint32_t frame_index)
 {
-    if(vkEndCommandBuffer(CommandBuffer_) != VK_SUCCESS)
+    if(vkEndCommandBuffer(CommandBuffers_[frame_index]) != VK_SUCCESS)
 		throw std::runtime_error("failed to record command buffer");
 }
 
+void IVRCBManager::CreateSecondaryCommandPools(uint32_t thread_count)
+{
+    VkCommandPoolCreateInfo pool_info{};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; //no per buffer reset flag, the whole pool is reset once per frame which is cheaper
+    pool_info.queueFamilyIndex = DeviceManager_->GetDeviceQueueFamilies().graphicsFamily;
+
+    SecondaryCommandPools_.resize(FramesInFlight_, std::vector<VkCommandPool>(thread_count));
+    SecondaryCommandBuffers_.resize(FramesInFlight_, std::vector<std::vector<VkCommandBuffer>>(thread_count));
+    UsedSecondaryCommandBufferCounts_.resize(FramesInFlight_, std::vector<uint32_t>(thread_count, 0));
+
+    for (uint32_t i = 0; i < FramesInFlight_; i++)
+    {
+        for (uint32_t j = 0; j < thread_count; j++)
+        {
+            if (vkCreateCommandPool(DeviceManager_->GetLogicalDevice(), &pool_info, nullptr, &SecondaryCommandPools_[i][j]) != VK_SUCCESS)
+            {
+                throw std::runtime_error("failed to create secondary command pool!");
+            }
+        }
+    }
+}
+
+void IVRCBManager::DestroySecondaryCommandPools()
+{
+    for (std::vector<VkCommandPool>& frame_pools : SecondaryCommandPools_)
+    {
+        for (VkCommandPool command_pool : frame_pools)
+        {
+            vkDestroyCommandPool(DeviceManager_->GetLogicalDevice(), command_pool, nullptr);
+        }
+    }
+    SecondaryCommandPools_.clear();
+    SecondaryCommandBuffers_.clear();
+    UsedSecondaryCommandBufferCounts_.clear();
+}
+
+void IVRCBManager::ResetSecondaryCommandPools(uint32_t frame_index)
+{
+    for (uint32_t j = 0; j < SecondaryCommandPools_[frame_index].size(); j++)
+    {
+        //the command buffers stay allocated and are handed out again, resetting the pool only recycles their memory
+        vkResetCommandPool(DeviceManager_->GetLogicalDevice(), SecondaryCommandPools_[frame_index][j], 0);
+        UsedSecondaryCommandBufferCounts_[frame_index][j] = 0;
+    }
+}
+
+VkCommandBuffer IVRCBManager::BeginSecondaryCommandBuffer(uint32_t frame_index, uint32_t thread_index, VkRenderPass renderpass, VkFramebuffer framebuffer, bool is_reused)
+{
+    std::vector<VkCommandBuffer>& command_buffers = SecondaryCommandBuffers_[frame_index][thread_index];
+    uint32_t& used_count = UsedSecondaryCommandBufferCounts_[frame_index][thread_index];
+
+    if (used_count == command_buffers.size())
+    {
+        VkCommandBufferAllocateInfo alloc_info{};
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.commandPool = SecondaryCommandPools_[frame_index][thread_index];
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY; //executed from a primary command buffer with vkCmdExecuteCommands
+        alloc_info.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer;
+        if (vkAllocateCommandBuffers(DeviceManager_->GetLogicalDevice(), &alloc_info, &command_buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to allocate secondary command buffer!");
+        }
+        command_buffers.push_back(command_buffer);
+    }
+
+    VkCommandBuffer command_buffer = command_buffers[used_count++];
+
+    //the renderpass is begun on the primary command buffer, the secondary only records draws inside of it
+    VkCommandBufferInheritanceInfo inheritance_info{};
+    inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance_info.renderPass = renderpass;
+    inheritance_info.subpass = 0;
+    inheritance_info.framebuffer = framebuffer;
+
+    VkCommandBufferBeginInfo begin_info{};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    if (!is_reused)
+    {
+        begin_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    }
+    //no SIMULTANEOUS_USE needed for reused buffers, they belong to one frame index and its fence guarantees the previous execution is done
+    begin_info.pInheritanceInfo = &inheritance_info;
+
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to begin recording secondary command buffer");
+    }
+
+    return command_buffer;
+}
+
+void IVRCBManager::EndSecondaryCommandBuffer(VkCommandBuffer command_buffer)
+{
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to record secondary command buffer");
+}
+
 //void IVRCBManager::RecordCommandBuffer(VkCommandBuffer command_buffer, uint32_t image_index, 
 //                                        VkRenderPass renderpass, std::shared_ptr<IVRSwapchainManager> swapchain_manager,
 //                                        VkPipeline graphics_pipeline, std::shared_ptr<IVRModel> model)
@@ -0,0 +1,118 @@
+#include "deletion_queue.h"
+
+IVRDeletionQueue::IVRDeletionQueue(VkDevice logical_device, std::shared_ptr<IVRMemoryAllocator> allocator) :
+	LogicalDevice_(logical_device), Allocator_(allocator), SubmittedFrameCount_(0), DestroyedCount_(0)
+{
+}
+
+IVRDeletionQueue::~IVRDeletionQueue()
+{
+	DestroyAll();
+}
+
+void IVRDeletionQueue::Release(std::function<void()> destroy)
+{
+	std::lock_guard<std::mutex> lock(Mutex_);
+	Entries_.push_back({ SubmittedFrameCount_ + 1, std::move(destroy) });
+}
+
+void IVRDeletionQueue::ReleaseBuffer(VkBuffer buffer, const IVRAllocation& allocation)
+{
+	Release([this, buffer, buffer_allocation = allocation]() mutable {
+		IVRBufferUtilities::Destroy(Allocator_, buffer, buffer_allocation);
+	});
+}
+
+void IVRDeletionQueue::ReleaseImage(VkImage image, const IVRAllocation& allocation)
+{
+	Release([this, image, image_allocation = allocation]() mutable {
+		IVRImageUtils::DestroyImage(Allocator_, image, image_allocation);
+	});
+}
+
+void IVRDeletionQueue::ReleaseImageView(VkImageView image_view)
+{
+	Release([this, image_view]() {
+		vkDestroyImageView(LogicalDevice_, image_view, nullptr);
+	});
+}
+
+void IVRDeletionQueue::ReleaseSampler(VkSampler sampler)
+{
+	Release([this, sampler]() {
+		vkDestroySampler(LogicalDevice_, sampler, nullptr);
+	});
+}
+
+void IVRDeletionQueue::ReleasePipeline(VkPipeline pipeline)
+{
+	Release([this, pipeline]() {
+		vkDestroyPipeline(LogicalDevice_, pipeline, nullptr);
+	});
+}
+
+void IVRDeletionQueue::ReleasePipelineLayout(VkPipelineLayout pipeline_layout)
+{
+	Release([this, pipeline_layout]() {
+		vkDestroyPipelineLayout(LogicalDevice_, pipeline_layout, nullptr);
+	});
+}
+
+void IVRDeletionQueue::ReleaseDescriptorSets(VkDescriptorPool descriptor_pool, const std::vector<VkDescriptorSet>& descriptor_sets)
+{
+	Release([this, descriptor_pool, descriptor_sets]() {
+		vkFreeDescriptorSets(LogicalDevice_, descriptor_pool, static_cast<uint32_t>(descriptor_sets.size()), descriptor_sets.data());
+	});
+}
+
+void IVRDeletionQueue::SetSubmittedFrameCount(uint64_t submitted_frame_count)
+{
+	std::lock_guard<std::mutex> lock(Mutex_);
+	SubmittedFrameCount_ = submitted_frame_count;
+}
+
+void IVRDeletionQueue::Collect(uint64_t completed_frame_count)
+{
+	//the destroy functions run outside the lock, they may free memory from the allocator (which has its own)
+	std::vector<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock(Mutex_);
+		while (!Entries_.empty() && Entries_.front().FrameValue <= completed_frame_count)
+		{
+			ready.push_back(std::move(Entries_.front().Destroy));
+			Entries_.pop_front();
+		}
+	}
+
+	for (std::function<void()>& destroy : ready)
+	{
+		destroy();
+	}
+	DestroyedCount_ += ready.size();
+}
+
+void IVRDeletionQueue::DestroyAll()
+{
+	std::deque<Entry> entries;
+	{
+		std::lock_guard<std::mutex> lock(Mutex_);
+		entries.swap(Entries_);
+	}
+
+	for (Entry& entry : entries)
+	{
+		entry.Destroy();
+	}
+	DestroyedCount_ += entries.size();
+}
+
+size_t IVRDeletionQueue::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(Mutex_);
+	return Entries_.size();
+}
+
+void IVRDeletionQueue::LogStats()
+{
+	IVR_LOG_INFO("Deletion queue : {} resources waiting for their frames to finish, {} destroyed", GetPendingCount(), DestroyedCount_);
+}
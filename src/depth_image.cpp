@@ -1,7 +1,7 @@
 #include "depth_image.h"
 
-IVRDepthImage::IVRDepthImage(std::shared_ptr<IVRDeviceManager> device_manager, VkExtent2D depth_image_extent) :
-     DeviceManager_{device_manager}, DepthImageExtent_{ depth_image_extent }
+IVRDepthImage::IVRDepthImage(std::shared_ptr<IVRDeviceManager> device_manager, VkExtent2D depth_image_extent, IVRMemoryCategory category) :
+     DeviceManager_{device_manager}, DepthImageExtent_{ depth_image_extent }, Category_{ category }
 {
     CreateDepthResources();
 }
@@ -19,9 +19,9 @@ void IVRDepthImage::CreateDepthResources()
     VkFormat depth_format = FindDepthFormat();
 
     IVRImageUtils::CreateImageAndBindMemory(
-        DeviceManager_->GetLogicalDevice(), DeviceManager_->GetPhysicalDevice(), DepthImageExtent_.width, DepthImageExtent_.height, depth_format, 1,
+        DeviceManager_->GetMemoryAllocator(), DepthImageExtent_.width, DepthImageExtent_.height, depth_format, 1,
         VK_IMAGE_TILING_OPTIMAL, 0, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        DepthImage_, DepthImageMemory_);
+        Category_, DepthImage_, DepthImageAllocation_);
     
     IVRImageUtils::CreateImageView(DeviceManager_->GetLogicalDevice(), DepthImage_, depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_VIEW_TYPE_2D, 1, DepthImageView_);
     
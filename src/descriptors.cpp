@@ -1,10 +1,24 @@
 #include "descriptors.h"
 
 IVRDescriptorManager::IVRDescriptorManager(std::shared_ptr<IVRDeviceManager> device_manager) :
-	DeviceManager_(device_manager)
+	DeviceManager_(device_manager), DescriptorPool_(VK_NULL_HANDLE)
 {
 }
 
+IVRDescriptorManager::~IVRDescriptorManager()
+{
+	if (DescriptorPool_ == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	VkDevice logical_device = DeviceManager_->GetLogicalDevice();
+	VkDescriptorPool descriptor_pool = DescriptorPool_;
+	DeviceManager_->GetDeletionQueue()->Release([logical_device, descriptor_pool]() {
+		vkDestroyDescriptorPool(logical_device, descriptor_pool, nullptr);
+	});
+}
+
 VkDescriptorSetLayout IVRDescriptorManager::CreateDescriptorSetLayout(IVRDescriptorSetInfo& descriptor_set_info)
 {
 	VkDescriptorSetLayoutCreateInfo descriptor_set_layout_create_info{};
@@ -27,6 +41,8 @@ void IVRDescriptorManager::CreateDescriptorPool(std::vector<VkDescriptorPoolSize
 	descriptor_pool_create_info.poolSizeCount = static_cast<uint32_t>(descriptor_pool_sizes.size());
 	descriptor_pool_create_info.pPoolSizes = descriptor_pool_sizes.data();
 	descriptor_pool_create_info.maxSets = max_sets;
+	//lets single sets be freed (ReleaseDescriptorSets)
+	descriptor_pool_create_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
 	
 	if (vkCreateDescriptorPool(DeviceManager_->GetLogicalDevice(), &descriptor_pool_create_info, nullptr, &DescriptorPool_) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to create descriptor pool!");
@@ -50,3 +66,7 @@ VkDescriptorSet IVRDescriptorManager::CreateDescriptorSet(VkDescriptorSetLayout
 	return descriptor_set;
 }
 
+void IVRDescriptorManager::ReleaseDescriptorSets(const std::vector<VkDescriptorSet>& descriptor_sets)
+{
+	DeviceManager_->GetDeletionQueue()->ReleaseDescriptorSets(DescriptorPool_, descriptor_sets);
+}
@@ -1,4 +1,10 @@
 #include "device_setup.h"
+#include "upload_manager.h"
+#include "memory_allocator.h"
+#include "staging_ring.h"
+#include "deletion_queue.h"
+
+#include <cstring>
 
 QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
 {
@@ -20,7 +26,14 @@ QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surfa
             indices.isGraphicsFamilyIndexSet = true;
 
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, queueFamilyIndex, surface, &presentSupport);
+            if(surface != VK_NULL_HANDLE)
+            {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, queueFamilyIndex, surface, &presentSupport);
+            }
+            else
+            {
+                presentSupport = true; //headless, nothing will be presented
+            }
 
             if(presentSupport)
             {
@@ -36,6 +49,26 @@ QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surfa
         queueFamilyIndex++;
     }
 
+    //prefer a transfer family without compute support too, those are the dedicated copy engines
+    indices.transferFamily = indices.graphicsFamily;
+    int transfer_family_score = 0;
+    for(uint32_t i = 0; i < queueFamilies.size(); i++)
+    {
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
+        if(!(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            continue;
+        }
+
+        int score = (flags & VK_QUEUE_COMPUTE_BIT) ? 1 : 2;
+        if(score > transfer_family_score)
+        {
+            transfer_family_score = score;
+            indices.transferFamily = i;
+            indices.isDedicatedTransferFamily = true;
+        }
+    }
+
     //logic to find graphics queue family
     return indices;
 }
@@ -79,6 +112,23 @@ bool IVRDeviceManager::CheckDeviceExtensionSupport_(VkPhysicalDevice physical_de
     return required_extensions.empty();
 }
 
+bool IVRDeviceManager::IsDeviceExtensionAvailable_(VkPhysicalDevice physical_device, const char* extension_name)
+{
+    uint32_t extension_count = 0;
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, nullptr);
+    std::vector<VkExtensionProperties> available_extensions(extension_count);
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &extension_count, available_extensions.data());
+
+    for(const VkExtensionProperties& extension : available_extensions)
+    {
+        if(strcmp(extension.extensionName, extension_name) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 IVRDeviceManager::IVRDeviceManager()
 {
 }
@@ -88,6 +138,17 @@ IVRDeviceManager::~IVRDeviceManager()
     //vkDestroyDevice(LogicalDevice_, nullptr);
 }
 
+void IVRDeviceManager::EnableHeadlessMode()
+{
+    IsHeadless_ = true;
+    DeviceExtensions_.clear(); //the only required extension is VK_KHR_swapchain
+}
+
+bool IVRDeviceManager::IsHeadless()
+{
+    return IsHeadless_;
+}
+
 void IVRDeviceManager::PickPhysicalDevice(VkSurfaceKHR surface, VkInstance instance)
 {
     uint32_t deviceCount = 0;
@@ -125,7 +186,9 @@ void IVRDeviceManager::CreateLogicalDevice(VkSurfaceKHR surface)
     QueueFamilyIndices indices = PickedPhysicalDeviceQueueFamilyIndices_;
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+    std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily, indices.transferFamily};
+    //declared outside the loop, the create infos point to it until vkCreateDevice
+    float queuePriority = 1.0f; //vulkan allows assigning of priorities to queues to influence the scheduling of command buffer execution using floating point between 0 and 1
 
     for(uint32_t queueFamily : uniqueQueueFamilies)
     {
@@ -133,7 +196,6 @@ void IVRDeviceManager::CreateLogicalDevice(VkSurfaceKHR surface)
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = queueFamily;
         queueCreateInfo.queueCount = 1;
-        float queuePriority = 1.0f; //vulkan allows assigning of priorities to queues to influence the scheduling of command buffer execution using floating point between 0 and 1
         queueCreateInfo.pQueuePriorities = &queuePriority;
 
         queueCreateInfos.push_back(queueCreateInfo);
@@ -143,15 +205,47 @@ void IVRDeviceManager::CreateLogicalDevice(VkSurfaceKHR surface)
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE; //enable anisotropic filtering
 
+    //timeline semaphores (core in vulkan 1.2) let the engine wait on "frame N finished" without keeping a fence per frame around
+    //they are optional, without them the frame pacing falls back to the per frame fences
+    VkPhysicalDeviceProperties device_properties;
+    vkGetPhysicalDeviceProperties(PhysicalDevice_, &device_properties);
+
+    VkPhysicalDeviceVulkan12Features vulkan12_features{};
+    vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+    if(device_properties.apiVersion >= VK_API_VERSION_1_2)
+    {
+        VkPhysicalDeviceFeatures2 supported_features{};
+        supported_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported_features.pNext = &vulkan12_features;
+        vkGetPhysicalDeviceFeatures2(PhysicalDevice_, &supported_features);
+    }
+    IsTimelineSemaphoreEnabled_ = vulkan12_features.timelineSemaphore == VK_TRUE;
+
+    VkPhysicalDeviceVulkan12Features enabled_vulkan12_features{};
+    enabled_vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    enabled_vulkan12_features.timelineSemaphore = IsTimelineSemaphoreEnabled_ ? VK_TRUE : VK_FALSE;
+
+    //optional extensions are enabled on top of the required ones when the device has them
+    std::vector<const char*> enabled_extensions = DeviceExtensions_;
+    //heap budgets (vkGetPhysicalDeviceMemoryProperties2 is core in 1.1)
+    IsMemoryBudgetEnabled_ = device_properties.apiVersion >= VK_API_VERSION_1_1 &&
+        IsDeviceExtensionAvailable_(PhysicalDevice_, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if(IsMemoryBudgetEnabled_)
+    {
+        enabled_extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = IsTimelineSemaphoreEnabled_ ? &enabled_vulkan12_features : nullptr;
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pEnabledFeatures = &deviceFeatures; 
     //next, need to specify extensions and validation layers (device specific)
     //an example of a device specific extension is VK_KHR_swaphcain (there may be devices that lack this because they only support compute operations)
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(DeviceExtensions_.size());
-    createInfo.ppEnabledExtensionNames = DeviceExtensions_.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size());
+    createInfo.ppEnabledExtensionNames = enabled_extensions.data();
 
     //IMPROTANT NOTE : older implementations of Vulkan support device specific validation layers. THIS IS NO LONGER THE CASE.
     //there the following 2 lines are only for backward compatibility. These fields are ignored by up to date Vulkan implementations.
@@ -167,6 +261,13 @@ void IVRDeviceManager::CreateLogicalDevice(VkSurfaceKHR surface)
 
     vkGetDeviceQueue(LogicalDevice_, indices.graphicsFamily, 0, &GraphicsQueue_); 
     vkGetDeviceQueue(LogicalDevice_, indices.presentFamily, 0, &PresentQueue_);
+    vkGetDeviceQueue(LogicalDevice_, indices.transferFamily, 0, &TransferQueue_);
+
+    MemoryAllocator_ = std::make_shared<IVRMemoryAllocator>(LogicalDevice_, PhysicalDevice_, IsMemoryBudgetEnabled_);
+    StagingRing_ = std::make_shared<IVRStagingRing>(MemoryAllocator_, StagingRingSize_);
+    UploadManager_ = std::make_shared<IVRUploadManager>(MemoryAllocator_, StagingRing_, indices.graphicsFamily, GraphicsQueue_,
+        indices.transferFamily, TransferQueue_, IsTimelineSemaphoreEnabled_);
+    DeletionQueue_ = std::make_shared<IVRDeletionQueue>(LogicalDevice_, MemoryAllocator_);
 }
 
 VkDevice IVRDeviceManager::GetLogicalDevice()
@@ -189,6 +290,36 @@ VkQueue IVRDeviceManager::GetPresentQueue()
     return PresentQueue_;
 }
 
+VkQueue IVRDeviceManager::GetTransferQueue()
+{
+    return TransferQueue_;
+}
+
+std::shared_ptr<IVRMemoryAllocator> IVRDeviceManager::GetMemoryAllocator()
+{
+    return MemoryAllocator_;
+}
+
+std::shared_ptr<IVRStagingRing> IVRDeviceManager::GetStagingRing()
+{
+    return StagingRing_;
+}
+
+std::shared_ptr<IVRUploadManager> IVRDeviceManager::GetUploadManager()
+{
+    return UploadManager_;
+}
+
+std::shared_ptr<IVRDeletionQueue> IVRDeviceManager::GetDeletionQueue()
+{
+    return DeletionQueue_;
+}
+
+bool IVRDeviceManager::IsTimelineSemaphoreEnabled()
+{
+    return IsTimelineSemaphoreEnabled_;
+}
+
 QueueFamilyIndices IVRDeviceManager::GetDeviceQueueFamilies()
 {
     return PickedPhysicalDeviceQueueFamilyIndices_;
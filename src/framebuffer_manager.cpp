@@ -1,8 +1,8 @@
 #include "framebuffer_manager.h"
 
 IVRFramebufferManager::IVRFramebufferManager(std::shared_ptr<IVRDeviceManager> device_manager, VkRenderPass renderpass, 
-											std::shared_ptr<IVRSwapchainManager> swapchain_manager, std::shared_ptr<IVRDepthImage> depth_image) :
-								DeviceManager_(device_manager), Renderpass_(renderpass), SwapchainManager_(swapchain_manager), DepthImage_(depth_image)
+											std::vector<VkImageView> color_image_views, VkExtent2D extent, std::shared_ptr<IVRDepthImage> depth_image) :
+								DeviceManager_(device_manager), ColorImageViews_(color_image_views), Extent_(extent), DepthImage_(depth_image), Renderpass_(renderpass)
 {
 	CreateFramebuffers();
 }
@@ -17,18 +17,18 @@ void IVRFramebufferManager::CreateFramebuffers()
 	IVR_LOG_INFO("Creating Framebuffers...");
 
 	//create the framebuffers
-	Framebuffers_.resize(SwapchainManager_->GetImageViewCount());
+	Framebuffers_.resize(ColorImageViews_.size());
 	
-	for (size_t i = 0; i < SwapchainManager_->GetImageViewCount(); i++)
+	for (size_t i = 0; i < ColorImageViews_.size(); i++)
 	{
-		std::array<VkImageView, 2> attachments = { SwapchainManager_->GetImageViewByIndex(i), DepthImage_->GetDepthImageView()};
+		std::array<VkImageView, 2> attachments = { ColorImageViews_[i], DepthImage_->GetDepthImageView()};
 		VkFramebufferCreateInfo framebuffer_info = {};
 		framebuffer_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		framebuffer_info.renderPass = Renderpass_;
 		framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
 		framebuffer_info.pAttachments = attachments.data();
-		framebuffer_info.width = SwapchainManager_->GetSwapchainExtent().width;
-		framebuffer_info.height = SwapchainManager_->GetSwapchainExtent().height;
+		framebuffer_info.width = Extent_.width;
+		framebuffer_info.height = Extent_.height;
 		framebuffer_info.layers = 1;
 		
 		if (vkCreateFramebuffer(DeviceManager_->GetLogicalDevice(), &framebuffer_info, nullptr, &Framebuffers_[i]) != VK_SUCCESS)
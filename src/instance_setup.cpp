@@ -22,6 +22,11 @@ void IVRInstanceManager::EnableValidationLayersForInstanceCreation()
     EnableValidationLayers_ = true;
 }
 
+void IVRInstanceManager::EnableHeadlessMode()
+{
+    IsHeadless_ = true;
+}
+
 VkInstance IVRInstanceManager::CreateVulkanInstance()
 {
     if(EnableValidationLayers_ && !CheckValidationLayerSupport())
@@ -36,7 +41,7 @@ VkInstance IVRInstanceManager::CreateVulkanInstance()
     app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     app_info.pEngineName = "No Engine";
     app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    app_info.apiVersion = VK_API_VERSION_1_0;
+    app_info.apiVersion = VK_API_VERSION_1_2; //1.2 for timeline semaphores, devices that only support 1.0 still work without them
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -46,9 +51,13 @@ VkInstance IVRInstanceManager::CreateVulkanInstance()
     //GLFW has a built in function that returns the two parameters Vulkan needs:
     //  - the count of extensions       - the names of the extensions
     uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions;
+    const char** glfwExtensions = nullptr;
 
-    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    //headless rendering never creates a surface, so no window system extensions are needed (glfw is not even initialized)
+    if(!IsHeadless_)
+    {
+        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    }
 
     createInfo.enabledExtensionCount = glfwExtensionCount;
     createInfo.ppEnabledExtensionNames = glfwExtensions;
@@ -1,8 +1,27 @@
 #include "ivr_engine.h"
 
 
-IVREngine::IVREngine()
+IVREngine::IVREngine(IVREngineConfig config) :
+	Config_(config), LastScaledGPUFrameCount_(0), CurrentSwapchainImageIndex_(0), MaxFramesInFlight_(config.MaxFramesInFlight), CurrentFrameIndex_(0),
+	LastSubmittedFrameIndex_(0), SubmittedFrameCount_(0), MaxQueuedFrames_(config.MaxQueuedFrames), InputSampleTimeUs_(0.0), HasInputSample_(false),
+	LastInputToSubmitMs_(0.0), LastFrameDrawCallCount_(0)
 {
+	if (MaxFramesInFlight_ == 0)
+	{
+		throw std::runtime_error("max frames in flight must be at least 1");
+	}
+
+	//more queued frames than frames in flight is already prevented by the per frame fences
+	if (MaxQueuedFrames_ == 0 || MaxQueuedFrames_ > MaxFramesInFlight_)
+	{
+		MaxQueuedFrames_ = MaxFramesInFlight_;
+	}
+
+	if (Config_.IsReadbackEnabled && !Config_.IsHeadless)
+	{
+		throw std::runtime_error("readback is only supported in headless mode");
+	}
+
 	InitEngine();
 }
 
@@ -13,70 +32,254 @@ void IVREngine::InitEngine()
 
 	IVR_LOG_INFO("Initializing Engine");
 
-	IVR_LOG_INFO("Initializing GLFW and Creating Window...");
-	Window_ = std::make_shared<IVRWindow>(2160, 1440);
-	Window_->InitWindow();
+	if (!Config_.IsHeadless)
+	{
+		IVR_LOG_INFO("Initializing GLFW and Creating Window...");
+		Window_ = std::make_shared<IVRWindow>(Config_.Width, Config_.Height);
+		Window_->InitWindow();
+	}
+	else
+	{
+		IVR_LOG_INFO("Running headless, no window will be created");
+	}
 	
 	IVR_LOG_INFO("Creating Vulkan instance...");
 	//setup instance
 	InstanceManager_ = std::make_shared<IVRInstanceManager>();
 	//InstanceManager_->EnableValidationLayersForInstanceCreation();
 	InstanceManager_->SetAppName("i Vulkan Renderer");
+	if (Config_.IsHeadless)
+	{
+		InstanceManager_->EnableHeadlessMode();
+	}
 	InstanceManager_->CreateVulkanInstance();
 	
-	IVR_LOG_INFO("Creating Vulkan Surface...");
-	Window_->CreateWindowSurface(InstanceManager_->GetInstance());
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	if (!Config_.IsHeadless)
+	{
+		IVR_LOG_INFO("Creating Vulkan Surface...");
+		Window_->CreateWindowSurface(InstanceManager_->GetInstance());
+		surface = Window_->GetVulkanSurface();
+	}
 
 	IVR_LOG_INFO("Creating Devices and Device Manager...");
 	DeviceManager_ = std::make_shared<IVRDeviceManager>();
-	DeviceManager_->PickPhysicalDevice(Window_->GetVulkanSurface(), InstanceManager_->GetInstance());
-	DeviceManager_->CreateLogicalDevice(Window_->GetVulkanSurface());
+	if (Config_.IsHeadless)
+	{
+		DeviceManager_->EnableHeadlessMode();
+	}
+	DeviceManager_->PickPhysicalDevice(surface, InstanceManager_->GetInstance());
+	DeviceManager_->CreateLogicalDevice(surface);
 
-	IVR_LOG_INFO("Creating the Swapchain...");
-	SwapchainManager_ = std::make_shared<IVRSwapchainManager>(DeviceManager_, Window_);
-	SwapchainManager_->CreateSwapchain(); //create the swapchain (chooses format, present mode and extent) (chooses the number of images in the swapchain)
-	SwapchainManager_->RetrieveSwapchainImages(); //retrieve the swapchain images and populate a vector of VkImage objects in the swapchain manager
-	SwapchainManager_->CreateImageViews(); //create the image views for the swapchain images and populate a vector of VkImageView objects in the swapchain manager
+	if (!Config_.IsHeadless)
+	{
+		CreateWindowedRenderTargets();
+	}
+	else
+	{
+		CreateHeadlessRenderTargets();
+	}
+	ScaledRenderExtent_ = RenderExtent_;
+
+	if (Config_.IsDynamicResolutionEnabled)
+	{
+		CreateScaledRenderTargets();
+	}
 
 	IVR_LOG_INFO("Creating the Depth Image...");
-	DepthImage_ = std::make_shared<IVRDepthImage>(DeviceManager_, SwapchainManager_->GetSwapchainExtent());
+	DepthImage_ = std::make_shared<IVRDepthImage>(DeviceManager_, RenderExtent_);
 
 	IVR_LOG_INFO("Creating the renderpass");
 	CreateRenderpass();
 
 	IVR_LOG_INFO("Creating the Framebuffers");
-	FramebufferManager_ = std::make_shared<IVRFramebufferManager>(DeviceManager_, Renderpass_->GetRenderpass(), SwapchainManager_, DepthImage_);
-	SyncObjectsManager_ = std::make_shared<IVRSyncObjectsManager>(DeviceManager_);
+	//with dynamic resolution the main pass draws into the scaled targets, otherwise straight into the output images
+	std::vector<VkImageView> color_image_views;
+	if (ScaledTarget_)
+	{
+		color_image_views = ScaledTarget_->GetImageViews();
+	}
+	else
+	{
+		color_image_views = Config_.IsHeadless ? OffscreenTarget_->GetImageViews() : SwapchainManager_->GetImageViews();
+	}
+	FramebufferManager_ = std::make_shared<IVRFramebufferManager>(DeviceManager_, Renderpass_->GetRenderpass(), color_image_views, RenderExtent_, DepthImage_);
+	//headless never presents, so it keeps one render finished semaphore per frame to match its offscreen images
+	uint32_t present_image_count = Config_.IsHeadless ? MaxFramesInFlight_ : SwapchainManager_->GetImageViewCount();
+	SyncObjectsManager_ = std::make_shared<IVRSyncObjectsManager>(DeviceManager_, MaxFramesInFlight_, present_image_count);
+	IVR_LOG_INFO("Frame pacing : at most {} queued frames, waiting on {}", MaxQueuedFrames_,
+		SyncObjectsManager_->FrameTimelineSemaphore != VK_NULL_HANDLE ? "a timeline semaphore" : "the per frame fences");
+
+	IVR_LOG_INFO("Creating the Command Buffers for {} frames in flight", MaxFramesInFlight_);
+	CBManager_ = std::make_shared<IVRCBManager>(DeviceManager_, MaxFramesInFlight_);
+
+	RecordingThreadPool_ = std::make_shared<IVRThreadPool>(Config_.RecordingThreadCount);
+	IVR_LOG_INFO("Recording draws on {} threads", RecordingThreadPool_->GetThreadCount());
+	CBManager_->CreateSecondaryCommandPools(RecordingThreadPool_->GetThreadCount());
+
+	ShadowPassTasks_.resize(MaxFramesInFlight_);
+	MainPassTasks_.resize(MaxFramesInFlight_);
+	IsRecordingValid_.resize(MaxFramesInFlight_, false);
+	RecordedStructureVersions_.resize(MaxFramesInFlight_, 0);
+
+	//the resolution scaler needs gpu frame times even when profiling is off
+	Profiler_ = std::make_shared<IVRProfiler>(DeviceManager_, MaxFramesInFlight_, Config_.IsProfilingEnabled, Config_.IsDynamicResolutionEnabled);
+}
+
+void IVREngine::CreateWindowedRenderTargets()
+{
+	IVR_LOG_INFO("Creating the Swapchain...");
+	SwapchainManager_ = std::make_shared<IVRSwapchainManager>(DeviceManager_, Window_, Config_.PresentMode);
+	SwapchainManager_->CreateSwapchain(); //create the swapchain (chooses format, present mode and extent) (chooses the number of images in the swapchain)
+	SwapchainManager_->RetrieveSwapchainImages(); //retrieve the swapchain images and populate a vector of VkImage objects in the swapchain manager
+	SwapchainManager_->CreateImageViews(); //create the image views for the swapchain images and populate a vector of VkImageView objects in the swapchain manager
+
+	RenderExtent_ = SwapchainManager_->GetSwapchainExtent();
+	RenderImageFormat_ = SwapchainManager_->GetSwapchainImageFormat();
+}
+
+void IVREngine::CreateHeadlessRenderTargets()
+{
+	IVR_LOG_INFO("Creating the offscreen render targets...");
+	RenderExtent_ = { Config_.Width, Config_.Height };
+	//srgb so that the stored values match what the (srgb) swapchain would have shown on screen
+	//4 bytes per texel is assumed by the readback
+	RenderImageFormat_ = VK_FORMAT_R8G8B8A8_SRGB;
+
+	//one image per frame in flight, the frame index is used as the image index (there is no acquire)
+	OffscreenTarget_ = std::make_shared<IVROffscreenTarget>(DeviceManager_, RenderExtent_, RenderImageFormat_, MaxFramesInFlight_, Config_.IsReadbackEnabled);
+}
+
+void IVREngine::CreateScaledRenderTargets()
+{
+	//the scaled image is blitted (with linear filtering) into the output image, so the format has to support both ends of a blit
+	VkFormatProperties format_properties;
+	vkGetPhysicalDeviceFormatProperties(DeviceManager_->GetPhysicalDevice(), RenderImageFormat_, &format_properties);
+	VkFormatFeatureFlags needed_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if ((format_properties.optimalTilingFeatures & needed_features) != needed_features)
+	{
+		IVR_LOG_WARNING("Render image format does not support linear blits, dynamic resolution is disabled");
+		Config_.IsDynamicResolutionEnabled = false;
+		return;
+	}
+
+	IVR_LOG_INFO("Creating the dynamic resolution targets (target frame time {:.2f} ms, min scale {:.2f})...", Config_.TargetFrameTimeMs, Config_.MinResolutionScale);
+	//allocated at the full output extent, lower scales render into the top left corner. Changing the scale never reallocates anything
+	ScaledTarget_ = std::make_shared<IVROffscreenTarget>(DeviceManager_, RenderExtent_, RenderImageFormat_, MaxFramesInFlight_, false);
+	ResolutionScaler_ = std::make_shared<IVRResolutionScaler>(Config_.TargetFrameTimeMs, Config_.MinResolutionScale);
+}
+
+void IVREngine::UpdateResolutionScale()
+{
+	if (!ResolutionScaler_ || Profiler_->GetCollectedGPUFrameCount() == LastScaledGPUFrameCount_)
+	{
+		return;
+	}
+	LastScaledGPUFrameCount_ = Profiler_->GetCollectedGPUFrameCount();
+
+	if (ResolutionScaler_->Update(Profiler_->GetLastGPUFrameTimeMs()))
+	{
+		float scale = ResolutionScaler_->GetScale();
+		ScaledRenderExtent_.width = std::max(1u, static_cast<uint32_t>(RenderExtent_.width * scale + 0.5f));
+		ScaledRenderExtent_.height = std::max(1u, static_cast<uint32_t>(RenderExtent_.height * scale + 0.5f));
+
+		//the viewport and scissor of the main pass are baked into the (cached) secondary command buffers
+		InvalidateCachedCommandBuffers();
 
-	IVR_LOG_INFO("Creating the Command Buffer");
-	CBManager_ = std::make_shared<IVRCBManager>(DeviceManager_);
+		IVR_LOG_INFO("Resolution scale {:.2f} ({}x{}), smoothed gpu frame time {:.2f} ms", scale,
+			ScaledRenderExtent_.width, ScaledRenderExtent_.height, ResolutionScaler_->GetSmoothedFrameTimeMs());
+	}
+}
+
+void IVREngine::RecordUpscaleBlit(VkCommandBuffer command_buffer)
+{
+	VkImage src_image = ScaledTarget_->GetImage(CurrentFrameIndex_);
+	VkImage dst_image = Config_.IsHeadless ? OffscreenTarget_->GetImage(CurrentSwapchainImageIndex_) : SwapchainManager_->GetSwapchainImage(CurrentSwapchainImageIndex_);
+
+	VkImageMemoryBarrier barriers[2] = {};
+	for (VkImageMemoryBarrier& barrier : barriers)
+	{
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+	}
+
+	//the main pass left the scaled image in TRANSFER_SRC_OPTIMAL, its color writes have to finish before the blit reads them
+	barriers[0].image = src_image;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	//the whole output image is overwritten, so its previous contents can be discarded
+	barriers[1].image = dst_image;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].srcAccessMask = 0;
+	barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 2, barriers);
+
+	VkImageBlit blit{};
+	blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	blit.srcSubresource.mipLevel = 0;
+	blit.srcSubresource.baseArrayLayer = 0;
+	blit.srcSubresource.layerCount = 1;
+	blit.srcOffsets[0] = { 0, 0, 0 };
+	blit.srcOffsets[1] = { static_cast<int32_t>(ScaledRenderExtent_.width), static_cast<int32_t>(ScaledRenderExtent_.height), 1 };
+	blit.dstSubresource = blit.srcSubresource;
+	blit.dstOffsets[0] = { 0, 0, 0 };
+	blit.dstOffsets[1] = { static_cast<int32_t>(RenderExtent_.width), static_cast<int32_t>(RenderExtent_.height), 1 };
+
+	vkCmdBlitImage(command_buffer, src_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+	//hand the output image over in the layout it would have had without dynamic resolution
+	VkImageMemoryBarrier present_barrier = barriers[1];
+	present_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	present_barrier.newLayout = Config_.IsHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	present_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	present_barrier.dstAccessMask = Config_.IsHeadless ? VK_ACCESS_TRANSFER_READ_BIT : 0;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, Config_.IsHeadless ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &present_barrier);
 }
 
 void IVREngine::PostWorldInit()
 {
 	IVR_LOG_INFO("Creating the shadow mapper");
-	ShadowMap_ = std::make_shared<IVRShadowMap>(DeviceManager_, World_->GetLightManager(), SwapchainManager_->GetSwapchainExtent(), SwapchainManager_->GetImageViewCount());
+	ShadowMap_ = std::make_shared<IVRShadowMap>(DeviceManager_, World_->GetLightManager(), RenderExtent_, MaxFramesInFlight_);
 	World_->InitShadowMapMaterials(ShadowMap_->GetDescriptorSetInfo());
 	World_->AssignShadowMapDepthTextures(ShadowMap_->GetDepthImages());
 	World_->PostShadowMapperInit();
 
-	World_->SetCameraAspectRatio(SwapchainManager_->GetSwapchainExtent().width / (float)SwapchainManager_->GetSwapchainExtent().height);
+	World_->SetCameraAspectRatio(RenderExtent_.width / (float)RenderExtent_.height);
 	PipelineCreator_ = std::make_shared<IVRPipelineCreator>(DeviceManager_);
 	IVR_LOG_INFO("Creating Pipelines...");
 	CreatePipelines();
+
+	//everything the scene needs is allocated at this point
+	DeviceManager_->GetMemoryAllocator()->LogStats();
 }
 
 void IVREngine::CreateRenderpass()
 {
 	VkAttachmentDescription color_attachment_description{};
-	color_attachment_description.format = SwapchainManager_->GetSwapchainImageFormat();
+	color_attachment_description.format = RenderImageFormat_;
 	color_attachment_description.samples = VK_SAMPLE_COUNT_1_BIT;
 	color_attachment_description.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	color_attachment_description.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	color_attachment_description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	color_attachment_description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	color_attachment_description.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment_description.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	//headless images are never presented, they end the pass ready to be copied out for readback
+	//scaled images are blitted into the output image after the pass
+	color_attachment_description.finalLayout = Config_.IsHeadless || ScaledTarget_ ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkAttachmentDescription depth_attachment_description{};
 	depth_attachment_description.format = DepthImage_->FindDepthFormat();
@@ -103,134 +306,493 @@ void IVREngine::CreatePipelines()
 	for (std::shared_ptr<IVRBaseMaterial>& base_material : World_->GetBaseMaterials())
 	{
 
-		IVRFixedFunctionPipelineConfig pipeline_config(SwapchainManager_->GetSwapchainExtent());
+		IVRFixedFunctionPipelineConfig pipeline_config(RenderExtent_);
 		base_material->UpdatePipelineConfigBasedOnMaterialProperties(pipeline_config);
 
-		VkPipelineLayout pipeline_layout = PipelineCreator_->CreatePipelineLayout(base_material->GetDescriptorSetLayout());
+		VkPipelineLayout pipeline_layout = PipelineCreator_->CreatePipelineLayout(base_material->GetDescriptorSetLayout(), { base_material->GetPushConstantRange() });
 		VkPipeline pipeline = PipelineCreator_->CreatePipeline(Renderpass_->GetRenderpass(), pipeline_config,
 			pipeline_layout, base_material->GetVertexShaderPath(), base_material->GetFragmentShaderPath());
 
+		//pipelines being recreated may still be bound by the frames in flight
+		if (base_material->GetPipeline() != VK_NULL_HANDLE)
+		{
+			DeviceManager_->GetDeletionQueue()->ReleasePipeline(base_material->GetPipeline());
+			DeviceManager_->GetDeletionQueue()->ReleasePipelineLayout(base_material->GetPipelineLayout());
+		}
+
 		base_material->SetPipeline(pipeline);
 		base_material->SetPipelineLayout(pipeline_layout);
 	}
+
+	//the cached secondary command buffers bind the old pipelines
+	InvalidateCachedCommandBuffers();
 }
 
 
 void IVREngine::DrawFrame()
 {
-	vkResetCommandBuffer(CBManager_->GetCommandBuffer(), 0);
-	
-	CBManager_->StartCommandBuffer();
+	RecordFrame();
+	SubmitFrame();
+}
 
-	VkViewport viewport{};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)SwapchainManager_->GetSwapchainExtent().width;
-	viewport.height = (float)SwapchainManager_->GetSwapchainExtent().height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(CBManager_->GetCommandBuffer(), 0, 1, &viewport);
+void IVREngine::RecordFrame()
+{
+	VkCommandBuffer command_buffer = CBManager_->GetCommandBuffer(CurrentFrameIndex_);
 
-	VkRect2D scissor{};
-	scissor.offset = { 0, 0 };
-	scissor.extent = SwapchainManager_->GetSwapchainExtent();
-	vkCmdSetScissor(CBManager_->GetCommandBuffer(), 0, 1, &scissor);
+	IVRCPUProfileScope record_scope(Profiler_, "DrawFrame::Record");
 
-	//shadow map rendering
-	ShadowMap_->BeginRenderPass(CBManager_->GetCommandBuffer(), CurrentSwapchainImageIndex_);
-	vkCmdBindPipeline(CBManager_->GetCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, ShadowMap_->GetPipeline());
+	CBManager_->ResetCommandBuffer(CurrentFrameIndex_);
+	CBManager_->StartCommandBuffer(CurrentFrameIndex_);
+	Profiler_->BeginFrame(command_buffer, CurrentFrameIndex_);
+	LastFrameDrawCallCount_ = 0;
+
+	UpdateResolutionScale();
 
-	for (std::shared_ptr<IVRRenderObject> render_object : World_->GetRenderObjects())
+	//with command buffer caching the secondary command buffers of a frame index are only re-recorded when something baked into them changed
+	//camera, lights, material properties and model matrices live in buffers, so updating them does not require re-recording
+	//(the dynamic offsets into the uniform arena and the transform and material indices pushed with the draws do not change
+	//from frame to frame)
+	bool is_recording_needed = !Config_.IsCommandBufferCachingEnabled || !IsRecordingValid_[CurrentFrameIndex_] ||
+		RecordedStructureVersions_[CurrentFrameIndex_] != World_->GetStructureVersion();
+	if (is_recording_needed)
 	{
-		VkDescriptorSet sm_descriptor_set[] = { render_object->GetShadowmapMaterial()->GetDescriptorSet(CurrentSwapchainImageIndex_)};
-		vkCmdBindDescriptorSets(CBManager_->GetCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, ShadowMap_->GetPipelineLayout(), 0, 1, sm_descriptor_set, 0, nullptr);
+		RecordSecondaryCommandBuffers(CurrentFrameIndex_);
+	}
 
-		VkBuffer vertex_buffers[] = { render_object->GetModel()->GetVertexBuffer() };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(CBManager_->GetCommandBuffer(), 0, 1, vertex_buffers, offsets);
-		vkCmdBindIndexBuffer(CBManager_->GetCommandBuffer(), render_object->GetModel()->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+	std::vector<RecordingTask>& shadow_tasks = ShadowPassTasks_[CurrentFrameIndex_];
+	std::vector<RecordingTask>& main_tasks = MainPassTasks_[CurrentFrameIndex_];
+	VkFramebuffer main_framebuffer = FramebufferManager_->GetFramebuffer(GetMainFramebufferIndex());
 
-		vkCmdDrawIndexed(CBManager_->GetCommandBuffer(), render_object->GetModel()->Indices.size(), 1, 0, 0, 0);
+	//shadow map rendering
+	Profiler_->BeginGPUScope(command_buffer, CurrentFrameIndex_, "ShadowPass");
+	ShadowMap_->BeginRenderPass(command_buffer, CurrentFrameIndex_, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	ExecuteRecordingTasks(command_buffer, shadow_tasks);
+	ShadowMap_->EndRenderPass(command_buffer);
+	Profiler_->EndGPUScope(command_buffer, CurrentFrameIndex_);
+
+	Profiler_->BeginGPUScope(command_buffer, CurrentFrameIndex_, "MainPass");
+	Renderpass_->BeginRenderPass(command_buffer, main_framebuffer, ScaledRenderExtent_, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	ExecuteRecordingTasks(command_buffer, main_tasks);
+	Renderpass_->EndRenderPass(command_buffer);
+	Profiler_->EndGPUScope(command_buffer, CurrentFrameIndex_);
+
+	if (ScaledTarget_)
+	{
+		Profiler_->BeginGPUScope(command_buffer, CurrentFrameIndex_, "Upscale");
+		RecordUpscaleBlit(command_buffer);
+		Profiler_->EndGPUScope(command_buffer, CurrentFrameIndex_);
 	}
-	ShadowMap_->EndRenderPass(CBManager_->GetCommandBuffer());
-
-	Renderpass_->BeginRenderPass(CBManager_->GetCommandBuffer(), FramebufferManager_->GetFramebuffer(CurrentSwapchainImageIndex_), SwapchainManager_->GetSwapchainExtent());
 
-	for (std::unordered_map<std::shared_ptr<IVRBaseMaterial>, std::vector<std::shared_ptr<IVRRenderObject>>>::iterator iter = World_->GetBaseMaterialRenderObjectMap().begin();
-		iter != World_->GetBaseMaterialRenderObjectMap().end(); ++iter)
+	if (Config_.IsHeadless && OffscreenTarget_->IsReadbackEnabled())
 	{
-		std::shared_ptr<IVRBaseMaterial> base_material = iter->first;
-		std::vector<std::shared_ptr<IVRRenderObject>> render_objects = iter->second;
+		OffscreenTarget_->RecordReadbackCopy(command_buffer, CurrentSwapchainImageIndex_);
+	}
 
-		vkCmdBindPipeline(CBManager_->GetCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, base_material->GetPipeline());
+	CBManager_->EndCommandBuffer(CurrentFrameIndex_);
+}
 
-		for (std::shared_ptr<IVRRenderObject> render_object : render_objects) 
-		{
-			VkBuffer vertex_buffers[] = { render_object->GetModel()->GetVertexBuffer() }; 
-			VkDeviceSize offsets[] = { 0 };
-			
-			vkCmdBindVertexBuffers(CBManager_->GetCommandBuffer(), 0, 1, vertex_buffers, offsets);
-			vkCmdBindIndexBuffer(CBManager_->GetCommandBuffer(), render_object->GetModel()->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
-			
-			VkDescriptorSet descriptor_sets[] = { render_object->GetMaterialInstance()->GetDescriptorSet(CurrentSwapchainImageIndex_)};
-			vkCmdBindDescriptorSets(CBManager_->GetCommandBuffer(), VK_PIPELINE_BIND_POINT_GRAPHICS, base_material->GetPipelineLayout(), 0, 1, descriptor_sets, 0, nullptr);
-			
-			vkCmdDrawIndexed(CBManager_->GetCommandBuffer(), render_object->GetModel()->Indices.size(), 1, 0, 0, 0);
-		}
-	}
+void IVREngine::SubmitFrame()
+{
+	VkCommandBuffer command_buffer = CBManager_->GetCommandBuffer(CurrentFrameIndex_);
 
-	Renderpass_->EndRenderPass(CBManager_->GetCommandBuffer());
-	CBManager_->EndCommandBuffer();
+	IVRCPUProfileScope submit_scope(Profiler_, "DrawFrame::Submit");
 
 	VkSubmitInfo submit_info{};
 	submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore wait_semaphores[] = { SyncObjectsManager_->ImageAvailableSemaphore };
-	VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	VkSemaphore wait_semaphores[] = { SyncObjectsManager_->ImageAvailableSemaphores[CurrentFrameIndex_] };
+	//with dynamic resolution the first write to the swapchain image is the blit, not the color attachment output
+	VkPipelineStageFlags wait_stages[] = { ScaledTarget_ ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
-	submit_info.waitSemaphoreCount = 1;
+	//headless frames have no swapchain image to wait for and nothing to present, the fence is the only sync needed
+	submit_info.waitSemaphoreCount = Config_.IsHeadless ? 0 : 1;
 	submit_info.pWaitSemaphores = wait_semaphores;
 	submit_info.pWaitDstStageMask = wait_stages;
 
 	submit_info.commandBufferCount = 1;
-	VkCommandBuffer command_buffers[] = { CBManager_->GetCommandBuffer() };
+	VkCommandBuffer command_buffers[] = { command_buffer };
 	submit_info.pCommandBuffers = command_buffers;
 
-	VkSemaphore signal_semaphores[] = { SyncObjectsManager_->RenderFinishedSemaphore };
-	submit_info.signalSemaphoreCount = 1;
-	submit_info.pSignalSemaphores = signal_semaphores;
+	VkSemaphore render_finished_semaphores[] = { SyncObjectsManager_->RenderFinishedSemaphores[CurrentSwapchainImageIndex_] };
 
-	if (vkQueueSubmit(DeviceManager_->GetGraphicsQueue(), 1, &submit_info, SyncObjectsManager_->InFlightFence) != VK_SUCCESS)
+	//the timeline semaphore is set to the number of submitted frames once this one finishes, which is what the queued frame limiter waits on
+	std::vector<VkSemaphore> signal_semaphores;
+	std::vector<uint64_t> signal_values; //ignored for the binary semaphore, but every signal semaphore needs an entry
+	if (!Config_.IsHeadless)
+	{
+		signal_semaphores.push_back(render_finished_semaphores[0]);
+		signal_values.push_back(0);
+	}
+
+	VkTimelineSemaphoreSubmitInfo timeline_submit_info{};
+	if (SyncObjectsManager_->FrameTimelineSemaphore != VK_NULL_HANDLE)
+	{
+		signal_semaphores.push_back(SyncObjectsManager_->FrameTimelineSemaphore);
+		signal_values.push_back(SubmittedFrameCount_ + 1);
+
+		timeline_submit_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timeline_submit_info.signalSemaphoreValueCount = static_cast<uint32_t>(signal_values.size());
+		timeline_submit_info.pSignalSemaphoreValues = signal_values.data();
+		submit_info.pNext = &timeline_submit_info;
+	}
+
+	submit_info.signalSemaphoreCount = static_cast<uint32_t>(signal_semaphores.size());
+	submit_info.pSignalSemaphores = signal_semaphores.data();
+
+	if (vkQueueSubmit(DeviceManager_->GetGraphicsQueue(), 1, &submit_info, SyncObjectsManager_->InFlightFences[CurrentFrameIndex_]) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
+	SubmittedFrameCount_++;
+	DeviceManager_->GetDeletionQueue()->SetSubmittedFrameCount(SubmittedFrameCount_);
+	Profiler_->MarkFrameSubmitted(CurrentFrameIndex_);
+
+	if (HasInputSample_)
+	{
+		double submit_time_us = Profiler_->GetTimeUs();
+		LastInputToSubmitMs_ = (submit_time_us - InputSampleTimeUs_) / 1000.0;
+		Profiler_->RecordCPUEvent("InputToSubmit", InputSampleTimeUs_, submit_time_us - InputSampleTimeUs_);
+		HasInputSample_ = false;
+	}
+
+	if (!Config_.IsHeadless)
+	{
+		//present
+		VkPresentInfoKHR present_info{};
+		present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+		present_info.waitSemaphoreCount = 1;
+		present_info.pWaitSemaphores = render_finished_semaphores;
 
-	//present
-	VkPresentInfoKHR present_info{};
-	present_info.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		VkSwapchainKHR swapchains[] = { SwapchainManager_->GetSwapchain() };
+		present_info.swapchainCount = 1;
+		present_info.pSwapchains = swapchains;
+		present_info.pImageIndices = &CurrentSwapchainImageIndex_;
+		present_info.pResults = nullptr;
 
-	present_info.waitSemaphoreCount = 1;
-	present_info.pWaitSemaphores = signal_semaphores;
+		vkQueuePresentKHR(DeviceManager_->GetPresentQueue(), &present_info);
+	}
 
-	VkSwapchainKHR swapchains[] = { SwapchainManager_->GetSwapchain() };
-	present_info.swapchainCount = 1;
-	present_info.pSwapchains = swapchains;
-	present_info.pImageIndices = &CurrentSwapchainImageIndex_;
-	present_info.pResults = nullptr;
+	ReportMemoryUsage();
 
-	vkQueuePresentKHR(DeviceManager_->GetPresentQueue(), &present_info);
+	//move on to the next set of per frame resources, the gpu may still be working on the ones we just submitted
+	LastSubmittedFrameIndex_ = CurrentFrameIndex_;
+	CurrentFrameIndex_ = (CurrentFrameIndex_ + 1) % MaxFramesInFlight_;
+}
+
+void IVREngine::ReportMemoryUsage()
+{
+	if (Config_.MemoryReportIntervalFrames == 0 || SubmittedFrameCount_ % Config_.MemoryReportIntervalFrames != 0)
+	{
+		return;
+	}
+
+	IVRCPUProfileScope profile_scope(Profiler_, "ReportMemoryUsage");
+
+	std::shared_ptr<IVRMemoryAllocator> allocator = DeviceManager_->GetMemoryAllocator();
+	allocator->LogStats();
+	if (!Config_.MemoryReportPath.empty())
+	{
+		allocator->WriteStatsJson(Config_.MemoryReportPath);
+	}
+}
+
+void IVREngine::RecordSecondaryCommandBuffers(uint32_t frame_index)
+{
+	//draws are recorded into secondary command buffers by the recording threads, the primary command buffer only
+	//begins the renderpasses and executes them. Every task writes into its own slot so the order of execution does not depend on thread timing
+	IVRCPUProfileScope profile_scope(Profiler_, "RecordSecondaryCommandBuffers");
+
+	CBManager_->ResetSecondaryCommandPools(frame_index);
+
+	//shadow pass : chunks of all the render objects
+	std::vector<RecordingTask>& shadow_tasks = ShadowPassTasks_[frame_index];
+	shadow_tasks.clear();
+	std::vector<std::shared_ptr<IVRRenderObject>>& all_render_objects = World_->GetRenderObjects();
+	size_t shadow_chunk_size = GetRecordingChunkSize(all_render_objects.size());
+	for (size_t first = 0; first < all_render_objects.size(); first += shadow_chunk_size)
+	{
+		shadow_tasks.push_back({ nullptr, &all_render_objects, first, std::min(shadow_chunk_size, all_render_objects.size() - first) });
+	}
+
+	//main pass : one task per base material bucket, large buckets are split into chunks
+	std::vector<RecordingTask>& main_tasks = MainPassTasks_[frame_index];
+	main_tasks.clear();
+	for (std::unordered_map<std::shared_ptr<IVRBaseMaterial>, std::vector<std::shared_ptr<IVRRenderObject>>>::iterator iter = World_->GetBaseMaterialRenderObjectMap().begin();
+		iter != World_->GetBaseMaterialRenderObjectMap().end(); ++iter)
+	{
+		size_t chunk_size = GetRecordingChunkSize(iter->second.size());
+		for (size_t first = 0; first < iter->second.size(); first += chunk_size)
+		{
+			main_tasks.push_back({ iter->first, &iter->second, first, std::min(chunk_size, iter->second.size() - first) });
+		}
+	}
+
+	bool is_reused = Config_.IsCommandBufferCachingEnabled;
+	//cached main pass buffers are executed with whichever swapchain image is acquired, so they cannot name a framebuffer
+	VkFramebuffer main_framebuffer = is_reused ? VK_NULL_HANDLE : FramebufferManager_->GetFramebuffer(GetMainFramebufferIndex());
+
+	for (RecordingTask& task : shadow_tasks)
+	{
+		RecordingThreadPool_->Submit([this, &task, frame_index, is_reused](uint32_t thread_index) {
+			IVRCPUProfileScope profile_scope(Profiler_, "RecordShadowChunk");
+			task.CommandBuffer = CBManager_->BeginSecondaryCommandBuffer(frame_index, thread_index, ShadowMap_->GetRenderpass(), ShadowMap_->GetFramebuffer(frame_index), is_reused);
+			task.DrawCallCount = RecordShadowDraws(task.CommandBuffer, frame_index, *task.RenderObjects, task.First, task.Count);
+			CBManager_->EndSecondaryCommandBuffer(task.CommandBuffer);
+		});
+	}
+
+	for (RecordingTask& task : main_tasks)
+	{
+		RecordingThreadPool_->Submit([this, &task, frame_index, main_framebuffer, is_reused](uint32_t thread_index) {
+			IVRCPUProfileScope profile_scope(Profiler_, "RecordMaterialChunk");
+			task.CommandBuffer = CBManager_->BeginSecondaryCommandBuffer(frame_index, thread_index, Renderpass_->GetRenderpass(), main_framebuffer, is_reused);
+			task.DrawCallCount = RecordMaterialDraws(task.CommandBuffer, frame_index, task.BaseMaterial, *task.RenderObjects, task.First, task.Count);
+			CBManager_->EndSecondaryCommandBuffer(task.CommandBuffer);
+		});
+	}
+
+	RecordingThreadPool_->Wait();
+
+	IsRecordingValid_[frame_index] = true;
+	RecordedStructureVersions_[frame_index] = World_->GetStructureVersion();
+}
+
+size_t IVREngine::GetRecordingChunkSize(size_t object_count)
+{
+	//roughly one chunk per recording thread, but not so small that the secondary command buffer overhead dominates
+	size_t thread_count = RecordingThreadPool_->GetThreadCount();
+	return std::max(MinObjectsPerRecordingTask_, (object_count + thread_count - 1) / thread_count);
+}
+
+void IVREngine::SetViewportAndScissor(VkCommandBuffer command_buffer, VkExtent2D extent)
+{
+	//dynamic state is not inherited from the primary command buffer, every secondary command buffer has to set it
+	VkViewport viewport{};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = (float)extent.width;
+	viewport.height = (float)extent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+	VkRect2D scissor{};
+	scissor.offset = { 0, 0 };
+	scissor.extent = extent;
+	vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+}
+
+uint32_t IVREngine::RecordShadowDraws(VkCommandBuffer command_buffer, uint32_t frame_index, std::vector<std::shared_ptr<IVRRenderObject>>& render_objects, size_t first, size_t count)
+{
+	//the shadow map is not scaled, it always has the full render extent
+	SetViewportAndScissor(command_buffer, RenderExtent_);
+
+	VkShaderStageFlags push_constant_stages = ShadowMap_->GetPushConstantRange().stageFlags;
+
+	VkBuffer bound_vertex_buffer = VK_NULL_HANDLE;
+	VkIndexType bound_index_type = VK_INDEX_TYPE_MAX_ENUM;
+	VkDescriptorSet bound_descriptor_set = VK_NULL_HANDLE;
+	IVRVertexLayout bound_vertex_layout = IVRVertexLayout::Count;
+	for (size_t i = first; i < first + count; i++)
+	{
+		const std::shared_ptr<IVRRenderObject>& render_object = render_objects[i];
+
+		//every material's objects go through the shadow pass, the pipeline changes with the vertex layout of their meshes
+		IVRVertexLayout vertex_layout = render_object->GetModel()->GetVertexLayout();
+		if (vertex_layout != bound_vertex_layout)
+		{
+			vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ShadowMap_->GetPipeline(vertex_layout));
+			bound_vertex_layout = vertex_layout;
+			//the layouts have separate mesh arenas
+			bound_vertex_buffer = VK_NULL_HANDLE;
+		}
+
+		//the shadowmap material is shared, so this binds once per secondary command buffer
+		std::shared_ptr<IVRShadowmapMaterial> shadowmap_material = render_object->GetShadowmapMaterial();
+		VkDescriptorSet sm_descriptor_set = shadowmap_material->GetDescriptorSet(frame_index);
+		if (sm_descriptor_set != bound_descriptor_set)
+		{
+			uint32_t light_offset = shadowmap_material->GetLightOffset();
+			vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, ShadowMap_->GetPipelineLayout(), 0, 1, &sm_descriptor_set, 1, &light_offset);
+			bound_descriptor_set = sm_descriptor_set;
+		}
+		render_object->PushConstants(command_buffer, ShadowMap_->GetPipelineLayout(), push_constant_stages);
+
+		BindMeshArenaPage(command_buffer, render_object->GetModel(), bound_vertex_buffer, bound_index_type);
+		const IVRMeshAllocation& mesh = render_object->GetModel()->GetMeshAllocation();
+		vkCmdDrawIndexed(command_buffer, mesh.IndexCount, 1, mesh.FirstIndex, static_cast<int32_t>(mesh.VertexOffset), 0);
+	}
+
+	return static_cast<uint32_t>(count);
+}
+
+uint32_t IVREngine::RecordMaterialDraws(VkCommandBuffer command_buffer, uint32_t frame_index, std::shared_ptr<IVRBaseMaterial> base_material,
+	std::vector<std::shared_ptr<IVRRenderObject>>& render_objects, size_t first, size_t count)
+{
+	SetViewportAndScissor(command_buffer, ScaledRenderExtent_);
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, base_material->GetPipeline());
+	VkShaderStageFlags push_constant_stages = base_material->GetPushConstantRange().stageFlags;
+
+	VkBuffer bound_vertex_buffer = VK_NULL_HANDLE;
+	VkIndexType bound_index_type = VK_INDEX_TYPE_MAX_ENUM;
+	for (size_t i = first; i < first + count; i++)
+	{
+		const std::shared_ptr<IVRRenderObject>& render_object = render_objects[i];
+
+		BindMeshArenaPage(command_buffer, render_object->GetModel(), bound_vertex_buffer, bound_index_type);
+		
+		std::shared_ptr<IVRMaterialInstance> material_instance = render_object->GetMaterialInstance();
+		VkDescriptorSet descriptor_sets[] = { material_instance->GetDescriptorSet(frame_index)};
+		const std::vector<uint32_t>& dynamic_offsets = material_instance->GetDynamicOffsets();
+		vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, base_material->GetPipelineLayout(), 0, 1, descriptor_sets,
+			static_cast<uint32_t>(dynamic_offsets.size()), dynamic_offsets.data());
+		render_object->PushConstants(command_buffer, base_material->GetPipelineLayout(), push_constant_stages);
+		
+		const IVRMeshAllocation& mesh = render_object->GetModel()->GetMeshAllocation();
+		vkCmdDrawIndexed(command_buffer, mesh.IndexCount, 1, mesh.FirstIndex, static_cast<int32_t>(mesh.VertexOffset), 0);
+	}
+
+	return static_cast<uint32_t>(count);
+}
+
+void IVREngine::BindMeshArenaPage(VkCommandBuffer command_buffer, std::shared_ptr<IVRModel> model, VkBuffer& bound_vertex_buffer, VkIndexType& bound_index_type)
+{
+	//models share the mesh arena's buffers, so they are only bound again when a model lives in another page
+	//or (for the index buffer) uses the other index type
+	VkBuffer vertex_buffer = model->GetVertexBuffer();
+	VkIndexType index_type = model->GetMeshAllocation().IndexType;
+	if (vertex_buffer == bound_vertex_buffer && index_type == bound_index_type)
+	{
+		return;
+	}
+
+	if (vertex_buffer != bound_vertex_buffer)
+	{
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(command_buffer, 0, 1, &vertex_buffer, offsets);
+	}
+	vkCmdBindIndexBuffer(command_buffer, model->GetIndexBuffer(), 0, index_type);
+	bound_vertex_buffer = vertex_buffer;
+	bound_index_type = index_type;
+}
+
+void IVREngine::InvalidateCachedCommandBuffers()
+{
+	std::fill(IsRecordingValid_.begin(), IsRecordingValid_.end(), false);
+}
+
+void IVREngine::ExecuteRecordingTasks(VkCommandBuffer command_buffer, std::vector<RecordingTask>& tasks)
+{
+	std::vector<VkCommandBuffer> secondary_command_buffers;
+	for (RecordingTask& task : tasks)
+	{
+		secondary_command_buffers.push_back(task.CommandBuffer);
+		LastFrameDrawCallCount_ += task.DrawCallCount;
+	}
+
+	if (!secondary_command_buffers.empty())
+	{
+		vkCmdExecuteCommands(command_buffer, static_cast<uint32_t>(secondary_command_buffers.size()), secondary_command_buffers.data());
+	}
 }
 
 uint32_t IVREngine::QueryForSwapchainIndex()
 {
-	//get next image from swapchain
-	vkWaitForFences(DeviceManager_->GetLogicalDevice(), 1, &SyncObjectsManager_->InFlightFence, VK_TRUE, UINT64_MAX);
-	vkResetFences(DeviceManager_->GetLogicalDevice(), 1, &SyncObjectsManager_->InFlightFence);
+	IVRCPUProfileScope profile_scope(Profiler_, "QueryForSwapchainIndex");
+
+	//wait until the gpu is done with the frame that last used this frame index's resources
+	//(MaxFramesInFlight_ frames ago), the other frames in flight can still be executing
+	vkWaitForFences(DeviceManager_->GetLogicalDevice(), 1, &SyncObjectsManager_->InFlightFences[CurrentFrameIndex_], VK_TRUE, UINT64_MAX);
+	vkResetFences(DeviceManager_->GetLogicalDevice(), 1, &SyncObjectsManager_->InFlightFences[CurrentFrameIndex_]);
+
+	//the timestamps written the last time this frame index was used are now guaranteed to be available
+	Profiler_->CollectGPUResults(CurrentFrameIndex_);
+
+	WaitForQueuedFrames();
+
+	//resources released while recording frames the gpu has finished can be destroyed now
+	DeviceManager_->GetDeletionQueue()->Collect(GetCompletedFrameCount());
+
+	if (Config_.IsHeadless)
+	{
+		//offscreen images are owned by the frame that uses them, so the fence above already guarantees this one is free
+		CurrentSwapchainImageIndex_ = CurrentFrameIndex_;
+		return CurrentSwapchainImageIndex_;
+	}
 
+	//get next image from swapchain
 	vkAcquireNextImageKHR(DeviceManager_->GetLogicalDevice(), SwapchainManager_->GetSwapchain(), UINT64_MAX,
-		SyncObjectsManager_->ImageAvailableSemaphore, VK_NULL_HANDLE, &CurrentSwapchainImageIndex_);
+		SyncObjectsManager_->ImageAvailableSemaphores[CurrentFrameIndex_], VK_NULL_HANDLE, &CurrentSwapchainImageIndex_);
 	
 	return CurrentSwapchainImageIndex_;
 }
 
+uint64_t IVREngine::GetCompletedFrameCount()
+{
+	if (SyncObjectsManager_->FrameTimelineSemaphore != VK_NULL_HANDLE)
+	{
+		uint64_t completed_frame_count = 0;
+		vkGetSemaphoreCounterValue(DeviceManager_->GetLogicalDevice(), SyncObjectsManager_->FrameTimelineSemaphore, &completed_frame_count);
+		return completed_frame_count;
+	}
+
+	//the fence of the current frame index has been waited for : it was last submitted by frame SubmittedFrameCount_ - MaxFramesInFlight_ + 1,
+	//and frames on the graphics queue finish in submission order
+	if (SubmittedFrameCount_ < MaxFramesInFlight_)
+	{
+		return 0;
+	}
+	return SubmittedFrameCount_ - MaxFramesInFlight_ + 1;
+}
 
+void IVREngine::WaitForQueuedFrames()
+{
+	//the fence wait above already limits the queue to MaxFramesInFlight_ frames
+	if (MaxQueuedFrames_ >= MaxFramesInFlight_ || SubmittedFrameCount_ < MaxQueuedFrames_)
+	{
+		return;
+	}
+
+	IVRCPUProfileScope profile_scope(Profiler_, "WaitForQueuedFrames");
+
+	//after this only MaxQueuedFrames_ - 1 frames are still queued, so the frame about to be recorded is at most MaxQueuedFrames_ frames behind the gpu
+	uint64_t frame_to_wait_for = SubmittedFrameCount_ - MaxQueuedFrames_ + 1;
+
+	if (SyncObjectsManager_->FrameTimelineSemaphore != VK_NULL_HANDLE)
+	{
+		VkSemaphoreWaitInfo wait_info{};
+		wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		wait_info.semaphoreCount = 1;
+		wait_info.pSemaphores = &SyncObjectsManager_->FrameTimelineSemaphore;
+		wait_info.pValues = &frame_to_wait_for;
+		vkWaitSemaphores(DeviceManager_->GetLogicalDevice(), &wait_info, UINT64_MAX);
+	}
+	else
+	{
+		//frame n (counting from 1) was submitted with frame index (n - 1) % MaxFramesInFlight_, and that fence has not been reset since
+		uint32_t frame_index = static_cast<uint32_t>((frame_to_wait_for - 1) % MaxFramesInFlight_);
+		vkWaitForFences(DeviceManager_->GetLogicalDevice(), 1, &SyncObjectsManager_->InFlightFences[frame_index], VK_TRUE, UINT64_MAX);
+	}
+}
+
+void IVREngine::MarkInputSampled()
+{
+	InputSampleTimeUs_ = Profiler_->GetTimeUs();
+	HasInputSample_ = true;
+}
+
+void IVREngine::SaveLastFrame(const std::string& file_path)
+{
+	if (!Config_.IsHeadless || !OffscreenTarget_->IsReadbackEnabled())
+	{
+		throw std::runtime_error("SaveLastFrame needs headless mode with readback enabled");
+	}
+
+	//the copy into the readback buffer was part of the last submission, so its fence tells us when the data is ready
+	//the fence is only reset when this frame index comes around again in QueryForSwapchainIndex
+	vkWaitForFences(DeviceManager_->GetLogicalDevice(), 1, &SyncObjectsManager_->InFlightFences[LastSubmittedFrameIndex_], VK_TRUE, UINT64_MAX);
+
+	//image index == frame index when headless
+	OffscreenTarget_->WriteReadbackToPPM(LastSubmittedFrameIndex_, file_path);
+}
@@ -1,7 +1,7 @@
 #include "light_manager.h"
 
-IVRLightManager::IVRLightManager(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t swapchain_image_count) :
-	DeviceManager_(device_manager), SwapchainImageCount_(swapchain_image_count)
+IVRLightManager::IVRLightManager(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight) :
+	DeviceManager_(device_manager), FramesInFlight_(frames_in_flight)
 {
 }
 
@@ -9,7 +9,7 @@ void IVRLightManager::SetupLights(std::vector<IVRLight>&& lights)
 {
 	Lights_ = lights;
 
-	for (uint32_t i = 0; i < SwapchainImageCount_; i++)
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
 	{
 		std::vector<std::shared_ptr<IVRUBManager>> light_ub_managers;
 		std::vector<LightUBObj> light_ubos;
@@ -28,10 +28,10 @@ void IVRLightManager::SetupLights(std::vector<IVRLight>&& lights)
 	}
 }
 
-void IVRLightManager::TransformLightsByViewMatrix(glm::mat4 view, uint32_t swapchain_index)
+void IVRLightManager::TransformLightsByViewMatrix(glm::mat4 view, uint32_t frame_index)
 {
-	std::vector<std::shared_ptr<IVRUBManager>>& light_ub_managers = LightUBManagers_[swapchain_index];
-	std::vector<LightUBObj>& light_ubos = LightUBOs_[swapchain_index];
+	std::vector<std::shared_ptr<IVRUBManager>>& light_ub_managers = LightUBManagers_[frame_index];
+	std::vector<LightUBObj>& light_ubos = LightUBOs_[frame_index];
 
 	for (uint32_t i = 0; i < Lights_.size(); i++)
 	{
@@ -75,9 +75,9 @@ IVRLight& IVRLightManager::GetLightByIndex(uint32_t light_index)
 	return Lights_[light_index];
 }
 
-std::shared_ptr<IVRUBManager> IVRLightManager::GetLightUBManagerByIndex(uint32_t light_index, uint32_t swapchain_index)
+std::shared_ptr<IVRUBManager> IVRLightManager::GetLightUBManagerByIndex(uint32_t light_index, uint32_t frame_index)
 {
-	return LightUBManagers_[swapchain_index][light_index];
+	return LightUBManagers_[frame_index][light_index];
 }
 
 std::vector<std::vector<std::shared_ptr<IVRUBManager>>>& IVRLightManager::GetAllLightUBs()
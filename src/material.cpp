@@ -2,32 +2,37 @@
 #include "ivr_path.h"
 
 IVRBaseMaterial::IVRBaseMaterial(std::string name, std::string vertex_shader_path, std::string fragment_shader_path, std::string default_texture,
-								uint32_t light_count, uint32_t texture_count, uint32_t swapchain_image_count, bool is_cubemap) :
+								uint32_t light_count, uint32_t texture_count, uint32_t frames_in_flight, bool is_cubemap, IVRVertexLayout vertex_layout) :
 	Name_(name), DefaultTexture_(default_texture),
-	LightCount_(light_count), TextureCount_(texture_count), SwapchainImageCount_(swapchain_image_count), IsCubemap(is_cubemap)
+	LightCount_(light_count), TextureCount_(texture_count), FramesInFlight_(frames_in_flight), IsCubemap(is_cubemap), VertexLayout_(vertex_layout)
 {
 	VertexShaderPath_ = IVRPath::GetCrossPlatformPath({"shaders", vertex_shader_path});
 	FragmentShaderPath_ = IVRPath::GetCrossPlatformPath({"shaders", fragment_shader_path});
 
 	CreateDescriptorSetLayoutInfo();
+	CreatePushConstantRange();
 }
 
 void IVRBaseMaterial::CreateDescriptorSetLayoutInfo()
 {
 	//binding layout :
-	//0: MVP matrix
+	//0: camera view and projection matrices
 	//1-5: Light 1-5
-	//6 : Material properties
-	// 7+ : textures
+	//6 : Material table
+	//7 : Transform buffer
+	// 8+ : textures
 
 	DescriptorSetInfo_ = {};
 
 	uint32_t binding_count = 0;
 
+	//the camera and light view projection uniform buffers live in the uniform arena and are dynamic,
+	//the offset of the data is given when the descriptor set is bound
+
 	//assign the mvp matrix uniform buffer always to the binding 0
 	VkDescriptorSetLayoutBinding mvp_matrix_binding{};
 	mvp_matrix_binding.binding = binding_count;
-	mvp_matrix_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	mvp_matrix_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	mvp_matrix_binding.descriptorCount = 1;
 	mvp_matrix_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 	mvp_matrix_binding.pImmutableSamplers = nullptr; // Optional
@@ -53,7 +58,7 @@ void IVRBaseMaterial::CreateDescriptorSetLayoutInfo()
 	{
 		VkDescriptorSetLayoutBinding light_mvp_binding{};
 		light_mvp_binding.binding = binding_count;
-		light_mvp_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		light_mvp_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		light_mvp_binding.descriptorCount = 1;
 		light_mvp_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 		light_mvp_binding.pImmutableSamplers = nullptr; // Optional
@@ -75,10 +80,10 @@ void IVRBaseMaterial::CreateDescriptorSetLayoutInfo()
 		binding_count++;
 	}
 
-	//adding the material properties binding
+	//adding the material table binding (storage buffer with every material's properties)
 	VkDescriptorSetLayoutBinding material_properties_binding{};
 	material_properties_binding.binding = binding_count;
-	material_properties_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	material_properties_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	material_properties_binding.descriptorCount = 1;
 	material_properties_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 	material_properties_binding.pImmutableSamplers = nullptr; // Optional
@@ -86,6 +91,17 @@ void IVRBaseMaterial::CreateDescriptorSetLayoutInfo()
 	DescriptorSetInfo_.DescriptorSetLayoutBindings.push_back(material_properties_binding);
 	binding_count++;
 
+	//adding the transform buffer binding (storage buffer with every object's model matrix)
+	VkDescriptorSetLayoutBinding transform_binding{};
+	transform_binding.binding = binding_count;
+	transform_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	transform_binding.descriptorCount = 1;
+	transform_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	transform_binding.pImmutableSamplers = nullptr; // Optional
+
+	DescriptorSetInfo_.DescriptorSetLayoutBindings.push_back(transform_binding);
+	binding_count++;
+
 	//assign the texture samplers to the next bindings
 	for (uint32_t i = 0; i < TextureCount_; i++)
 	{
@@ -101,6 +117,15 @@ void IVRBaseMaterial::CreateDescriptorSetLayoutInfo()
 	}
 }
 
+void IVRBaseMaterial::CreatePushConstantRange()
+{
+	//the transform index is used by the vertex shader, the material index by the fragment shader
+	PushConstantRange_ = {};
+	PushConstantRange_.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	PushConstantRange_.offset = 0;
+	PushConstantRange_.size = sizeof(ObjectPushConstants);
+}
+
 IVRDescriptorSetInfo IVRBaseMaterial::GetDescriptorSetInfo()
 {
 	return DescriptorSetInfo_;
@@ -122,7 +147,7 @@ std::vector<VkDescriptorPoolSize> IVRBaseMaterial::GetDescriptorPoolSize()
 
 	//the mvp matrix size is always 1
 	VkDescriptorPoolSize mvp_matrix_pool_size{};
-	mvp_matrix_pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	mvp_matrix_pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	mvp_matrix_pool_size.descriptorCount = 1;
 
 	VkDescriptorPoolSize light_pool_size{};
@@ -130,7 +155,7 @@ std::vector<VkDescriptorPoolSize> IVRBaseMaterial::GetDescriptorPoolSize()
 	light_pool_size.descriptorCount = LightCount_;
 
 	VkDescriptorPoolSize light_mvp_pool_size{};
-	light_mvp_pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	light_mvp_pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 	light_mvp_pool_size.descriptorCount = LightCount_;
 
 	VkDescriptorPoolSize depth_texture_pool_size{};
@@ -138,18 +163,23 @@ std::vector<VkDescriptorPoolSize> IVRBaseMaterial::GetDescriptorPoolSize()
 	depth_texture_pool_size.descriptorCount = LightCount_;
 
 	VkDescriptorPoolSize material_properties_pool_size{};
-	material_properties_pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	material_properties_pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	material_properties_pool_size.descriptorCount = 1;
 
+	VkDescriptorPoolSize transform_pool_size{};
+	transform_pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	transform_pool_size.descriptorCount = 1;
+
 	//the texture samplers may be more than one dependending on the number of textures
 	VkDescriptorPoolSize texture_pool_size{};
 	texture_pool_size.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	texture_pool_size.descriptorCount = TextureCount_;
 
-	for (uint32_t i = 0; i < SwapchainImageCount_; i++) {
+	for (uint32_t i = 0; i < FramesInFlight_; i++) {
 		descriptor_pool_size.push_back(mvp_matrix_pool_size);
 		descriptor_pool_size.push_back(texture_pool_size);
 		descriptor_pool_size.push_back(material_properties_pool_size);
+		descriptor_pool_size.push_back(transform_pool_size);
 		descriptor_pool_size.push_back(light_pool_size);
 		descriptor_pool_size.push_back(light_mvp_pool_size);
 		descriptor_pool_size.push_back(depth_texture_pool_size);
@@ -180,6 +210,8 @@ VkPipelineLayout  IVRBaseMaterial::GetPipelineLayout()
 
 void IVRBaseMaterial::UpdatePipelineConfigBasedOnMaterialProperties(IVRFixedFunctionPipelineConfig& ff_pipeline_config)
 {
+	ff_pipeline_config.SetVertexLayout(VertexLayout_);
+
 	if (IsCubemap)
 	{
 		ff_pipeline_config.Rasterizer.cullMode = VK_CULL_MODE_FRONT_BIT;
@@ -1,16 +1,23 @@
 #include "material_instance.h"
 
-IVRMaterialInstance::IVRMaterialInstance(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRBaseMaterial> base_material,
-	std::vector<std::string> texture_names, MaterialPropertiesUBObj properties, uint32_t swapchain_image_count,
-	std::vector<std::vector<std::shared_ptr<IVRUBManager>>>& light_ubos) :
-	DeviceManager_(device_manager), BaseMaterial_(base_material),
-	MaterialProperties_(properties), SwapchainImageCount_(swapchain_image_count), LightUBs_(light_ubos)
+IVRMaterialInstance::IVRMaterialInstance(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRUniformArena> uniform_arena,
+	std::shared_ptr<IVRMaterialTable> material_table, std::shared_ptr<IVRTextureCache> texture_cache, std::shared_ptr<IVRBaseMaterial> base_material,
+	std::vector<std::string> texture_names, MaterialPropertiesUBObj properties, uint32_t frames_in_flight,
+	std::vector<std::vector<std::shared_ptr<IVRUBManager>>>& light_ubos,
+	const std::unordered_map<std::string, std::shared_ptr<IVRDecodedImage>>& decoded_images) :
+	DeviceManager_(device_manager), UniformArena_(uniform_arena), MaterialTable_(material_table), BaseMaterial_(base_material),
+	FramesInFlight_(frames_in_flight), LightUBs_(light_ubos)
 {
 	for (std::string texture_name : texture_names)
 	{
 		std::shared_ptr<IVRTexture> texture_object;
 
-		if (MaterialProperties_.IsCubemap)
+		//textures are shared through the cache, a new one uses the pixels the loader decoded ahead of time (or decodes them when it is created)
+		std::string texture_path = GetTexturePath(texture_name, properties.IsCubemap);
+		std::unordered_map<std::string, std::shared_ptr<IVRDecodedImage>>::const_iterator decoded_image = decoded_images.find(texture_path);
+		std::shared_ptr<IVRDecodedImage> pixels = decoded_image != decoded_images.end() ? decoded_image->second : nullptr;
+
+		if (properties.IsCubemap)
 		{
 			if (TextureNames_.size() > 1) {
 				IVR_LOG_ERROR("Loading more than one cubemap is not supported yet");
@@ -18,24 +25,32 @@ IVRMaterialInstance::IVRMaterialInstance(std::shared_ptr<IVRDeviceManager> devic
 
 			IVR_LOG_INFO("Loading cubemap texture: " + texture_name);
 
-			std::string texture_path = IVRPath::GetCrossPlatformPath({ "texture_files/cubemaps", texture_name });
-			texture_object = std::make_shared<IVRTextureCube>(DeviceManager_, texture_path);
+			texture_object = texture_cache->Acquire(texture_path, true, pixels);
 			Textures_.push_back(texture_object);
 		}
 		else {
 
 			IVR_LOG_INFO("Loading 2D texture: " + texture_name);
 
-			std::string texture_path = IVRPath::GetCrossPlatformPath({ "texture_files", texture_name });
-			texture_object = std::make_shared<IVRTexture2D>(DeviceManager_, texture_path);
+			texture_object = texture_cache->Acquire(texture_path, false, pixels);
 		}
 
 		Textures_.push_back(texture_object);
 	}
 
 	LightCount_ = LightUBs_[0].size();
-	InitMVPMatrixUBs();
-	InitMaterialPropertiesUBs();
+
+	//the properties do not change unless the material is edited, they are uploaded once with the rest of the table
+	MaterialIndex_ = MaterialTable_->Add(properties);
+}
+
+std::string IVRMaterialInstance::GetTexturePath(const std::string& texture_name, bool is_cubemap)
+{
+	if (is_cubemap)
+	{
+		return IVRPath::GetCrossPlatformPath({ "texture_files/cubemaps", texture_name });
+	}
+	return IVRPath::GetCrossPlatformPath({ "texture_files", texture_name });
 }
 
 void IVRMaterialInstance::AssignDepthTextures(std::vector<std::shared_ptr<IVRTextureDepth>> depth_textures)
@@ -43,55 +58,64 @@ void IVRMaterialInstance::AssignDepthTextures(std::vector<std::shared_ptr<IVRTex
 	DepthTextures_ = depth_textures;
 }
 
-void IVRMaterialInstance::AssignDescriptorSet(VkDescriptorSet descriptor_set)
+IVRMaterialInstance::~IVRMaterialInstance()
+{
+	if (DescriptorManager_ && !DescriptorSets_.empty())
+	{
+		DescriptorManager_->ReleaseDescriptorSets(DescriptorSets_);
+	}
+}
+
+void IVRMaterialInstance::AssignDescriptorSet(VkDescriptorSet descriptor_set, std::shared_ptr<IVRDescriptorManager> descriptor_manager)
 {
 	DescriptorSets_.push_back(descriptor_set);
+	DescriptorManager_ = descriptor_manager;
 
-	if (DescriptorSets_.size() > SwapchainImageCount_)
+	if (DescriptorSets_.size() > FramesInFlight_)
 	{
-		IVR_LOG_ERROR("The number of descriptor sets is greater than the number of swapchain images");
-		throw std::runtime_error("The number of descriptor sets is greater than the number of swapchain images");
+		IVR_LOG_ERROR("The number of descriptor sets is greater than the number of frames in flight");
+		throw std::runtime_error("The number of descriptor sets is greater than the number of frames in flight");
 	}
 }
 
-VkDescriptorSet IVRMaterialInstance::GetDescriptorSet(uint32_t swapchain_image_index)
+VkDescriptorSet IVRMaterialInstance::GetDescriptorSet(uint32_t frame_index)
 {
-	return DescriptorSets_[swapchain_image_index];
+	return DescriptorSets_[frame_index];
 }
 
-void IVRMaterialInstance::WriteToDescriptorSet(uint32_t swapchain_image_index)
+void IVRMaterialInstance::WriteToDescriptorSet(uint32_t frame_index)
 {
 	std::vector<VkWriteDescriptorSet> descriptor_writes;
 
-	//write the mvp matrix uniform buffer to the descriptor set
-	VkDescriptorBufferInfo mvp_matrix_buffer_info{};
-	mvp_matrix_buffer_info.buffer = MVPMatrixUBs_[swapchain_image_index]->GetBuffer();
-	mvp_matrix_buffer_info.offset = 0;
-	mvp_matrix_buffer_info.range = MVPMatrixUBs_[swapchain_image_index]->GetBufferSize();
+	//write the camera uniform buffer to the descriptor set
+	VkDescriptorBufferInfo camera_buffer_info{};
+	camera_buffer_info.buffer = UniformArena_->GetBuffer(frame_index);
+	camera_buffer_info.offset = 0; //the offset is given when binding the descriptor set
+	camera_buffer_info.range = sizeof(CameraUBObj);
 	
-	VkWriteDescriptorSet mvp_matrix_write{};
-	mvp_matrix_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	mvp_matrix_write.dstSet = DescriptorSets_[swapchain_image_index];
-	mvp_matrix_write.dstBinding = 0;
-	mvp_matrix_write.dstArrayElement = 0;
-	mvp_matrix_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	mvp_matrix_write.descriptorCount = 1;
-	mvp_matrix_write.pBufferInfo = &mvp_matrix_buffer_info;
+	VkWriteDescriptorSet camera_write{};
+	camera_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	camera_write.dstSet = DescriptorSets_[frame_index];
+	camera_write.dstBinding = 0;
+	camera_write.dstArrayElement = 0;
+	camera_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	camera_write.descriptorCount = 1;
+	camera_write.pBufferInfo = &camera_buffer_info;
 	
-	descriptor_writes.push_back(mvp_matrix_write);
+	descriptor_writes.push_back(camera_write);
 	
 	std::vector<VkDescriptorBufferInfo> light_buffer_infos;
 	//wrie the light uniform buffer to the descriptor set
 	for (uint32_t i = 0; i < LightCount_; i++) {
 		VkDescriptorBufferInfo light_buffer_info{};
-		light_buffer_info.buffer = LightUBs_[swapchain_image_index][i]->GetBuffer();
+		light_buffer_info.buffer = LightUBs_[frame_index][i]->GetBuffer();
 		light_buffer_info.offset = 0;
-		light_buffer_info.range = LightUBs_[swapchain_image_index][i]->GetBufferSize();
+		light_buffer_info.range = LightUBs_[frame_index][i]->GetBufferSize();
 		light_buffer_infos.push_back(light_buffer_info);
 		
 		VkWriteDescriptorSet light_write{};
 		light_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		light_write.dstSet = DescriptorSets_[swapchain_image_index];
+		light_write.dstSet = DescriptorSets_[frame_index];
 		light_write.dstBinding = 1 + i;
 		light_write.dstArrayElement = 0;
 		light_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
@@ -102,21 +126,21 @@ void IVRMaterialInstance::WriteToDescriptorSet(uint32_t swapchain_image_index)
 	}
 
 	std::vector<VkDescriptorBufferInfo> light_mvp_buffer_infos;
-	//write the light mvp matrix uniform buffer to the descriptor set
+	//write the light view projection uniform buffer to the descriptor set
 	for (uint32_t i = 0; i < LightCount_; i++) {
 		
 		VkDescriptorBufferInfo light_mvp_buffer_info{};
-		light_mvp_buffer_info.buffer = LightMVPUBManagers_[swapchain_image_index]->GetBuffer();
+		light_mvp_buffer_info.buffer = UniformArena_->GetBuffer(frame_index);
 		light_mvp_buffer_info.offset = 0;
-		light_mvp_buffer_info.range = LightMVPUBManagers_[swapchain_image_index]->GetBufferSize();
+		light_mvp_buffer_info.range = sizeof(ShadowMapLightUBObj);
 		light_mvp_buffer_infos.push_back(light_mvp_buffer_info);
 
 		VkWriteDescriptorSet light_mvp_write{};
 		light_mvp_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		light_mvp_write.dstSet = DescriptorSets_[swapchain_image_index];
+		light_mvp_write.dstSet = DescriptorSets_[frame_index];
 		light_mvp_write.dstBinding = 1 + LightCount_ + i;
 		light_mvp_write.dstArrayElement = 0;
-		light_mvp_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		light_mvp_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		light_mvp_write.descriptorCount = 1;
 		light_mvp_write.pBufferInfo = &light_mvp_buffer_infos[i];
 
@@ -129,13 +153,13 @@ void IVRMaterialInstance::WriteToDescriptorSet(uint32_t swapchain_image_index)
 	{
 		VkDescriptorImageInfo image_info{};
 		image_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
-		image_info.imageView = DepthTextures_[swapchain_image_index]->GetTextureImageView();
-		image_info.sampler = DepthTextures_[swapchain_image_index]->GetTextureSampler();
+		image_info.imageView = DepthTextures_[frame_index]->GetTextureImageView();
+		image_info.sampler = DepthTextures_[frame_index]->GetTextureSampler();
 		depth_texture_image_infos.push_back(image_info);
 
 		VkWriteDescriptorSet depth_texture_write{};
 		depth_texture_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		depth_texture_write.dstSet = DescriptorSets_[swapchain_image_index];
+		depth_texture_write.dstSet = DescriptorSets_[frame_index];
 		depth_texture_write.dstBinding = 2 * LightCount_ + 1 + i;
 		depth_texture_write.dstArrayElement = 0;
 		depth_texture_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
@@ -145,23 +169,40 @@ void IVRMaterialInstance::WriteToDescriptorSet(uint32_t swapchain_image_index)
 		descriptor_writes.push_back(depth_texture_write);
 	}
 
-	//write the material properties uniform buffer to the descriptor set
+	//write the material table to the descriptor set, the shaders index it with the material index push constant
 	VkDescriptorBufferInfo material_properties_buffer_info{};
-	material_properties_buffer_info.buffer = MaterialPropertiesUBs_[swapchain_image_index]->GetBuffer();
+	material_properties_buffer_info.buffer = MaterialTable_->GetBuffer(frame_index);
 	material_properties_buffer_info.offset = 0;
-	material_properties_buffer_info.range = MaterialPropertiesUBs_[swapchain_image_index]->GetBufferSize();
+	material_properties_buffer_info.range = VK_WHOLE_SIZE;
 
 	VkWriteDescriptorSet material_properties_write{};
 	material_properties_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	material_properties_write.dstSet = DescriptorSets_[swapchain_image_index];
+	material_properties_write.dstSet = DescriptorSets_[frame_index];
 	material_properties_write.dstBinding = 3 * LightCount_ + 1;
 	material_properties_write.dstArrayElement = 0;
-	material_properties_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	material_properties_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
 	material_properties_write.descriptorCount = 1;
 	material_properties_write.pBufferInfo = &material_properties_buffer_info;
 
 	descriptor_writes.push_back(material_properties_write);
 
+	//write the frame's transform buffer to the descriptor set, the vertex shader indexes it with the transform index push constant
+	VkDescriptorBufferInfo transform_buffer_info{};
+	transform_buffer_info.buffer = TransformBuffer_->GetBuffer(frame_index);
+	transform_buffer_info.offset = 0;
+	transform_buffer_info.range = TransformBuffer_->GetBufferSize();
+
+	VkWriteDescriptorSet transform_write{};
+	transform_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	transform_write.dstSet = DescriptorSets_[frame_index];
+	transform_write.dstBinding = 3 * LightCount_ + 2;
+	transform_write.dstArrayElement = 0;
+	transform_write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	transform_write.descriptorCount = 1;
+	transform_write.pBufferInfo = &transform_buffer_info;
+
+	descriptor_writes.push_back(transform_write);
+
 	//write the texture samplers to the descriptor set
 	for (int i = 0; i < Textures_.size(); i++)
 	{
@@ -172,8 +213,8 @@ void IVRMaterialInstance::WriteToDescriptorSet(uint32_t swapchain_image_index)
 
 		VkWriteDescriptorSet texture_write{};
 		texture_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		texture_write.dstSet = DescriptorSets_[swapchain_image_index];
-		texture_write.dstBinding = 3 * LightCount_ + 2 + i;
+		texture_write.dstSet = DescriptorSets_[frame_index];
+		texture_write.dstBinding = 3 * LightCount_ + 3 + i;
 		texture_write.dstArrayElement = 0;
 		texture_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 		texture_write.descriptorCount = 1;
@@ -185,63 +226,25 @@ void IVRMaterialInstance::WriteToDescriptorSet(uint32_t swapchain_image_index)
 	vkUpdateDescriptorSets(DeviceManager_->GetLogicalDevice(), static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);
 }
 
-void IVRMaterialInstance::WriteMVPMatrixToDescriptorSet(uint32_t swapchain_image_index)
-{
-	VkDescriptorBufferInfo mvp_matrix_buffer_info{}; 
-	mvp_matrix_buffer_info.buffer = MVPMatrixUBs_[swapchain_image_index]->GetBuffer();
-	mvp_matrix_buffer_info.offset = 0; 
-	mvp_matrix_buffer_info.range = MVPMatrixUBs_[swapchain_image_index]->GetBufferSize();
-
-	VkWriteDescriptorSet mvp_matrix_write{}; 
-	mvp_matrix_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET; 
-	mvp_matrix_write.dstSet = DescriptorSets_[swapchain_image_index];
-	mvp_matrix_write.dstBinding = 0; 
-	mvp_matrix_write.dstArrayElement = 0; 
-	mvp_matrix_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; 
-	mvp_matrix_write.descriptorCount = 1; 
-	mvp_matrix_write.pBufferInfo = &mvp_matrix_buffer_info;
-
-	vkUpdateDescriptorSets(DeviceManager_->GetLogicalDevice(), 1, &mvp_matrix_write, 0, nullptr);
-}
-
-void IVRMaterialInstance::InitMVPMatrixUBs()
-{
-	for (uint32_t i = 0; i < SwapchainImageCount_; i++)
-	{
-		std::shared_ptr<IVRUBManager> mvp_matrix_ub = std::make_shared<IVRUBManager>(DeviceManager_, sizeof(MVPUBObj));
-		MVPMatrixUBs_.push_back(mvp_matrix_ub);
-	}
-}
-
-std::shared_ptr<IVRUBManager> IVRMaterialInstance::GetMVPMatrixUB(uint32_t swapchain_image_index)
-{
-	return MVPMatrixUBs_[swapchain_image_index];
-}
-
 void IVRMaterialInstance::SetLightsUBs(std::vector<std::shared_ptr<IVRUBManager>> light_ubs)
 {
 	LightUBs_.push_back(light_ubs);
 	LightCount_ = light_ubs.size();
 }
 
-void IVRMaterialInstance::InitMaterialPropertiesUBs()
+void IVRMaterialInstance::AssignFrameUniformOffsets(uint32_t camera_offset, uint32_t light_offset)
 {
-	for (uint32_t i = 0; i < SwapchainImageCount_; i++)
-	{
-		std::shared_ptr<IVRUBManager> material_properties_ub = std::make_shared<IVRUBManager>(DeviceManager_, sizeof(MaterialPropertiesUBObj));
+	CameraOffset_ = camera_offset;
+	LightOffset_ = light_offset;
 
-		//copy the material properties to the buffer
-		material_properties_ub->WriteToUniformBuffer(&MaterialProperties_, sizeof(MaterialPropertiesUBObj));
-
-		MaterialPropertiesUBs_.push_back(material_properties_ub);
+	DynamicOffsets_.clear();
+	DynamicOffsets_.push_back(CameraOffset_);
+	for (uint32_t i = 0; i < LightCount_; i++)
+	{
+		DynamicOffsets_.push_back(LightOffset_);
 	}
 }
 
-void IVRMaterialInstance::AssignLightMVPUniformBuffers(std::shared_ptr<IVRUBManager> light_mvp_ubos)
-{
-	LightMVPUBManagers_.push_back(light_mvp_ubos);
-}
-
 std::shared_ptr<IVRBaseMaterial> IVRMaterialInstance::GetBaseMaterial()
 {
 	return BaseMaterial_;
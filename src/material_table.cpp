@@ -0,0 +1,118 @@
+#include "material_table.h"
+
+IVRMaterialTable::IVRMaterialTable(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, uint32_t capacity) :
+	DeviceManager_(device_manager), Capacity_(capacity), UploadedEntryCount_(0)
+{
+	Entries_.reserve(Capacity_);
+	Buffers_.resize(frames_in_flight);
+	Allocations_.resize(frames_in_flight);
+	IsEntryDirty_.resize(frames_in_flight);
+	DirtyCounts_.resize(frames_in_flight, 0);
+
+	for (uint32_t i = 0; i < frames_in_flight; i++)
+	{
+		IsEntryDirty_[i].reserve(Capacity_);
+
+		//shared with the transfer queue family (when uploads use one) so that edited entries can be uploaded without ownership transfers
+		IVRBufferUtilities::Spawn(DeviceManager_->GetMemoryAllocator(),
+			static_cast<VkDeviceSize>(Capacity_) * sizeof(MaterialPropertiesUBObj),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, IVRMemoryCategory::Uniform,
+			Buffers_[i], Allocations_[i], IVRAllocationStrategy::Buddy, DeviceManager_->GetUploadManager()->GetSharedQueueFamilies());
+	}
+}
+
+IVRMaterialTable::~IVRMaterialTable()
+{
+	for (uint32_t i = 0; i < Buffers_.size(); i++)
+	{
+		IVRBufferUtilities::Destroy(DeviceManager_->GetMemoryAllocator(), Buffers_[i], Allocations_[i]);
+	}
+}
+
+void IVRMaterialTable::MarkDirty(uint32_t index)
+{
+	for (uint32_t i = 0; i < IsEntryDirty_.size(); i++)
+	{
+		if (!IsEntryDirty_[i][index])
+		{
+			IsEntryDirty_[i][index] = true;
+			DirtyCounts_[i]++;
+		}
+	}
+}
+
+uint32_t IVRMaterialTable::Add(const MaterialPropertiesUBObj& properties)
+{
+	if (Entries_.size() >= Capacity_)
+	{
+		throw std::runtime_error("IVRMaterialTable::Add: the material table is full");
+	}
+
+	Entries_.push_back(properties);
+	for (std::vector<bool>& is_entry_dirty : IsEntryDirty_)
+	{
+		is_entry_dirty.push_back(false);
+	}
+
+	uint32_t index = static_cast<uint32_t>(Entries_.size() - 1);
+	MarkDirty(index);
+	return index;
+}
+
+void IVRMaterialTable::Update(uint32_t index, const MaterialPropertiesUBObj& properties)
+{
+	Entries_[index] = properties;
+	MarkDirty(index);
+}
+
+void IVRMaterialTable::Flush(uint32_t frame_index)
+{
+	if (DirtyCounts_[frame_index] == 0)
+	{
+		return;
+	}
+
+	std::shared_ptr<IVRUploadManager> upload_manager = DeviceManager_->GetUploadManager();
+	bool is_shared = !upload_manager->GetSharedQueueFamilies().empty();
+	std::vector<bool>& is_entry_dirty = IsEntryDirty_[frame_index];
+
+	//one upload per run of consecutive dirty entries
+	uint32_t index = 0;
+	while (index < Entries_.size())
+	{
+		if (!is_entry_dirty[index])
+		{
+			index++;
+			continue;
+		}
+
+		uint32_t first = index;
+		while (index < Entries_.size() && is_entry_dirty[index])
+		{
+			is_entry_dirty[index] = false;
+			index++;
+		}
+
+		upload_manager->UploadToBuffer(&Entries_[first], static_cast<VkDeviceSize>(index - first) * sizeof(MaterialPropertiesUBObj),
+			Buffers_[frame_index], static_cast<VkDeviceSize>(first) * sizeof(MaterialPropertiesUBObj),
+			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, is_shared);
+		UploadedEntryCount_ += index - first;
+	}
+
+	DirtyCounts_[frame_index] = 0;
+}
+
+void IVRMaterialTable::FlushAll()
+{
+	for (uint32_t i = 0; i < Buffers_.size(); i++)
+	{
+		Flush(i);
+	}
+}
+
+void IVRMaterialTable::LogStats()
+{
+	IVR_LOG_INFO("Material table : {}/{} entries ({:.2f} KB, one copy per frame in flight), {} entries uploaded", Entries_.size(), Capacity_,
+		Entries_.size() * sizeof(MaterialPropertiesUBObj) / 1024.0, UploadedEntryCount_);
+}
@@ -0,0 +1,545 @@
+#include "memory_allocator.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include "json.hpp"
+
+static VkDeviceSize NextPowerOfTwo(VkDeviceSize value)
+{
+	VkDeviceSize power = 1;
+	while (power < value)
+	{
+		power <<= 1;
+	}
+	return power;
+}
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+}
+
+static double ToMB(VkDeviceSize bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+IVRMemoryAllocator::IVRMemoryAllocator(VkDevice logical_device, VkPhysicalDevice physical_device, bool is_memory_budget_enabled) :
+	LogicalDevice_(logical_device), PhysicalDevice_(physical_device), IsMemoryBudgetEnabled_(is_memory_budget_enabled)
+{
+	vkGetPhysicalDeviceMemoryProperties(PhysicalDevice_, &MemoryProperties_);
+	HeapAllocatedBytes_.resize(MemoryProperties_.memoryHeapCount, 0);
+	IsHeapOverBudget_.resize(MemoryProperties_.memoryHeapCount, false);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice_, &properties);
+	BufferImageGranularity_ = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+
+	//nodes at least as large as the granularity never share a page with their neighbours
+	MinNodeSize_ = NextPowerOfTwo(std::max<VkDeviceSize>(BufferImageGranularity_, 256));
+
+	Pools_.resize(MemoryProperties_.memoryTypeCount * 2);
+	for (uint32_t i = 0; i < MemoryProperties_.memoryTypeCount; i++)
+	{
+		Pools_[i * 2].MemoryTypeIndex = i;
+		Pools_[i * 2].Strategy = IVRAllocationStrategy::Buddy;
+		Pools_[i * 2 + 1].MemoryTypeIndex = i;
+		Pools_[i * 2 + 1].Strategy = IVRAllocationStrategy::Linear;
+	}
+}
+
+IVRMemoryAllocator::~IVRMemoryAllocator()
+{
+	if (Stats_.AllocationCount > 0)
+	{
+		IVR_LOG_WARNING("Destroying the memory allocator with {} allocations still alive", Stats_.AllocationCount);
+	}
+
+	for (MemoryPool& pool : Pools_)
+	{
+		for (std::unique_ptr<MemoryBlock>& block : pool.Blocks)
+		{
+			if (block)
+			{
+				vkFreeMemory(LogicalDevice_, block->Memory, nullptr);
+			}
+		}
+	}
+}
+
+uint32_t IVRMemoryAllocator::FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties)
+{
+	for (uint32_t i = 0; i < MemoryProperties_.memoryTypeCount; i++)
+	{
+		if ((type_filter & (1 << i)) && (MemoryProperties_.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find a suitable memory type!");
+}
+
+VkDeviceSize IVRMemoryAllocator::GetBlockSize(uint32_t memory_type_index)
+{
+	//small heaps (integrated gpus, the 256 MB device local + host visible heap) get smaller blocks so a few blocks do not take all of it
+	VkDeviceSize heap_size = MemoryProperties_.memoryHeaps[MemoryProperties_.memoryTypes[memory_type_index].heapIndex].size;
+	VkDeviceSize block_size = DefaultBlockSize_;
+	while (block_size > MinNodeSize_ && block_size > heap_size / 8)
+	{
+		block_size >>= 1;
+	}
+	return block_size;
+}
+
+const char* IVRMemoryAllocator::GetCategoryName(IVRMemoryCategory category)
+{
+	switch (category)
+	{
+	case IVRMemoryCategory::Mesh: return "mesh";
+	case IVRMemoryCategory::Texture: return "texture";
+	case IVRMemoryCategory::Uniform: return "uniform";
+	case IVRMemoryCategory::DepthBuffer: return "depth_buffer";
+	case IVRMemoryCategory::ShadowMap: return "shadow_map";
+	case IVRMemoryCategory::RenderTarget: return "render_target";
+	case IVRMemoryCategory::Staging: return "staging";
+	default: return "other";
+	}
+}
+
+std::vector<IVRHeapBudget> IVRMemoryAllocator::QueryHeapBudgets()
+{
+	std::vector<IVRHeapBudget> heaps(MemoryProperties_.memoryHeapCount);
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties{};
+	budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	if (IsMemoryBudgetEnabled_)
+	{
+		VkPhysicalDeviceMemoryProperties2 memory_properties{};
+		memory_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		memory_properties.pNext = &budget_properties;
+		vkGetPhysicalDeviceMemoryProperties2(PhysicalDevice_, &memory_properties);
+	}
+
+	for (uint32_t i = 0; i < MemoryProperties_.memoryHeapCount; i++)
+	{
+		IVRHeapBudget& heap = heaps[i];
+		heap.HeapSize = MemoryProperties_.memoryHeaps[i].size;
+		heap.IsDeviceLocal = (MemoryProperties_.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		heap.AllocatedBytes = HeapAllocatedBytes_[i];
+
+		if (IsMemoryBudgetEnabled_)
+		{
+			heap.BudgetBytes = budget_properties.heapBudget[i];
+			heap.UsageBytes = budget_properties.heapUsage[i];
+		}
+		else
+		{
+			heap.BudgetBytes = static_cast<VkDeviceSize>(heap.HeapSize * FallbackBudgetFraction_);
+			heap.UsageBytes = HeapAllocatedBytes_[i];
+		}
+	}
+
+	return heaps;
+}
+
+VkDeviceMemory IVRMemoryAllocator::AllocateDeviceMemory(uint32_t memory_type_index, VkDeviceSize size, IVRMemoryCategory category, void** mapped_data)
+{
+	uint32_t heap_index = MemoryProperties_.memoryTypes[memory_type_index].heapIndex;
+	IVRHeapBudget heap = QueryHeapBudgets()[heap_index];
+
+	//over the budget the allocation usually still succeeds, but the driver may move memory out of vram and performance drops
+	if (heap.UsageBytes + size > heap.BudgetBytes && !IsHeapOverBudget_[heap_index])
+	{
+		IVR_LOG_WARNING("Memory heap {} goes over its budget allocating {:.2f} MB for {} ({:.2f} MB used of a {:.2f} MB budget)",
+			heap_index, ToMB(size), GetCategoryName(category), ToMB(heap.UsageBytes), ToMB(heap.BudgetBytes));
+		IsHeapOverBudget_[heap_index] = true;
+	}
+
+	VkMemoryAllocateInfo alloc_info{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_info.allocationSize = size;
+	alloc_info.memoryTypeIndex = memory_type_index;
+
+	VkDeviceMemory memory;
+	VkResult result = vkAllocateMemory(LogicalDevice_, &alloc_info, nullptr, &memory);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate " + std::to_string(size) + " bytes of device memory for " + GetCategoryName(category) +
+			" (VkResult " + std::to_string(result) + ") from heap " + std::to_string(heap_index) + " : " +
+			std::to_string(heap.UsageBytes) + " bytes used of a " + std::to_string(heap.BudgetBytes) + " bytes budget, " +
+			std::to_string(heap.AllocatedBytes) + " bytes allocated by the engine");
+	}
+
+	HeapAllocatedBytes_[heap_index] += size;
+
+	*mapped_data = nullptr;
+	if (MemoryProperties_.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		vkMapMemory(LogicalDevice_, memory, 0, VK_WHOLE_SIZE, 0, mapped_data);
+	}
+
+	return memory;
+}
+
+void IVRMemoryAllocator::ReleaseDeviceMemory(uint32_t memory_type_index, VkDeviceMemory memory, VkDeviceSize size)
+{
+	vkFreeMemory(LogicalDevice_, memory, nullptr);
+
+	uint32_t heap_index = MemoryProperties_.memoryTypes[memory_type_index].heapIndex;
+	HeapAllocatedBytes_[heap_index] -= size;
+	if (IsHeapOverBudget_[heap_index])
+	{
+		IVRHeapBudget heap = QueryHeapBudgets()[heap_index];
+		IsHeapOverBudget_[heap_index] = heap.UsageBytes > heap.BudgetBytes;
+	}
+}
+
+IVRMemoryAllocator::MemoryBlock* IVRMemoryAllocator::CreateBlock(MemoryPool& pool, IVRMemoryCategory category, uint32_t& block_index)
+{
+	std::unique_ptr<MemoryBlock> block = std::make_unique<MemoryBlock>();
+	block->Size = GetBlockSize(pool.MemoryTypeIndex);
+	block->Memory = AllocateDeviceMemory(pool.MemoryTypeIndex, block->Size, category, &block->MappedData);
+
+	if (pool.Strategy == IVRAllocationStrategy::Buddy)
+	{
+		uint32_t level_count = 1;
+		for (VkDeviceSize node_size = block->Size; node_size > MinNodeSize_; node_size >>= 1)
+		{
+			level_count++;
+		}
+		block->FreeNodes.resize(level_count);
+		block->FreeNodes[0].insert(0);
+	}
+
+	Stats_.BlockCount++;
+	Stats_.BlockBytes += block->Size;
+
+	//reuse the slot of a released block
+	for (uint32_t i = 0; i < pool.Blocks.size(); i++)
+	{
+		if (!pool.Blocks[i])
+		{
+			pool.Blocks[i] = std::move(block);
+			block_index = i;
+			return pool.Blocks[i].get();
+		}
+	}
+
+	pool.Blocks.push_back(std::move(block));
+	block_index = static_cast<uint32_t>(pool.Blocks.size() - 1);
+	return pool.Blocks.back().get();
+}
+
+IVRAllocation IVRMemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, IVRMemoryCategory category,
+	IVRAllocationStrategy strategy, bool is_optimal_image)
+{
+	std::lock_guard<std::mutex> lock(Mutex_);
+
+	IVRAllocation allocation;
+	allocation.Size = requirements.size;
+	allocation.IsOptimalImage = is_optimal_image;
+	allocation.Category = category;
+
+	uint32_t memory_type_index = FindMemoryType(requirements.memoryTypeBits, properties);
+	allocation.PoolIndex = memory_type_index * 2 + (strategy == IVRAllocationStrategy::Linear ? 1 : 0);
+	allocation.HeapIndex = MemoryProperties_.memoryTypes[memory_type_index].heapIndex;
+	MemoryPool& pool = Pools_[allocation.PoolIndex];
+
+	IVRMemoryCategoryStats& category_stats = Stats_.Categories[static_cast<size_t>(category)];
+
+	//anything larger than half a block would waste most of one, it gets its own memory
+	if (requirements.size > GetBlockSize(memory_type_index) / 2)
+	{
+		allocation.Memory = AllocateDeviceMemory(memory_type_index, requirements.size, category, &allocation.MappedData);
+		allocation.IsDedicated = true;
+
+		Stats_.DedicatedAllocationCount++;
+		Stats_.DedicatedBytes += requirements.size;
+		Stats_.AllocationCount++;
+		Stats_.UsedBytes += requirements.size;
+		category_stats.AllocationCount++;
+		category_stats.UsedBytes += requirements.size;
+		category_stats.PeakBytes = std::max(category_stats.PeakBytes, category_stats.UsedBytes);
+		return allocation;
+	}
+
+	MemoryBlock* block = nullptr;
+	VkDeviceSize offset = 0;
+
+	for (uint32_t i = 0; i < pool.Blocks.size() && block == nullptr; i++)
+	{
+		if (!pool.Blocks[i])
+		{
+			continue;
+		}
+
+		bool allocated = strategy == IVRAllocationStrategy::Buddy ?
+			AllocateBuddy(*pool.Blocks[i], requirements.size, requirements.alignment, offset) :
+			AllocateLinear(*pool.Blocks[i], requirements.size, requirements.alignment, is_optimal_image, offset);
+
+		if (allocated)
+		{
+			block = pool.Blocks[i].get();
+			allocation.BlockIndex = i;
+		}
+	}
+
+	if (block == nullptr)
+	{
+		block = CreateBlock(pool, category, allocation.BlockIndex);
+		bool allocated = strategy == IVRAllocationStrategy::Buddy ?
+			AllocateBuddy(*block, requirements.size, requirements.alignment, offset) :
+			AllocateLinear(*block, requirements.size, requirements.alignment, is_optimal_image, offset);
+
+		if (!allocated)
+		{
+			throw std::runtime_error("failed to sub-allocate from a new memory block!");
+		}
+	}
+
+	block->AllocationCount++;
+	block->UsedBytes += requirements.size;
+	Stats_.AllocationCount++;
+	Stats_.UsedBytes += requirements.size;
+	category_stats.AllocationCount++;
+	category_stats.UsedBytes += requirements.size;
+	category_stats.PeakBytes = std::max(category_stats.PeakBytes, category_stats.UsedBytes);
+
+	allocation.Memory = block->Memory;
+	allocation.Offset = offset;
+	allocation.MappedData = block->MappedData ? static_cast<char*>(block->MappedData) + offset : nullptr;
+	return allocation;
+}
+
+void IVRMemoryAllocator::Free(IVRAllocation& allocation)
+{
+	if (allocation.Memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(Mutex_);
+
+	Stats_.AllocationCount--;
+	Stats_.UsedBytes -= allocation.Size;
+
+	IVRMemoryCategoryStats& category_stats = Stats_.Categories[static_cast<size_t>(allocation.Category)];
+	category_stats.AllocationCount--;
+	category_stats.UsedBytes -= allocation.Size;
+
+	MemoryPool& pool = Pools_[allocation.PoolIndex];
+
+	if (allocation.IsDedicated)
+	{
+		ReleaseDeviceMemory(pool.MemoryTypeIndex, allocation.Memory, allocation.Size);
+		Stats_.DedicatedAllocationCount--;
+		Stats_.DedicatedBytes -= allocation.Size;
+		allocation = IVRAllocation();
+		return;
+	}
+
+	MemoryBlock& block = *pool.Blocks[allocation.BlockIndex];
+
+	block.AllocationCount--;
+	block.UsedBytes -= allocation.Size;
+
+	if (pool.Strategy == IVRAllocationStrategy::Buddy)
+	{
+		FreeBuddy(block, allocation.Offset);
+	}
+	else if (block.AllocationCount == 0)
+	{
+		block.LinearOffset = 0;
+	}
+
+	//empty blocks are given back to the driver, apart from one per pool so that allocating and freeing in a loop does not thrash
+	if (block.AllocationCount == 0)
+	{
+		uint32_t empty_block_count = 0;
+		for (const std::unique_ptr<MemoryBlock>& other : pool.Blocks)
+		{
+			if (other && other->AllocationCount == 0)
+			{
+				empty_block_count++;
+			}
+		}
+
+		if (empty_block_count > 1)
+		{
+			Stats_.BlockCount--;
+			Stats_.BlockBytes -= block.Size;
+			ReleaseDeviceMemory(pool.MemoryTypeIndex, block.Memory, block.Size);
+			pool.Blocks[allocation.BlockIndex].reset();
+		}
+	}
+
+	allocation = IVRAllocation();
+}
+
+bool IVRMemoryAllocator::AllocateBuddy(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	//nodes are aligned to their own size, so a node at least as large as the alignment is always aligned
+	VkDeviceSize node_size = NextPowerOfTwo(std::max({ size, alignment, MinNodeSize_ }));
+	if (node_size > block.Size)
+	{
+		return false;
+	}
+
+	uint32_t level = 0;
+	for (VkDeviceSize level_size = block.Size; level_size > node_size; level_size >>= 1)
+	{
+		level++;
+	}
+
+	//smallest free node that fits, then split it down to the wanted size
+	int free_level = static_cast<int>(level);
+	while (free_level >= 0 && block.FreeNodes[free_level].empty())
+	{
+		free_level--;
+	}
+	if (free_level < 0)
+	{
+		return false;
+	}
+
+	VkDeviceSize node_offset = *block.FreeNodes[free_level].begin();
+	block.FreeNodes[free_level].erase(block.FreeNodes[free_level].begin());
+
+	for (uint32_t split_level = free_level + 1; split_level <= level; split_level++)
+	{
+		VkDeviceSize half_size = block.Size >> split_level;
+		block.FreeNodes[split_level].insert(node_offset + half_size); //the upper half stays free
+	}
+
+	block.AllocatedLevels[node_offset] = level;
+	offset = node_offset;
+	return true;
+}
+
+void IVRMemoryAllocator::FreeBuddy(MemoryBlock& block, VkDeviceSize offset)
+{
+	uint32_t level = block.AllocatedLevels[offset];
+	block.AllocatedLevels.erase(offset);
+
+	//merge with the buddy for as long as it is free too
+	while (level > 0)
+	{
+		VkDeviceSize node_size = block.Size >> level;
+		VkDeviceSize buddy_offset = offset ^ node_size;
+
+		std::set<VkDeviceSize>::iterator buddy = block.FreeNodes[level].find(buddy_offset);
+		if (buddy == block.FreeNodes[level].end())
+		{
+			break;
+		}
+
+		block.FreeNodes[level].erase(buddy);
+		offset = std::min(offset, buddy_offset);
+		level--;
+	}
+
+	block.FreeNodes[level].insert(offset);
+}
+
+bool IVRMemoryAllocator::AllocateLinear(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, bool is_optimal_image, VkDeviceSize& offset)
+{
+	VkDeviceSize start = AlignUp(block.LinearOffset, alignment);
+
+	//the previous resource ends somewhere in the page before start only if start is on a page boundary
+	if (block.AllocationCount > 0 && block.IsLastLinearOptimalImage != is_optimal_image)
+	{
+		start = AlignUp(start, BufferImageGranularity_);
+	}
+
+	if (start + size > block.Size)
+	{
+		return false;
+	}
+
+	block.LinearOffset = start + size;
+	block.IsLastLinearOptimalImage = is_optimal_image;
+	offset = start;
+	return true;
+}
+
+IVRMemoryStats IVRMemoryAllocator::GetStats()
+{
+	std::lock_guard<std::mutex> lock(Mutex_);
+	return Stats_;
+}
+
+std::vector<IVRHeapBudget> IVRMemoryAllocator::GetHeapBudgets()
+{
+	std::lock_guard<std::mutex> lock(Mutex_);
+	return QueryHeapBudgets();
+}
+
+void IVRMemoryAllocator::LogStats()
+{
+	IVRMemoryStats stats = GetStats();
+	IVR_LOG_INFO("GPU memory : {} allocations using {:.2f} MB, in {} blocks ({:.2f} MB) and {} dedicated allocations ({:.2f} MB)",
+		stats.AllocationCount, ToMB(stats.UsedBytes), stats.BlockCount, ToMB(stats.BlockBytes),
+		stats.DedicatedAllocationCount, ToMB(stats.DedicatedBytes));
+
+	for (size_t i = 0; i < stats.Categories.size(); i++)
+	{
+		const IVRMemoryCategoryStats& category = stats.Categories[i];
+		if (category.PeakBytes > 0)
+		{
+			IVR_LOG_INFO("  {:<14} : {} allocations using {:.2f} MB (peak {:.2f} MB)", GetCategoryName(static_cast<IVRMemoryCategory>(i)),
+				category.AllocationCount, ToMB(category.UsedBytes), ToMB(category.PeakBytes));
+		}
+	}
+
+	std::vector<IVRHeapBudget> heaps = GetHeapBudgets();
+	for (uint32_t i = 0; i < heaps.size(); i++)
+	{
+		IVR_LOG_INFO("  heap {} ({}) : {:.2f} MB allocated by the engine, {:.2f} MB used of a {:.2f} MB budget (heap size {:.2f} MB){}",
+			i, heaps[i].IsDeviceLocal ? "device local" : "host", ToMB(heaps[i].AllocatedBytes), ToMB(heaps[i].UsageBytes),
+			ToMB(heaps[i].BudgetBytes), ToMB(heaps[i].HeapSize), IsMemoryBudgetEnabled_ ? "" : ", estimated without VK_EXT_memory_budget");
+	}
+}
+
+void IVRMemoryAllocator::WriteStatsJson(const std::string& file_path)
+{
+	IVRMemoryStats stats = GetStats();
+	std::vector<IVRHeapBudget> heaps = GetHeapBudgets();
+
+	nlohmann::json json;
+	json["allocation_count"] = stats.AllocationCount;
+	json["used_bytes"] = stats.UsedBytes;
+	json["block_count"] = stats.BlockCount;
+	json["block_bytes"] = stats.BlockBytes;
+	json["dedicated_allocation_count"] = stats.DedicatedAllocationCount;
+	json["dedicated_bytes"] = stats.DedicatedBytes;
+	json["is_memory_budget_enabled"] = IsMemoryBudgetEnabled_;
+
+	for (size_t i = 0; i < stats.Categories.size(); i++)
+	{
+		nlohmann::json& category = json["categories"][GetCategoryName(static_cast<IVRMemoryCategory>(i))];
+		category["allocation_count"] = stats.Categories[i].AllocationCount;
+		category["used_bytes"] = stats.Categories[i].UsedBytes;
+		category["peak_bytes"] = stats.Categories[i].PeakBytes;
+	}
+
+	json["heaps"] = nlohmann::json::array();
+	for (const IVRHeapBudget& heap : heaps)
+	{
+		json["heaps"].push_back({
+			{ "heap_size", heap.HeapSize },
+			{ "is_device_local", heap.IsDeviceLocal },
+			{ "budget_bytes", heap.BudgetBytes },
+			{ "usage_bytes", heap.UsageBytes },
+			{ "allocated_bytes", heap.AllocatedBytes }
+		});
+	}
+
+	std::ofstream file(file_path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open " + file_path + " for writing");
+	}
+	file << json.dump(4) << "\n";
+}
@@ -0,0 +1,209 @@
+#include "mesh_arena.h"
+
+#include <algorithm>
+
+void IVRMeshArena::RangeFreeList::Init(uint32_t capacity)
+{
+	FreeRanges_.clear();
+	FreeRanges_[0] = capacity;
+}
+
+bool IVRMeshArena::RangeFreeList::Allocate(uint32_t count, uint32_t alignment, uint32_t& offset)
+{
+	for (std::map<uint32_t, uint32_t>::iterator it = FreeRanges_.begin(); it != FreeRanges_.end(); ++it)
+	{
+		uint32_t range_offset = it->first;
+		uint32_t range_count = it->second;
+		uint32_t padding = (alignment - range_offset % alignment) % alignment;
+		if (range_count < padding + count)
+		{
+			continue;
+		}
+
+		offset = range_offset + padding;
+		uint32_t remaining = range_count - padding - count;
+		FreeRanges_.erase(it);
+		//the padding in front of an aligned range stays free
+		if (padding > 0)
+		{
+			FreeRanges_[range_offset] = padding;
+		}
+		if (remaining > 0)
+		{
+			FreeRanges_[offset + count] = remaining;
+		}
+		return true;
+	}
+	return false;
+}
+
+void IVRMeshArena::RangeFreeList::Free(uint32_t offset, uint32_t count)
+{
+	std::map<uint32_t, uint32_t>::iterator next = FreeRanges_.lower_bound(offset);
+
+	//merge with the free range right after
+	if (next != FreeRanges_.end() && offset + count == next->first)
+	{
+		count += next->second;
+		next = FreeRanges_.erase(next);
+	}
+
+	//and with the one right before
+	if (next != FreeRanges_.begin())
+	{
+		std::map<uint32_t, uint32_t>::iterator previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			previous->second += count;
+			return;
+		}
+	}
+
+	FreeRanges_[offset] = count;
+}
+
+uint32_t IVRMeshArena::RangeFreeList::GetFreeCount()
+{
+	uint32_t free_count = 0;
+	for (const std::pair<const uint32_t, uint32_t>& range : FreeRanges_)
+	{
+		free_count += range.second;
+	}
+	return free_count;
+}
+
+IVRMeshArena::IVRMeshArena(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t vertex_stride) :
+	DeviceManager_(device_manager), VertexStride_(vertex_stride), MeshCount_(0)
+{
+}
+
+IVRMeshArena::~IVRMeshArena()
+{
+	if (MeshCount_ > 0)
+	{
+		IVR_LOG_WARNING("Destroying the mesh arena with {} meshes still in it", MeshCount_);
+	}
+
+	for (std::unique_ptr<Page>& page : Pages_)
+	{
+		IVRBufferUtilities::Destroy(DeviceManager_->GetMemoryAllocator(), page->VertexBuffer, page->VertexAllocation);
+		IVRBufferUtilities::Destroy(DeviceManager_->GetMemoryAllocator(), page->IndexBuffer, page->IndexAllocation);
+	}
+}
+
+IVRMeshArena::Page& IVRMeshArena::CreatePage(uint32_t vertex_capacity, uint32_t index_unit_capacity)
+{
+	std::unique_ptr<Page> page = std::make_unique<Page>();
+	page->VertexCapacity = vertex_capacity;
+	page->IndexCapacity = index_unit_capacity;
+	page->FreeVertices.Init(vertex_capacity);
+	page->FreeIndices.Init(index_unit_capacity);
+
+	std::vector<uint32_t> queue_families = DeviceManager_->GetUploadManager()->GetSharedQueueFamilies();
+
+	IVRBufferUtilities::Spawn(DeviceManager_->GetMemoryAllocator(),
+		static_cast<VkDeviceSize>(vertex_capacity) * VertexStride_,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, IVRMemoryCategory::Mesh,
+		page->VertexBuffer, page->VertexAllocation, IVRAllocationStrategy::Buddy, queue_families);
+
+	IVRBufferUtilities::Spawn(DeviceManager_->GetMemoryAllocator(),
+		static_cast<VkDeviceSize>(index_unit_capacity) * sizeof(uint16_t),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, IVRMemoryCategory::Mesh,
+		page->IndexBuffer, page->IndexAllocation, IVRAllocationStrategy::Buddy, queue_families);
+
+	IVR_LOG_INFO("Created mesh arena page {} ({} vertices of {} bytes, {:.2f} MB of indices)", Pages_.size(), vertex_capacity, VertexStride_,
+		index_unit_capacity * sizeof(uint16_t) / (1024.0 * 1024.0));
+
+	Pages_.push_back(std::move(page));
+	return *Pages_.back();
+}
+
+bool IVRMeshArena::AllocateInPage(Page& page, uint32_t vertex_count, uint32_t index_count, VkIndexType index_type, IVRMeshAllocation& allocation)
+{
+	uint32_t vertex_offset;
+	if (!page.FreeVertices.Allocate(vertex_count, 1, vertex_offset))
+	{
+		return false;
+	}
+
+	uint32_t index_units = GetIndexUnitCount(index_type);
+	uint32_t first_unit;
+	if (!page.FreeIndices.Allocate(index_count * index_units, index_units, first_unit))
+	{
+		page.FreeVertices.Free(vertex_offset, vertex_count);
+		return false;
+	}
+
+	allocation.VertexOffset = vertex_offset;
+	allocation.VertexCount = vertex_count;
+	allocation.FirstIndex = first_unit / index_units;
+	allocation.IndexCount = index_count;
+	allocation.IndexType = index_type;
+	allocation.IsValid = true;
+	return true;
+}
+
+IVRMeshAllocation IVRMeshArena::Allocate(const void* vertices, uint32_t vertex_count, const void* indices, uint32_t index_count, VkIndexType index_type)
+{
+	IVRMeshAllocation allocation;
+	uint32_t index_units = GetIndexUnitCount(index_type);
+
+	for (uint32_t i = 0; i < Pages_.size() && !allocation.IsValid; i++)
+	{
+		if (AllocateInPage(*Pages_[i], vertex_count, index_count, index_type, allocation))
+		{
+			allocation.PageIndex = i;
+		}
+	}
+
+	if (!allocation.IsValid)
+	{
+		Page& page = CreatePage(std::max(vertex_count, DefaultPageVertexCount_), std::max(index_count * index_units, DefaultPageIndexUnitCount_));
+		AllocateInPage(page, vertex_count, index_count, index_type, allocation);
+		allocation.PageIndex = static_cast<uint32_t>(Pages_.size() - 1);
+	}
+
+	Page& page = *Pages_[allocation.PageIndex];
+	std::shared_ptr<IVRUploadManager> upload_manager = DeviceManager_->GetUploadManager();
+
+	upload_manager->UploadToBuffer(vertices, static_cast<VkDeviceSize>(vertex_count) * VertexStride_,
+		page.VertexBuffer, static_cast<VkDeviceSize>(allocation.VertexOffset) * VertexStride_,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, true);
+
+	VkDeviceSize index_size = index_units * sizeof(uint16_t);
+	upload_manager->UploadToBuffer(indices, static_cast<VkDeviceSize>(index_count) * index_size,
+		page.IndexBuffer, static_cast<VkDeviceSize>(allocation.FirstIndex) * index_size,
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, true);
+
+	MeshCount_++;
+	return allocation;
+}
+
+void IVRMeshArena::Free(IVRMeshAllocation& allocation)
+{
+	if (!allocation.IsValid)
+	{
+		return;
+	}
+
+	Page& page = *Pages_[allocation.PageIndex];
+	page.FreeVertices.Free(allocation.VertexOffset, allocation.VertexCount);
+	uint32_t index_units = GetIndexUnitCount(allocation.IndexType);
+	page.FreeIndices.Free(allocation.FirstIndex * index_units, allocation.IndexCount * index_units);
+
+	MeshCount_--;
+	allocation = IVRMeshAllocation();
+}
+
+void IVRMeshArena::LogStats()
+{
+	for (uint32_t i = 0; i < Pages_.size(); i++)
+	{
+		Page& page = *Pages_[i];
+		IVR_LOG_INFO("Mesh arena page {} : {}/{} vertices and {}/{} 16 bit index units used", i,
+			page.VertexCapacity - page.FreeVertices.GetFreeCount(), page.VertexCapacity,
+			page.IndexCapacity - page.FreeIndices.GetFreeCount(), page.IndexCapacity);
+	}
+}
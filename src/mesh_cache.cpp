@@ -0,0 +1,360 @@
+#include "mesh_cache.h"
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "debug_logger_utils.h"
+
+namespace
+{
+	//the file starts with this, followed by the submesh table, the vertex stream and the index stream
+	struct IVRMeshCacheHeader
+	{
+		char Magic[4];
+		uint32_t Version;
+
+		uint64_t SourceSize;
+		int64_t SourceModifiedTime;
+		uint64_t SourceHash;
+
+		uint32_t VertexLayout;
+		uint32_t VertexStride;
+		uint32_t VertexCount;
+		uint32_t IndexType;
+		uint32_t IndexCount;
+		uint32_t SubmeshCount;
+
+		float BoundsMin[3];
+		float BoundsMax[3];
+		float DequantizationMatrix[16];
+
+		uint64_t SubmeshDataOffset;
+		uint64_t VertexDataOffset;
+		uint64_t IndexDataOffset;
+	};
+
+	const char MeshCacheMagic[4] = { 'I', 'V', 'R', 'M' };
+
+	uint64_t AlignOffset(uint64_t offset)
+	{
+		return (offset + 15) / 16 * 16;
+	}
+
+	uint32_t GetIndexSize(VkIndexType index_type)
+	{
+		return index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+
+	const char* GetLayoutName(IVRVertexLayout vertex_layout)
+	{
+		return vertex_layout == IVRVertexLayout::Compressed ? "compressed" : "full";
+	}
+}
+
+IVRMappedFile::IVRMappedFile() :
+	Data_(nullptr), Size_(0),
+#ifdef _WIN32
+	File_(INVALID_HANDLE_VALUE), Mapping_(nullptr)
+#else
+	FileDescriptor_(-1)
+#endif
+{
+}
+
+IVRMappedFile::~IVRMappedFile()
+{
+	Close();
+}
+
+bool IVRMappedFile::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	File_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File_ == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(File_, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+	Size_ = static_cast<size_t>(size.QuadPart);
+
+	Mapping_ = CreateFileMappingA(File_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (Mapping_ == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	Data_ = static_cast<const uint8_t*>(MapViewOfFile(Mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+	FileDescriptor_ = open(path.c_str(), O_RDONLY);
+	if (FileDescriptor_ < 0)
+	{
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(FileDescriptor_, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+	Size_ = static_cast<size_t>(file_stat.st_size);
+
+	void* data = mmap(nullptr, Size_, PROT_READ, MAP_PRIVATE, FileDescriptor_, 0);
+	Data_ = data == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(data);
+#endif
+
+	if (Data_ == nullptr)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void IVRMappedFile::Close()
+{
+#ifdef _WIN32
+	if (Data_ != nullptr)
+	{
+		UnmapViewOfFile(Data_);
+	}
+	if (Mapping_ != nullptr)
+	{
+		CloseHandle(Mapping_);
+	}
+	if (File_ != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(File_);
+	}
+	File_ = INVALID_HANDLE_VALUE;
+	Mapping_ = nullptr;
+#else
+	if (Data_ != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(Data_), Size_);
+	}
+	if (FileDescriptor_ >= 0)
+	{
+		close(FileDescriptor_);
+	}
+	FileDescriptor_ = -1;
+#endif
+	Data_ = nullptr;
+	Size_ = 0;
+}
+
+std::string IVRMeshCache::GetCachePath(const std::string& source_path, IVRVertexLayout vertex_layout)
+{
+	return source_path + "." + GetLayoutName(vertex_layout) + ".ivrmesh";
+}
+
+uint64_t IVRMeshCache::HashFile(const std::string& path)
+{
+	IVRMappedFile file;
+	if (!file.Open(path))
+	{
+		return 0;
+	}
+
+	//64 bit FNV-1a
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < file.GetSize(); i++)
+	{
+		hash ^= file.GetData()[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+int64_t IVRMeshCache::GetModifiedTime(const std::string& path)
+{
+	std::error_code error;
+	std::filesystem::file_time_type modified_time = std::filesystem::last_write_time(path, error);
+	return error ? 0 : static_cast<int64_t>(modified_time.time_since_epoch().count());
+}
+
+bool IVRMeshCache::UpdateSourceModifiedTime(const std::string& cache_path, int64_t source_modified_time)
+{
+	std::fstream file(cache_path, std::ios::in | std::ios::out | std::ios::binary);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file.seekp(offsetof(IVRMeshCacheHeader, SourceModifiedTime));
+	file.write(reinterpret_cast<const char*>(&source_modified_time), sizeof(source_modified_time));
+	return static_cast<bool>(file);
+}
+
+bool IVRMeshCache::Open(const std::string& source_path, IVRVertexLayout vertex_layout)
+{
+	return OpenCacheFile(source_path, vertex_layout, true);
+}
+
+bool IVRMeshCache::OpenCacheFile(const std::string& source_path, IVRVertexLayout vertex_layout, bool can_update_time)
+{
+	std::string cache_path = GetCachePath(source_path, vertex_layout);
+	if (!CacheFile_.Open(cache_path))
+	{
+		return false;
+	}
+
+	const uint8_t* file_data = CacheFile_.GetData();
+	size_t file_size = CacheFile_.GetSize();
+
+	IVRMeshCacheHeader header;
+	if (file_size < sizeof(IVRMeshCacheHeader))
+	{
+		IVR_LOG_WARNING("Ignoring the damaged mesh cache {}", cache_path);
+		CacheFile_.Close();
+		return false;
+	}
+	memcpy(&header, file_data, sizeof(IVRMeshCacheHeader));
+
+	if (memcmp(header.Magic, MeshCacheMagic, sizeof(MeshCacheMagic)) != 0 || header.Version != Version_ ||
+		header.VertexLayout != static_cast<uint32_t>(vertex_layout) || header.VertexStride != IVRModel::GetVertexStride(vertex_layout))
+	{
+		IVR_LOG_INFO("Mesh cache {} was written by another version, it will be rebuilt", cache_path);
+		CacheFile_.Close();
+		return false;
+	}
+
+	//size and time are enough when they match, the hash decides when they do not
+	std::error_code error;
+	uint64_t source_size = static_cast<uint64_t>(std::filesystem::file_size(source_path, error));
+	if (error || source_size != header.SourceSize || GetModifiedTime(source_path) != header.SourceModifiedTime)
+	{
+		if (error || source_size != header.SourceSize || HashFile(source_path) != header.SourceHash)
+		{
+			IVR_LOG_INFO("Mesh cache {} is stale, it will be rebuilt", cache_path);
+			CacheFile_.Close();
+			return false;
+		}
+
+		//same contents with a new time (a checkout or a copy) : the recorded time is updated so that the next load does not hash the
+		//source again. The mapping is closed first (windows does not allow writing to a mapped file), then the cache is opened again
+		if (can_update_time)
+		{
+			CacheFile_.Close();
+			if (!UpdateSourceModifiedTime(cache_path, GetModifiedTime(source_path)))
+			{
+				IVR_LOG_WARNING("Could not update the source time in the mesh cache {}, the source will be hashed on every load", cache_path);
+			}
+			return OpenCacheFile(source_path, vertex_layout, false);
+		}
+	}
+
+	VkIndexType index_type = static_cast<VkIndexType>(header.IndexType);
+	uint64_t vertex_data_size = static_cast<uint64_t>(header.VertexCount) * header.VertexStride;
+	uint64_t index_data_size = static_cast<uint64_t>(header.IndexCount) * GetIndexSize(index_type);
+	uint64_t submesh_data_size = static_cast<uint64_t>(header.SubmeshCount) * sizeof(IVRSubmesh);
+	if (header.SubmeshDataOffset + submesh_data_size > file_size || header.VertexDataOffset + vertex_data_size > file_size ||
+		header.IndexDataOffset + index_data_size > file_size)
+	{
+		IVR_LOG_WARNING("Ignoring the damaged mesh cache {}", cache_path);
+		CacheFile_.Close();
+		return false;
+	}
+
+	Data_.VertexLayout = vertex_layout;
+	Data_.VertexCount = header.VertexCount;
+	Data_.IndexType = index_type;
+	Data_.IndexCount = header.IndexCount;
+	Data_.BoundsMin = glm::vec3(header.BoundsMin[0], header.BoundsMin[1], header.BoundsMin[2]);
+	Data_.BoundsMax = glm::vec3(header.BoundsMax[0], header.BoundsMax[1], header.BoundsMax[2]);
+	memcpy(&Data_.DequantizationMatrix, header.DequantizationMatrix, sizeof(header.DequantizationMatrix));
+	Data_.Submeshes.resize(header.SubmeshCount);
+	memcpy(Data_.Submeshes.data(), file_data + header.SubmeshDataOffset, static_cast<size_t>(submesh_data_size));
+	Data_.VertexData = file_data + header.VertexDataOffset;
+	Data_.IndexData = file_data + header.IndexDataOffset;
+
+	return true;
+}
+
+bool IVRMeshCache::Write(const std::string& source_path, const IVRMeshCacheData& data)
+{
+	static_assert(sizeof(glm::mat4) == 16 * sizeof(float), "the dequantization matrix is stored as 16 floats");
+
+	std::string cache_path = GetCachePath(source_path, data.VertexLayout);
+
+	IVRMeshCacheHeader header{};
+	memcpy(header.Magic, MeshCacheMagic, sizeof(MeshCacheMagic));
+	header.Version = Version_;
+
+	std::error_code error;
+	header.SourceSize = static_cast<uint64_t>(std::filesystem::file_size(source_path, error));
+	header.SourceModifiedTime = GetModifiedTime(source_path);
+	header.SourceHash = HashFile(source_path);
+
+	header.VertexLayout = static_cast<uint32_t>(data.VertexLayout);
+	header.VertexStride = IVRModel::GetVertexStride(data.VertexLayout);
+	header.VertexCount = data.VertexCount;
+	header.IndexType = static_cast<uint32_t>(data.IndexType);
+	header.IndexCount = data.IndexCount;
+	header.SubmeshCount = static_cast<uint32_t>(data.Submeshes.size());
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		header.BoundsMin[i] = data.BoundsMin[i];
+		header.BoundsMax[i] = data.BoundsMax[i];
+	}
+	memcpy(header.DequantizationMatrix, &data.DequantizationMatrix, sizeof(header.DequantizationMatrix));
+
+	//the streams start on 16 byte boundaries of the file (and so of the mapping)
+	uint64_t submesh_data_size = header.SubmeshCount * sizeof(IVRSubmesh);
+	uint64_t vertex_data_size = static_cast<uint64_t>(header.VertexCount) * header.VertexStride;
+	uint64_t index_data_size = static_cast<uint64_t>(header.IndexCount) * GetIndexSize(data.IndexType);
+	header.SubmeshDataOffset = AlignOffset(sizeof(IVRMeshCacheHeader));
+	header.VertexDataOffset = AlignOffset(header.SubmeshDataOffset + submesh_data_size);
+	header.IndexDataOffset = AlignOffset(header.VertexDataOffset + vertex_data_size);
+
+	std::vector<char> file_data(static_cast<size_t>(header.IndexDataOffset + index_data_size), 0);
+	memcpy(file_data.data(), &header, sizeof(IVRMeshCacheHeader));
+	memcpy(file_data.data() + header.SubmeshDataOffset, data.Submeshes.data(), static_cast<size_t>(submesh_data_size));
+	memcpy(file_data.data() + header.VertexDataOffset, data.VertexData, static_cast<size_t>(vertex_data_size));
+	memcpy(file_data.data() + header.IndexDataOffset, data.IndexData, static_cast<size_t>(index_data_size));
+
+	//written to a temporary file and renamed, so a reader never maps a half written cache
+	//the name is per thread, loading threads preparing the same model each write their own and the last rename wins
+	std::string temporary_path = cache_path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	{
+		std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open() || !file.write(file_data.data(), file_data.size()))
+		{
+			IVR_LOG_WARNING("Could not write the mesh cache {}", cache_path);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temporary_path, cache_path, error);
+	if (error)
+	{
+		IVR_LOG_WARNING("Could not write the mesh cache {} : {}", cache_path, error.message());
+		std::filesystem::remove(temporary_path, error);
+		return false;
+	}
+
+	IVR_LOG_INFO("Wrote the mesh cache {} ({:.2f} MB)", cache_path, file_data.size() / (1024.0 * 1024.0));
+	return true;
+}
@@ -0,0 +1,326 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace
+{
+	//the constants of Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	const int ForsythCacheSize = 32;
+	const float ForsythCacheDecayPower = 1.5f;
+	const float ForsythLastTriangleScore = 0.75f;
+	const float ForsythValenceBoostScale = 2.0f;
+	const float ForsythValenceBoostPower = 0.5f;
+
+	float ForsythVertexScore(int cache_position, uint32_t remaining_triangles)
+	{
+		if (remaining_triangles == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cache_position >= 0)
+		{
+			if (cache_position < 3)
+			{
+				//used by the last triangle, a fixed score so that the next triangle does not just pick the same edge again
+				score = ForsythLastTriangleScore;
+			}
+			else
+			{
+				float scaler = 1.0f / (ForsythCacheSize - 3);
+				score = std::pow(1.0f - (cache_position - 3) * scaler, ForsythCacheDecayPower);
+			}
+		}
+
+		//vertices with few triangles left get finished first, so they do not end up alone and cost a transform of their own later
+		score += ForsythValenceBoostScale * std::pow(static_cast<float>(remaining_triangles), -ForsythValenceBoostPower);
+		return score;
+	}
+}
+
+float IVRMeshOptimizer::ComputeACMR(const std::vector<uint32_t>& indices, uint32_t vertex_count, uint32_t cache_size)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0f;
+	}
+
+	//a vertex is in the cache while fewer than cache_size misses happened since it was loaded
+	std::vector<uint32_t> loaded_at(vertex_count, 0);
+	uint32_t miss_count = 0;
+	for (uint32_t index : indices)
+	{
+		if (loaded_at[index] == 0 || miss_count - loaded_at[index] + 1 > cache_size)
+		{
+			miss_count++;
+			loaded_at[index] = miss_count;
+		}
+	}
+
+	return static_cast<float>(miss_count) / (indices.size() / 3);
+}
+
+void IVRMeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertex_count)
+{
+	uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+	if (triangle_count == 0)
+	{
+		return;
+	}
+
+	//the triangles of every vertex, in one array (first_triangle[v] to first_triangle[v + 1])
+	std::vector<uint32_t> remaining_triangles(vertex_count, 0);
+	for (uint32_t index : indices)
+	{
+		remaining_triangles[index]++;
+	}
+	std::vector<uint32_t> first_triangle(vertex_count + 1, 0);
+	for (uint32_t v = 0; v < vertex_count; v++)
+	{
+		first_triangle[v + 1] = first_triangle[v] + remaining_triangles[v];
+	}
+	std::vector<uint32_t> vertex_triangles(indices.size());
+	std::vector<uint32_t> fill = first_triangle;
+	for (uint32_t t = 0; t < triangle_count; t++)
+	{
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			vertex_triangles[fill[indices[t * 3 + k]]++] = t;
+		}
+	}
+
+	std::vector<int> cache_position(vertex_count, -1);
+	std::vector<float> vertex_score(vertex_count);
+	for (uint32_t v = 0; v < vertex_count; v++)
+	{
+		vertex_score[v] = ForsythVertexScore(-1, remaining_triangles[v]);
+	}
+
+	std::vector<float> triangle_score(triangle_count);
+	std::vector<bool> is_emitted(triangle_count, false);
+	for (uint32_t t = 0; t < triangle_count; t++)
+	{
+		triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+	}
+
+	//lru cache, most recent first. It holds up to 3 more vertices while the emitted triangle's vertices are pushed in
+	std::vector<uint32_t> cache;
+	cache.reserve(ForsythCacheSize + 3);
+
+	std::vector<uint32_t> optimized_indices;
+	optimized_indices.reserve(indices.size());
+
+	uint32_t best_triangle = static_cast<uint32_t>(std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin());
+	uint32_t scan_cursor = 0; //triangles before it have all been emitted
+
+	for (uint32_t emitted = 0; emitted < triangle_count; emitted++)
+	{
+		if (best_triangle == UINT32_MAX)
+		{
+			//nothing in the cache has triangles left : take the best of the rest (a scan, but this only happens between disconnected parts)
+			float best_score = -1.0f;
+			while (is_emitted[scan_cursor])
+			{
+				scan_cursor++;
+			}
+			for (uint32_t t = scan_cursor; t < triangle_count; t++)
+			{
+				if (!is_emitted[t] && triangle_score[t] > best_score)
+				{
+					best_score = triangle_score[t];
+					best_triangle = t;
+				}
+			}
+		}
+
+		is_emitted[best_triangle] = true;
+
+		uint32_t triangle_vertices[3] = { indices[best_triangle * 3], indices[best_triangle * 3 + 1], indices[best_triangle * 3 + 2] };
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			uint32_t v = triangle_vertices[k];
+			optimized_indices.push_back(v);
+
+			//the emitted triangle no longer counts for its vertices
+			uint32_t* begin = &vertex_triangles[first_triangle[v]];
+			uint32_t* end = begin + remaining_triangles[v];
+			std::iter_swap(std::find(begin, end, best_triangle), end - 1);
+			remaining_triangles[v]--;
+
+			std::vector<uint32_t>::iterator cached = std::find(cache.begin(), cache.end(), v);
+			if (cached != cache.end())
+			{
+				cache.erase(cached);
+			}
+		}
+		//degenerate triangles name a vertex more than once, it only takes one cache entry
+		std::vector<uint32_t> new_entries;
+		for (uint32_t v : triangle_vertices)
+		{
+			if (std::find(new_entries.begin(), new_entries.end(), v) == new_entries.end())
+			{
+				new_entries.push_back(v);
+			}
+		}
+		cache.insert(cache.begin(), new_entries.begin(), new_entries.end());
+
+		//the vertices pushed out of the cache
+		for (size_t i = ForsythCacheSize; i < cache.size(); i++)
+		{
+			cache_position[cache[i]] = -1;
+			vertex_score[cache[i]] = ForsythVertexScore(-1, remaining_triangles[cache[i]]);
+		}
+		if (cache.size() > ForsythCacheSize)
+		{
+			cache.resize(ForsythCacheSize);
+		}
+
+		//only the scores of cached vertices (and their triangles) changed, the next triangle is the best of those
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			cache_position[cache[i]] = static_cast<int>(i);
+			vertex_score[cache[i]] = ForsythVertexScore(static_cast<int>(i), remaining_triangles[cache[i]]);
+		}
+
+		best_triangle = UINT32_MAX;
+		float best_score = -1.0f;
+		for (uint32_t v : cache)
+		{
+			for (uint32_t i = first_triangle[v]; i < first_triangle[v] + remaining_triangles[v]; i++)
+			{
+				uint32_t t = vertex_triangles[i];
+				triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+				if (triangle_score[t] > best_score)
+				{
+					best_score = triangle_score[t];
+					best_triangle = t;
+				}
+			}
+		}
+	}
+
+	indices.swap(optimized_indices);
+}
+
+void IVRMeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<glm::vec3>& positions, float threshold)
+{
+	uint32_t vertex_count = static_cast<uint32_t>(positions.size());
+	uint32_t triangle_count = static_cast<uint32_t>(indices.size() / 3);
+	if (triangle_count < 2)
+	{
+		return;
+	}
+
+	const uint32_t cache_size = 16;
+
+	//a cluster starts at every triangle whose vertices all miss the cache : the cache restarts there anyway,
+	//so the clusters can be drawn in any order without transforming many more vertices
+	std::vector<uint32_t> cluster_starts;
+	std::vector<uint32_t> loaded_at(vertex_count, 0);
+	uint32_t miss_count = 0;
+	for (uint32_t t = 0; t < triangle_count; t++)
+	{
+		uint32_t triangle_misses = 0;
+		for (uint32_t k = 0; k < 3; k++)
+		{
+			uint32_t index = indices[t * 3 + k];
+			if (loaded_at[index] == 0 || miss_count - loaded_at[index] + 1 > cache_size)
+			{
+				miss_count++;
+				loaded_at[index] = miss_count;
+				triangle_misses++;
+			}
+		}
+		if (triangle_misses == 3)
+		{
+			cluster_starts.push_back(t);
+		}
+	}
+	if (cluster_starts.size() < 2)
+	{
+		return;
+	}
+
+	glm::vec3 mesh_center(0.0f);
+	for (const glm::vec3& position : positions)
+	{
+		mesh_center += position;
+	}
+	mesh_center /= static_cast<float>(vertex_count);
+
+	//clusters facing away from the center are more likely to be in front, they are drawn first
+	std::vector<float> cluster_keys(cluster_starts.size());
+	for (size_t c = 0; c < cluster_starts.size(); c++)
+	{
+		uint32_t first = cluster_starts[c];
+		uint32_t last = c + 1 < cluster_starts.size() ? cluster_starts[c + 1] : triangle_count;
+
+		glm::vec3 centroid(0.0f);
+		glm::vec3 normal(0.0f);
+		float area = 0.0f;
+		for (uint32_t t = first; t < last; t++)
+		{
+			glm::vec3 p0 = positions[indices[t * 3]];
+			glm::vec3 p1 = positions[indices[t * 3 + 1]];
+			glm::vec3 p2 = positions[indices[t * 3 + 2]];
+
+			glm::vec3 face_normal = glm::cross(p1 - p0, p2 - p0); //length is twice the area
+			float face_area = glm::length(face_normal);
+			centroid += (p0 + p1 + p2) * (face_area / 3.0f);
+			normal += face_normal;
+			area += face_area;
+		}
+
+		if (area > 0.0f)
+		{
+			centroid /= area;
+		}
+		float normal_length = glm::length(normal);
+		if (normal_length > 0.0f)
+		{
+			normal /= normal_length;
+		}
+		cluster_keys[c] = glm::dot(centroid - mesh_center, normal);
+	}
+
+	std::vector<uint32_t> cluster_order(cluster_starts.size());
+	std::iota(cluster_order.begin(), cluster_order.end(), 0);
+	std::stable_sort(cluster_order.begin(), cluster_order.end(), [&cluster_keys](uint32_t a, uint32_t b) {
+		return cluster_keys[a] > cluster_keys[b];
+	});
+
+	std::vector<uint32_t> sorted_indices;
+	sorted_indices.reserve(indices.size());
+	//triangles before the first cluster start (none, the first triangle always misses) stay in front
+	sorted_indices.insert(sorted_indices.end(), indices.begin(), indices.begin() + cluster_starts[0] * 3);
+	for (uint32_t c : cluster_order)
+	{
+		uint32_t first = cluster_starts[c];
+		uint32_t last = c + 1 < cluster_starts.size() ? cluster_starts[c + 1] : triangle_count;
+		sorted_indices.insert(sorted_indices.end(), indices.begin() + first * 3, indices.begin() + last * 3);
+	}
+
+	//the cache state at the start of a cluster can differ from before, keep the old order if that costs more than allowed
+	if (ComputeACMR(sorted_indices, vertex_count, cache_size) <= ComputeACMR(indices, vertex_count, cache_size) * threshold)
+	{
+		indices.swap(sorted_indices);
+	}
+}
+
+std::vector<uint32_t> IVRMeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, uint32_t vertex_count)
+{
+	std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+	uint32_t next_vertex = 0;
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == UINT32_MAX)
+		{
+			remap[index] = next_vertex++;
+		}
+		index = remap[index];
+	}
+	return remap;
+}
@@ -3,22 +3,141 @@
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
-IVRModel::IVRModel(std::shared_ptr<IVRDeviceManager> device_manager, std::string model_name, std::string model_path) :
-    DeviceManager_{ device_manager }, Name_{ model_name }
+#include <unordered_map>
+
+#include "mesh_optimizer.h"
+#include "mesh_cache.h"
+
+namespace
+{
+    //a face corner's position, normal and texture coordinate indices, corners with the same three share a vertex
+    struct ObjIndexHash
+    {
+        size_t operator()(const tinyobj::index_t& index) const
+        {
+            size_t hash = std::hash<int>()(index.vertex_index);
+            hash ^= std::hash<int>()(index.normal_index) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            hash ^= std::hash<int>()(index.texcoord_index) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+
+    struct ObjIndexEqual
+    {
+        bool operator()(const tinyobj::index_t& a, const tinyobj::index_t& b) const
+        {
+            return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index && a.texcoord_index == b.texcoord_index;
+        }
+    };
+}
+
+CompressedVertex CompressedVertex::Encode(const Vertex& vertex, glm::vec3 quantized_position)
+{
+    CompressedVertex compressed{};
+
+    compressed.pos[0] = glm::packSnorm1x16(quantized_position.x);
+    compressed.pos[1] = glm::packSnorm1x16(quantized_position.y);
+    compressed.pos[2] = glm::packSnorm1x16(quantized_position.z);
+    compressed.pos[3] = 0;
+
+    //project the normal onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the upper one
+    glm::vec3 normal = vertex.normal;
+    float length_l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    float oct_x = length_l1 > 0.0f ? normal.x / length_l1 : 0.0f;
+    float oct_y = length_l1 > 0.0f ? normal.y / length_l1 : 0.0f;
+    if (normal.z < 0.0f)
+    {
+        float folded_x = (1.0f - std::abs(oct_y)) * (oct_x >= 0.0f ? 1.0f : -1.0f);
+        float folded_y = (1.0f - std::abs(oct_x)) * (oct_y >= 0.0f ? 1.0f : -1.0f);
+        oct_x = folded_x;
+        oct_y = folded_y;
+    }
+    compressed.normal[0] = glm::packSnorm1x16(oct_x);
+    compressed.normal[1] = glm::packSnorm1x16(oct_y);
+
+    compressed.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+    compressed.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+
+    return compressed;
+}
+
+IVRModel::IVRModel(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRMeshArena> mesh_arena, std::string model_name, std::string model_path,
+    IVRVertexLayout vertex_layout, bool is_upload_deferred) :
+    DeviceManager_{ device_manager }, MeshArena_{ mesh_arena }, Name_{ model_name }, VertexLayout_{ vertex_layout }, DequantizationMatrix_{ 1.0f },
+    BoundsMin_{ 0.0f }, BoundsMax_{ 0.0f }
 {
     ModelPath_ = IVRPath::GetCrossPlatformPath({ "3d_models", model_path});
-    LoadModel();
-    CreateVertexBuffer();
-    CreateIndexBuffer();
+
+    PrepareMesh();
+    if (!is_upload_deferred)
+    {
+        UploadMesh();
+    }
 }
 
 IVRModel::~IVRModel()
 {
-    vkDestroyBuffer(DeviceManager_->GetLogicalDevice(), VertexBuffer_, nullptr);
-    vkFreeMemory(DeviceManager_->GetLogicalDevice(), VertexBufferMemory_, nullptr);
+    //the range is given back to the arena once the frames in flight no longer draw from it, unless the arena is gone by then
+    std::weak_ptr<IVRMeshArena> mesh_arena = MeshArena_;
+    IVRMeshAllocation mesh_allocation = MeshAllocation_;
+    DeviceManager_->GetDeletionQueue()->Release([mesh_arena, mesh_allocation]() mutable {
+        if (std::shared_ptr<IVRMeshArena> arena = mesh_arena.lock())
+        {
+            arena->Free(mesh_allocation);
+        }
+    });
+}
+
+void IVRModel::PrepareMesh()
+{
+    //the processed geometry of an unchanged obj file is read back from its cache file, without parsing it again
+    std::unique_ptr<IVRMeshCache> mesh_cache = std::make_unique<IVRMeshCache>();
+    if (mesh_cache->Open(ModelPath_, VertexLayout_))
+    {
+        IVR_LOG_INFO("Loading model {} from its mesh cache", Name_);
+        PreparedMesh_ = std::make_unique<IVRMeshCacheData>(mesh_cache->GetData());
+        MeshCache_ = std::move(mesh_cache);
+        return;
+    }
 
-    vkDestroyBuffer(DeviceManager_->GetLogicalDevice(), IndexBuffer_, nullptr);
-    vkFreeMemory(DeviceManager_->GetLogicalDevice(), IndexBufferMemory_, nullptr);
+    LoadModel();
+    CreateMesh();
+}
+
+void IVRModel::UploadMesh()
+{
+    if (PreparedMesh_ == nullptr)
+    {
+        throw std::runtime_error("model " + Name_ + " has no prepared mesh to upload");
+    }
+
+    UploadMesh(*PreparedMesh_);
+
+    //the streams were copied into staging memory, the gpu copy is the only one kept
+    PreparedMesh_.reset();
+    MeshCache_.reset();
+    EncodedVertices_ = std::vector<CompressedVertex>();
+    EncodedShortIndices_ = std::vector<uint16_t>();
+    Vertices = std::vector<Vertex>();
+    Indices = std::vector<uint32_t>();
+}
+
+uint32_t IVRModel::GetVertexStride(IVRVertexLayout vertex_layout)
+{
+    return vertex_layout == IVRVertexLayout::Compressed ? sizeof(CompressedVertex) : sizeof(Vertex);
+}
+
+IVRVertexLayout IVRModel::VertexLayoutFromString(const std::string& vertex_layout)
+{
+    if (vertex_layout == "full")
+    {
+        return IVRVertexLayout::Full;
+    }
+    if (vertex_layout == "compressed")
+    {
+        return IVRVertexLayout::Compressed;
+    }
+    throw std::runtime_error("unknown vertex layout : " + vertex_layout + " (expected full or compressed)");
 }
 
 void IVRModel::LoadModel()
@@ -47,10 +166,26 @@ void IVRModel::LoadModel()
         throw std::runtime_error(warn + err);
     }
 
-    for(const tinyobj::shape_t shape : shapes)
+    std::unordered_map<tinyobj::index_t, uint32_t, ObjIndexHash, ObjIndexEqual> unique_vertices;
+    uint32_t corner_count = 0;
+
+    for(const tinyobj::shape_t& shape : shapes)
     {
-        for(const tinyobj::index_t index : shape.mesh.indices)
+        IVRSubmesh submesh{ static_cast<uint32_t>(Indices.size()), static_cast<uint32_t>(shape.mesh.indices.size()) };
+        Submeshes_.push_back(submesh);
+
+        for(const tinyobj::index_t& index : shape.mesh.indices)
         {
+            corner_count++;
+
+            //corners that share a position, normal and texture coordinate share a vertex
+            std::unordered_map<tinyobj::index_t, uint32_t, ObjIndexHash, ObjIndexEqual>::iterator existing = unique_vertices.find(index);
+            if (existing != unique_vertices.end())
+            {
+                Indices.push_back(existing->second);
+                continue;
+            }
+
             Vertex vertex{};
 
             //need to use the index to query the actual vertices and texture coordinates
@@ -71,79 +206,131 @@ void IVRModel::LoadModel()
                 attrib.normals[3 * index.normal_index + 2]
             };
 
+            BoundsMin_ = Vertices.empty() ? vertex.pos : glm::min(BoundsMin_, vertex.pos);
+            BoundsMax_ = Vertices.empty() ? vertex.pos : glm::max(BoundsMax_, vertex.pos);
+
+            uint32_t vertex_index = static_cast<uint32_t>(Vertices.size());
+            unique_vertices[index] = vertex_index;
             Vertices.push_back(vertex);
-            Indices.push_back(Indices.size()); 
+            Indices.push_back(vertex_index);
         }
     }
+
+    OptimizeMesh(corner_count);
 }
 
-void IVRModel::CreateVertexBuffer()
+void IVRModel::OptimizeMesh(uint32_t corner_count)
 {
-    VkDeviceSize buffer_size = sizeof(Vertices[0]) * Vertices.size();
+    uint32_t vertex_count = static_cast<uint32_t>(Vertices.size());
+    float acmr_before = IVRMeshOptimizer::ComputeACMR(Indices, vertex_count);
 
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
+    std::vector<glm::vec3> positions(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; i++)
+    {
+        positions[i] = Vertices[i].pos;
+    }
 
-    IVRBufferUtilities::Spawn(
-        DeviceManager_->GetLogicalDevice(), DeviceManager_->GetPhysicalDevice(),
-        buffer_size, 
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, //buffer can be used as source in memory transfer operation
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging_buffer, staging_buffer_memory);
+    //each submesh keeps its range of the index buffer, its triangles are only reordered within it
+    for (const IVRSubmesh& submesh : Submeshes_)
+    {
+        std::vector<uint32_t> submesh_indices(Indices.begin() + submesh.FirstIndex, Indices.begin() + submesh.FirstIndex + submesh.IndexCount);
+        IVRMeshOptimizer::OptimizeVertexCache(submesh_indices, vertex_count);
+        std::copy(submesh_indices.begin(), submesh_indices.end(), Indices.begin() + submesh.FirstIndex);
+    }
+    float acmr_cache = IVRMeshOptimizer::ComputeACMR(Indices, vertex_count);
+    for (const IVRSubmesh& submesh : Submeshes_)
+    {
+        std::vector<uint32_t> submesh_indices(Indices.begin() + submesh.FirstIndex, Indices.begin() + submesh.FirstIndex + submesh.IndexCount);
+        IVRMeshOptimizer::OptimizeOverdraw(submesh_indices, positions);
+        std::copy(submesh_indices.begin(), submesh_indices.end(), Indices.begin() + submesh.FirstIndex);
+    }
 
-    //TRANSFER vertex data from host memory to staging buffer memory
-    void* data;
-    vkMapMemory(DeviceManager_->GetLogicalDevice(), staging_buffer_memory, 0, buffer_size, 0, &data);
-    memcpy(data, Vertices.data(), (size_t)buffer_size);
-    vkUnmapMemory(DeviceManager_->GetLogicalDevice(), staging_buffer_memory);
+    //the remapped vertices are written in the order the indices first use them
+    std::vector<uint32_t> remap = IVRMeshOptimizer::OptimizeVertexFetch(Indices, vertex_count);
+    std::vector<Vertex> remapped_vertices(vertex_count);
+    uint32_t used_vertex_count = 0;
+    for (uint32_t i = 0; i < vertex_count; i++)
+    {
+        if (remap[i] != UINT32_MAX)
+        {
+            remapped_vertices[remap[i]] = Vertices[i];
+            used_vertex_count++;
+        }
+    }
+    remapped_vertices.resize(used_vertex_count);
+    Vertices.swap(remapped_vertices);
 
-    IVRBufferUtilities::Spawn(
-        DeviceManager_->GetLogicalDevice(), DeviceManager_->GetPhysicalDevice(),
-        buffer_size, 
-        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, 
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        VertexBuffer_, VertexBufferMemory_);
+    IVR_LOG_INFO("Model {} : {} face corners -> {} vertices, ACMR {:.3f} -> {:.3f} (cache order) -> {:.3f} (overdraw order)",
+        Name_, corner_count, Vertices.size(), acmr_before, acmr_cache, IVRMeshOptimizer::ComputeACMR(Indices, static_cast<uint32_t>(Vertices.size())));
+}
+
+std::vector<CompressedVertex> IVRModel::CompressVertices()
+{
+    glm::vec3 bounds_min = BoundsMin_;
+    glm::vec3 bounds_max = BoundsMax_;
+
+    //one scale for all three axes : the dequantization matrix then only scales uniformly, so the model matrix still transforms
+    //normals correctly. Flat meshes lose some precision on their short axes
+    glm::vec3 center = (bounds_min + bounds_max) * 0.5f;
+    glm::vec3 half_extent = (bounds_max - bounds_min) * 0.5f;
+    float scale = std::max(std::max(half_extent.x, half_extent.y), half_extent.z);
+    if (scale <= 0.0f)
+    {
+        scale = 1.0f;
+    }
 
-    IVRBufferUtilities::TransferBufferData(
-        DeviceManager_->GetLogicalDevice(), DeviceManager_->GetPhysicalDevice(),
-        DeviceManager_->GetDeviceQueueFamilies().graphicsFamily, DeviceManager_->GetGraphicsQueue(),
-        staging_buffer, VertexBuffer_, buffer_size);
-    
-    vkDestroyBuffer(DeviceManager_->GetLogicalDevice(), staging_buffer, nullptr);
-    vkFreeMemory(DeviceManager_->GetLogicalDevice(), staging_buffer_memory, nullptr);
+    DequantizationMatrix_ = glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(scale));
+
+    std::vector<CompressedVertex> compressed_vertices;
+    compressed_vertices.reserve(Vertices.size());
+    for (const Vertex& vertex : Vertices)
+    {
+        compressed_vertices.push_back(CompressedVertex::Encode(vertex, (vertex.pos - center) / scale));
+    }
+    return compressed_vertices;
 }
 
-void IVRModel::CreateIndexBuffer()
+void IVRModel::CreateMesh()
 {
-    VkDeviceSize buffer_size = sizeof(Indices[0]) * Indices.size();
+    PreparedMesh_ = std::make_unique<IVRMeshCacheData>();
+    IVRMeshCacheData& mesh_data = *PreparedMesh_;
+    mesh_data.VertexLayout = VertexLayout_;
+    mesh_data.VertexCount = static_cast<uint32_t>(Vertices.size());
+    mesh_data.IndexCount = static_cast<uint32_t>(Indices.size());
+    mesh_data.BoundsMin = BoundsMin_;
+    mesh_data.BoundsMax = BoundsMax_;
+    mesh_data.Submeshes = Submeshes_;
+
+    mesh_data.VertexData = Vertices.data();
+    if (VertexLayout_ == IVRVertexLayout::Compressed)
+    {
+        EncodedVertices_ = CompressVertices();
+        mesh_data.VertexData = EncodedVertices_.data();
+    }
+    mesh_data.DequantizationMatrix = DequantizationMatrix_;
 
-    VkBuffer staging_buffer;
-    VkDeviceMemory staging_buffer_memory;
+    //every index of a mesh with at most 65536 vertices fits in 16 bits, which halves the index data
+    mesh_data.IndexData = Indices.data();
+    mesh_data.IndexType = VK_INDEX_TYPE_UINT32;
+    if (mesh_data.VertexCount <= 65536)
+    {
+        EncodedShortIndices_.assign(Indices.begin(), Indices.end());
+        mesh_data.IndexData = EncodedShortIndices_.data();
+        mesh_data.IndexType = VK_INDEX_TYPE_UINT16;
+    }
 
-    IVRBufferUtilities::Spawn(DeviceManager_->GetLogicalDevice(), DeviceManager_->GetPhysicalDevice(),
-        buffer_size, 
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        staging_buffer, staging_buffer_memory);
-    
-    void* data;
-    vkMapMemory(DeviceManager_->GetLogicalDevice(), staging_buffer_memory, 0, buffer_size, 0, &data);
-    memcpy(data, Indices.data(), (size_t)buffer_size);
-    vkUnmapMemory(DeviceManager_->GetLogicalDevice(), staging_buffer_memory);
+    IVRMeshCache::Write(ModelPath_, mesh_data);
+}
 
-    IVRBufferUtilities::Spawn(DeviceManager_->GetLogicalDevice(), DeviceManager_->GetPhysicalDevice(),
-        buffer_size, 
-        VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 
-        IndexBuffer_, IndexBufferMemory_);
-    
-    IVRBufferUtilities::TransferBufferData(
-        DeviceManager_->GetLogicalDevice(), DeviceManager_->GetPhysicalDevice(), DeviceManager_->GetDeviceQueueFamilies().graphicsFamily, DeviceManager_->GetGraphicsQueue(),
-        staging_buffer, IndexBuffer_, buffer_size);
-    
-    vkDestroyBuffer(DeviceManager_->GetLogicalDevice(), staging_buffer, VK_NULL_HANDLE);
-    vkFreeMemory(DeviceManager_->GetLogicalDevice(), staging_buffer_memory, VK_NULL_HANDLE);
+void IVRModel::UploadMesh(const IVRMeshCacheData& mesh_data)
+{
+    DequantizationMatrix_ = mesh_data.DequantizationMatrix;
+    BoundsMin_ = mesh_data.BoundsMin;
+    BoundsMax_ = mesh_data.BoundsMax;
+    Submeshes_ = mesh_data.Submeshes;
 
+    //the geometry goes into the shared arena buffers, uploaded through a host visible staging buffer (on the transfer queue if there is one)
+    MeshAllocation_ = MeshArena_->Allocate(mesh_data.VertexData, mesh_data.VertexCount, mesh_data.IndexData, mesh_data.IndexCount, mesh_data.IndexType);
 }
 
 uint32_t IVRModel::FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties)
@@ -172,32 +359,17 @@ uint32_t IVRModel::FindMemoryType(uint32_t type_filter, VkMemoryPropertyFlags pr
     return 0;
 }
 
-IVRTransform IVRModel::GetTransform()
-{
-    return Transform_;
-}
-
-void IVRModel::SetPosition(glm::vec3 position)
-{
-	Transform_.Position = position;
-}
-
-void IVRModel::SetRotation(glm::vec3 rotation)
-{
-	Transform_.Rotation = rotation;
-}
-
-void IVRModel::SetScale(glm::vec3 scale)
+VkBuffer IVRModel::GetVertexBuffer()
 {
-	Transform_.Scale = scale;
+	return MeshArena_->GetVertexBuffer(MeshAllocation_.PageIndex);
 }
 
-VkBuffer IVRModel::GetVertexBuffer()
+VkBuffer IVRModel::GetIndexBuffer()
 {
-	return VertexBuffer_;
+	return MeshArena_->GetIndexBuffer(MeshAllocation_.PageIndex);
 }
 
-VkBuffer IVRModel::GetIndexBuffer()
+const IVRMeshAllocation& IVRModel::GetMeshAllocation()
 {
-	return IndexBuffer_;
+	return MeshAllocation_;
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "model_registry.h"
+
+IVRModelRegistry::IVRModelRegistry(std::shared_ptr<IVRDeviceManager> device_manager, std::vector<std::shared_ptr<IVRMeshArena>> mesh_arenas) :
+	DeviceManager_(device_manager), MeshArenas_(mesh_arenas), LoadCount_(0)
+{
+}
+
+void IVRModelRegistry::PruneExpired()
+{
+	for (std::map<ModelKey, std::weak_ptr<IVRModel>>::iterator it = Models_.begin(); it != Models_.end();)
+	{
+		if (it->second.expired())
+		{
+			it = Models_.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+std::shared_ptr<IVRModel> IVRModelRegistry::Find(const std::string& model_path, IVRVertexLayout vertex_layout)
+{
+	std::map<ModelKey, std::weak_ptr<IVRModel>>::iterator it = Models_.find({ model_path, vertex_layout });
+	if (it == Models_.end())
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<IVRModel> model = it->second.lock();
+	if (model == nullptr)
+	{
+		Models_.erase(it);
+		return nullptr;
+	}
+
+	return model;
+}
+
+std::shared_ptr<IVRModel> IVRModelRegistry::Acquire(const std::string& model_path, IVRVertexLayout vertex_layout)
+{
+	std::shared_ptr<IVRModel> model = Find(model_path, vertex_layout);
+	if (model != nullptr)
+	{
+		return model;
+	}
+
+	return Add(model_path, vertex_layout, PrepareModel(model_path, vertex_layout));
+}
+
+std::shared_ptr<IVRModel> IVRModelRegistry::PrepareModel(const std::string& model_path, IVRVertexLayout vertex_layout)
+{
+	//named after the file, the model is not any one object's
+	return std::make_shared<IVRModel>(DeviceManager_, MeshArenas_[static_cast<uint32_t>(vertex_layout)], model_path, model_path, vertex_layout, true);
+}
+
+std::shared_ptr<IVRModel> IVRModelRegistry::Add(const std::string& model_path, IVRVertexLayout vertex_layout, std::shared_ptr<IVRModel> model)
+{
+	std::shared_ptr<IVRModel> registered_model = Find(model_path, vertex_layout);
+	if (registered_model != nullptr)
+	{
+		return registered_model;
+	}
+
+	model->UploadMesh();
+	PruneExpired();
+	Models_[{ model_path, vertex_layout }] = model;
+	LoadCount_++;
+	return model;
+}
+
+uint32_t IVRModelRegistry::GetLoadedModelCount()
+{
+	PruneExpired();
+	return static_cast<uint32_t>(Models_.size());
+}
+
+void IVRModelRegistry::LogStats()
+{
+	PruneExpired();
+
+	long user_count = 0;
+	for (std::pair<const ModelKey, std::weak_ptr<IVRModel>>& model : Models_)
+	{
+		user_count += model.second.use_count();
+	}
+	IVR_LOG_INFO("Model registry : {} models loaded for {} users, {} uploaded since creation", Models_.size(), user_count, LoadCount_);
+}
@@ -0,0 +1,170 @@
+#include "offscreen_target.h"
+
+#include <fstream>
+
+IVROffscreenTarget::IVROffscreenTarget(std::shared_ptr<IVRDeviceManager> device_manager, VkExtent2D extent, VkFormat format, uint32_t image_count, bool enable_readback) :
+	DeviceManager_(device_manager), Extent_(extent), Format_(format), ImageCount_(image_count), IsReadbackEnabled_(enable_readback)
+{
+	CreateImages();
+
+	if (IsReadbackEnabled_)
+	{
+		CreateReadbackBuffers();
+	}
+}
+
+IVROffscreenTarget::~IVROffscreenTarget()
+{
+	DestroyReadbackBuffers();
+	DestroyImages();
+}
+
+void IVROffscreenTarget::CreateImages()
+{
+	IVR_LOG_INFO("Creating {} offscreen color images ({}x{})...", ImageCount_, Extent_.width, Extent_.height);
+
+	Images_.resize(ImageCount_);
+	ImageAllocations_.resize(ImageCount_);
+	ImageViews_.resize(ImageCount_);
+
+	for (uint32_t i = 0; i < ImageCount_; i++)
+	{
+		//rendered into by the main renderpass (or blitted into when dynamic resolution is on) and then (optionally) copied out for readback
+		IVRImageUtils::CreateImageAndBindMemory(DeviceManager_->GetMemoryAllocator(),
+			Extent_.width, Extent_.height, Format_, 1, VK_IMAGE_TILING_OPTIMAL, 0,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			IVRMemoryCategory::RenderTarget, Images_[i], ImageAllocations_[i]);
+
+		IVRImageUtils::CreateImageView(DeviceManager_->GetLogicalDevice(), Images_[i], Format_, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D, 1, ImageViews_[i]);
+	}
+	//no initial layout transition needed, the renderpass takes the images from UNDEFINED every frame
+}
+
+void IVROffscreenTarget::DestroyImages()
+{
+	for (uint32_t i = 0; i < Images_.size(); i++)
+	{
+		vkDestroyImageView(DeviceManager_->GetLogicalDevice(), ImageViews_[i], nullptr);
+		IVRImageUtils::DestroyImage(DeviceManager_->GetMemoryAllocator(), Images_[i], ImageAllocations_[i]);
+	}
+	Images_.clear();
+	ImageAllocations_.clear();
+	ImageViews_.clear();
+}
+
+void IVROffscreenTarget::CreateReadbackBuffers()
+{
+	ReadbackBuffers_.resize(ImageCount_);
+	ReadbackBufferAllocations_.resize(ImageCount_);
+	ReadbackMappedData_.resize(ImageCount_);
+
+	for (uint32_t i = 0; i < ImageCount_; i++)
+	{
+		IVRBufferUtilities::Spawn(DeviceManager_->GetMemoryAllocator(), GetReadbackSize(),
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			IVRMemoryCategory::RenderTarget, ReadbackBuffers_[i], ReadbackBufferAllocations_[i]);
+
+		//kept mapped for the lifetime of the target (by the allocator), same as the uniform buffers
+		ReadbackMappedData_[i] = ReadbackBufferAllocations_[i].MappedData;
+	}
+}
+
+void IVROffscreenTarget::DestroyReadbackBuffers()
+{
+	for (uint32_t i = 0; i < ReadbackBuffers_.size(); i++)
+	{
+		IVRBufferUtilities::Destroy(DeviceManager_->GetMemoryAllocator(), ReadbackBuffers_[i], ReadbackBufferAllocations_[i]);
+	}
+	ReadbackBuffers_.clear();
+	ReadbackBufferAllocations_.clear();
+	ReadbackMappedData_.clear();
+}
+
+void IVROffscreenTarget::RecordReadbackCopy(VkCommandBuffer command_buffer, uint32_t image_index)
+{
+	if (!IsReadbackEnabled_)
+	{
+		throw std::runtime_error("readback was not enabled for this offscreen target");
+	}
+
+	//the renderpass already moved the image to TRANSFER_SRC_OPTIMAL, but its color writes still need to be made visible to the transfer
+	VkImageMemoryBarrier image_barrier{};
+	image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	image_barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	image_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	image_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	image_barrier.image = Images_[image_index];
+	image_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	image_barrier.subresourceRange.baseMipLevel = 0;
+	image_barrier.subresourceRange.levelCount = 1;
+	image_barrier.subresourceRange.baseArrayLayer = 0;
+	image_barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &image_barrier);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0; //tightly packed
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { Extent_.width, Extent_.height, 1 };
+
+	vkCmdCopyImageToBuffer(command_buffer, Images_[image_index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ReadbackBuffers_[image_index], 1, &region);
+
+	//make the transfer write available to the host once the fence of this submission is signaled
+	VkBufferMemoryBarrier buffer_barrier{};
+	buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	buffer_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	buffer_barrier.buffer = ReadbackBuffers_[image_index];
+	buffer_barrier.offset = 0;
+	buffer_barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+}
+
+const void* IVROffscreenTarget::GetReadbackData(uint32_t image_index)
+{
+	if (!IsReadbackEnabled_)
+	{
+		throw std::runtime_error("readback was not enabled for this offscreen target");
+	}
+	return ReadbackMappedData_[image_index];
+}
+
+VkDeviceSize IVROffscreenTarget::GetReadbackSize()
+{
+	//the offscreen formats are all 4 bytes per texel (see IVREngine::InitEngine)
+	return static_cast<VkDeviceSize>(Extent_.width) * Extent_.height * 4;
+}
+
+void IVROffscreenTarget::WriteReadbackToPPM(uint32_t image_index, const std::string& file_path)
+{
+	const uint8_t* texels = static_cast<const uint8_t*>(GetReadbackData(image_index));
+
+	std::ofstream file(file_path, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open " + file_path + " for writing");
+	}
+
+	//binary ppm, alpha is dropped
+	file << "P6\n" << Extent_.width << " " << Extent_.height << "\n255\n";
+	for (uint32_t i = 0; i < Extent_.width * Extent_.height; i++)
+	{
+		file.write(reinterpret_cast<const char*>(&texels[i * 4]), 3);
+	}
+
+	IVR_LOG_INFO("Wrote readback image to {}", file_path);
+}
@@ -72,7 +72,7 @@ VkPipeline IVRPipelineCreator::CreatePipeline(VkRenderPass render_pass, IVRFixed
 	return pipeline;
 }
 
-VkPipelineLayout IVRPipelineCreator::CreatePipelineLayout(VkDescriptorSetLayout descriptor_set_layout)
+VkPipelineLayout IVRPipelineCreator::CreatePipelineLayout(VkDescriptorSetLayout descriptor_set_layout, std::vector<VkPushConstantRange> push_constant_ranges)
 {
 	//pipeline layout
 	VkPipelineLayout pipeline_layout;
@@ -80,8 +80,8 @@ VkPipelineLayout IVRPipelineCreator::CreatePipelineLayout(VkDescriptorSetLayout
 	pipeline_layout_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipeline_layout_info.setLayoutCount = 1;
 	pipeline_layout_info.pSetLayouts = &descriptor_set_layout;
-	pipeline_layout_info.pushConstantRangeCount = 0;
-	pipeline_layout_info.pPushConstantRanges = nullptr;
+	pipeline_layout_info.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size());
+	pipeline_layout_info.pPushConstantRanges = push_constant_ranges.empty() ? nullptr : push_constant_ranges.data();
 
 	if (vkCreatePipelineLayout(DeviceManager_->GetLogicalDevice(), &pipeline_layout_info, nullptr, &pipeline_layout) != VK_SUCCESS)
 	{
@@ -0,0 +1,303 @@
+#include "profiler.h"
+
+#include <fstream>
+#include <algorithm>
+
+#include "json.hpp"
+
+IVRProfiler::IVRProfiler(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, bool enabled, bool enable_gpu_timing) :
+	DeviceManager_(device_manager), IsEnabled_(enabled), IsGPUTimingSupported_(false), FramesInFlight_(frames_in_flight),
+	TimestampPeriod_(1.0f), TimestampMask_(~0ull), QueryPool_(VK_NULL_HANDLE), LastGPUFrameTimeMs_(0.0), CollectedGPUFrameCount_(0), HasDroppedEvents_(false)
+{
+	StartTime_ = std::chrono::steady_clock::now();
+
+	PendingGPUScopes_.resize(FramesInFlight_);
+	OpenGPUScopes_.resize(FramesInFlight_);
+	NextQuery_.resize(FramesInFlight_, 0);
+	SubmitTimesUs_.resize(FramesInFlight_, 0.0);
+	HasPendingResults_.resize(FramesInFlight_, false);
+
+	//the query pool is created even without full profiling when only gpu frame times are wanted
+	if (IsEnabled_ || enable_gpu_timing)
+	{
+		CreateQueryPool();
+	}
+}
+
+IVRProfiler::~IVRProfiler()
+{
+	DestroyQueryPool();
+}
+
+void IVRProfiler::CreateQueryPool()
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(DeviceManager_->GetPhysicalDevice(), &properties);
+
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(DeviceManager_->GetPhysicalDevice(), &queue_family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(DeviceManager_->GetPhysicalDevice(), &queue_family_count, queue_families.data());
+
+	uint32_t valid_bits = queue_families[DeviceManager_->GetDeviceQueueFamilies().graphicsFamily].timestampValidBits;
+
+	if (valid_bits == 0)
+	{
+		IVR_LOG_WARNING("The graphics queue does not support timestamps, only cpu scopes will be profiled");
+		return;
+	}
+
+	TimestampPeriod_ = properties.limits.timestampPeriod;
+	TimestampMask_ = valid_bits >= 64 ? ~0ull : ((1ull << valid_bits) - 1);
+
+	VkQueryPoolCreateInfo query_pool_info{};
+	query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	query_pool_info.queryCount = MaxGPUQueriesPerFrame_ * FramesInFlight_;
+
+	if (vkCreateQueryPool(DeviceManager_->GetLogicalDevice(), &query_pool_info, nullptr, &QueryPool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+
+	IsGPUTimingSupported_ = true;
+}
+
+void IVRProfiler::DestroyQueryPool()
+{
+	if (QueryPool_ != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(DeviceManager_->GetLogicalDevice(), QueryPool_, nullptr);
+		QueryPool_ = VK_NULL_HANDLE;
+	}
+	IsGPUTimingSupported_ = false;
+}
+
+void IVRProfiler::BeginFrame(VkCommandBuffer command_buffer, uint32_t frame_index)
+{
+	if (!IsGPUTimingSupported_)
+	{
+		return;
+	}
+
+	PendingGPUScopes_[frame_index].clear();
+	OpenGPUScopes_[frame_index].clear();
+	NextQuery_[frame_index] = 0;
+	HasPendingResults_[frame_index] = false;
+
+	vkCmdResetQueryPool(command_buffer, QueryPool_, frame_index * MaxGPUQueriesPerFrame_, MaxGPUQueriesPerFrame_);
+}
+
+void IVRProfiler::BeginGPUScope(VkCommandBuffer command_buffer, uint32_t frame_index, const std::string& name)
+{
+	if (!IsGPUTimingSupported_)
+	{
+		return;
+	}
+
+	if (NextQuery_[frame_index] + 2 > MaxGPUQueriesPerFrame_)
+	{
+		IVR_LOG_WARNING("Ran out of timestamp queries for this frame, gpu scope {} will not be profiled", name);
+		return;
+	}
+
+	PendingGPUScope scope;
+	scope.Name = name;
+	scope.StartQuery = NextQuery_[frame_index]++;
+	scope.EndQuery = NextQuery_[frame_index]++; //reserved now so that nested scopes do not take it
+
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, QueryPool_, frame_index * MaxGPUQueriesPerFrame_ + scope.StartQuery);
+
+	OpenGPUScopes_[frame_index].push_back(static_cast<uint32_t>(PendingGPUScopes_[frame_index].size()));
+	PendingGPUScopes_[frame_index].push_back(scope);
+}
+
+void IVRProfiler::EndGPUScope(VkCommandBuffer command_buffer, uint32_t frame_index)
+{
+	if (!IsGPUTimingSupported_ || OpenGPUScopes_[frame_index].empty())
+	{
+		return;
+	}
+
+	const PendingGPUScope& scope = PendingGPUScopes_[frame_index][OpenGPUScopes_[frame_index].back()];
+	OpenGPUScopes_[frame_index].pop_back();
+
+	//bottom of pipe : the timestamp is written once all the previously recorded work has finished
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, QueryPool_, frame_index * MaxGPUQueriesPerFrame_ + scope.EndQuery);
+}
+
+void IVRProfiler::MarkFrameSubmitted(uint32_t frame_index)
+{
+	if (!IsGPUTimingSupported_)
+	{
+		return;
+	}
+
+	SubmitTimesUs_[frame_index] = GetTimeUs();
+	HasPendingResults_[frame_index] = NextQuery_[frame_index] > 0;
+}
+
+void IVRProfiler::CollectGPUResults(uint32_t frame_index)
+{
+	if (!IsGPUTimingSupported_ || !HasPendingResults_[frame_index])
+	{
+		return;
+	}
+	HasPendingResults_[frame_index] = false;
+
+	std::vector<uint64_t> timestamps(NextQuery_[frame_index]);
+
+	//no WAIT flag, the fence of this frame has already been waited on so the results should be available
+	VkResult result = vkGetQueryPoolResults(DeviceManager_->GetLogicalDevice(), QueryPool_, frame_index * MaxGPUQueriesPerFrame_,
+		NextQuery_[frame_index], timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+	if (result != VK_SUCCESS)
+	{
+		IVR_LOG_WARNING("Timestamp results of frame index {} were not available, dropping them", frame_index);
+		return;
+	}
+
+	//gpu and cpu clocks are not calibrated against each other, so the first timestamp of the frame is lined up with the submission time
+	uint64_t frame_start_tick = timestamps[PendingGPUScopes_[frame_index].front().StartQuery];
+	double ticks_to_us = TimestampPeriod_ / 1000.0;
+
+	uint64_t frame_ticks = 0;
+
+	LastGPUResults_.clear();
+	for (const PendingGPUScope& scope : PendingGPUScopes_[frame_index])
+	{
+		uint64_t start_tick = timestamps[scope.StartQuery];
+		uint64_t end_tick = timestamps[scope.EndQuery];
+		frame_ticks = std::max(frame_ticks, (end_tick - frame_start_tick) & TimestampMask_);
+
+		IVRTraceEvent event;
+		event.Name = scope.Name;
+		event.Category = "gpu";
+		event.StartUs = SubmitTimesUs_[frame_index] + ((start_tick - frame_start_tick) & TimestampMask_) * ticks_to_us;
+		event.DurationUs = ((end_tick - start_tick) & TimestampMask_) * ticks_to_us;
+		event.ThreadId = 0;
+
+		LastGPUResults_.push_back({ scope.Name, event.DurationUs / 1000.0 });
+		if (IsEnabled_)
+		{
+			AddEvent(event);
+		}
+	}
+
+	LastGPUFrameTimeMs_ = frame_ticks * ticks_to_us / 1000.0;
+	CollectedGPUFrameCount_++;
+	if (IsEnabled_)
+	{
+		GPUFrameTimesMs_.push_back(LastGPUFrameTimeMs_);
+	}
+}
+
+void IVRProfiler::CollectAllGPUResults()
+{
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
+	{
+		CollectGPUResults(i);
+	}
+}
+
+void IVRProfiler::RecordCPUEvent(const std::string& name, double start_us, double duration_us)
+{
+	if (!IsEnabled_)
+	{
+		return;
+	}
+
+	IVRTraceEvent event;
+	event.Name = name;
+	event.Category = "cpu";
+	event.StartUs = start_us;
+	event.DurationUs = duration_us;
+	event.ThreadId = 0; //filled in by AddEvent
+	AddEvent(event);
+}
+
+void IVRProfiler::AddEvent(IVRTraceEvent event)
+{
+	std::lock_guard<std::mutex> lock(EventsMutex_);
+
+	if (Events_.size() >= MaxTraceEvents_)
+	{
+		if (!HasDroppedEvents_)
+		{
+			IVR_LOG_WARNING("Profiler reached {} events, further events are dropped", MaxTraceEvents_);
+			HasDroppedEvents_ = true;
+		}
+		return;
+	}
+
+	if (event.Category == "cpu")
+	{
+		std::thread::id thread_id = std::this_thread::get_id();
+		if (ThreadIds_.find(thread_id) == ThreadIds_.end())
+		{
+			uint32_t new_id = static_cast<uint32_t>(ThreadIds_.size()) + 1;
+			ThreadIds_[thread_id] = new_id;
+		}
+		event.ThreadId = ThreadIds_[thread_id];
+	}
+
+	Events_.push_back(event);
+}
+
+double IVRProfiler::GetTimeUs()
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - StartTime_).count();
+}
+
+void IVRProfiler::WriteChromeTrace(const std::string& file_path)
+{
+	if (!IsEnabled_)
+	{
+		throw std::runtime_error("cannot write a trace, the profiler is not enabled");
+	}
+
+	CollectAllGPUResults();
+
+	std::ofstream file(file_path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open " + file_path + " for writing");
+	}
+
+	std::lock_guard<std::mutex> lock(EventsMutex_);
+
+	//written by hand instead of building one big nlohmann::json object, traces can get large
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"GPU (graphics queue)\"}}";
+	for (uint32_t i = 1; i <= ThreadIds_.size(); i++)
+	{
+		file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i << ",\"args\":{\"name\":\"CPU thread " << i << "\"}}";
+	}
+
+	for (const IVRTraceEvent& event : Events_)
+	{
+		file << ",\n{\"name\":" << nlohmann::json(event.Name).dump() << ",\"cat\":\"" << event.Category << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.ThreadId
+			<< ",\"ts\":" << std::fixed << event.StartUs << ",\"dur\":" << event.DurationUs << "}";
+	}
+	file << "\n]}\n";
+
+	IVR_LOG_INFO("Wrote {} profiler events to {}", Events_.size(), file_path);
+}
+
+
+IVRCPUProfileScope::IVRCPUProfileScope(const std::shared_ptr<IVRProfiler>& profiler, const char* name) :
+	Profiler_(profiler && profiler->IsEnabled() ? profiler.get() : nullptr), Name_(name), StartUs_(0.0)
+{
+	if (Profiler_)
+	{
+		StartUs_ = Profiler_->GetTimeUs();
+	}
+}
+
+IVRCPUProfileScope::~IVRCPUProfileScope()
+{
+	if (Profiler_)
+	{
+		Profiler_->RecordCPUEvent(Name_, StartUs_, Profiler_->GetTimeUs() - StartUs_);
+	}
+}
@@ -1,7 +1,7 @@
 #include "renderobject.h"
 
-IVRRenderObject::IVRRenderObject(std::shared_ptr<IVRModel> model, std::shared_ptr<IVRMaterialInstance> material, std::shared_ptr<IVRCamera> camera, uint32_t swapchain_image_count)
-: Model_(model), Material_(material), Camera_(camera), SwapchainImageCount_(swapchain_image_count)
+IVRRenderObject::IVRRenderObject(std::shared_ptr<IVRModel> model, std::shared_ptr<IVRMaterialInstance> material, std::shared_ptr<IVRCamera> camera, uint32_t frames_in_flight)
+: Model_(model), Material_(material), Camera_(camera), FramesInFlight_(frames_in_flight), TransformIndex_(0)
 {
 }
 
@@ -15,35 +15,14 @@ std::shared_ptr<IVRMaterialInstance> IVRRenderObject::GetMaterialInstance()
     return Material_;
 }
 
-std::shared_ptr<IVRUBManager> IVRRenderObject::GetMVPMatrixUB(uint32_t swapchain_image_index)
+void IVRRenderObject::PushConstants(VkCommandBuffer command_buffer, VkPipelineLayout pipeline_layout, VkShaderStageFlags stage_flags)
 {
-    return Material_->GetMVPMatrixUB(swapchain_image_index);
-}
-
-void IVRRenderObject::UpdateMVPMatrixUB(uint32_t swapchain_image_index)
-{
-    MVPMatrixObj.Model = Model_->GetTransform().GetModelMatrix();
-    MVPMatrixObj.View = Camera_->GetViewMatrix();
-    MVPMatrixObj.Proj = Camera_->GetProjectionMatrix();
-
-    Material_->GetMVPMatrixUB(swapchain_image_index)->WriteToUniformBuffer(&MVPMatrixObj, static_cast<VkDeviceSize>(sizeof(MVPUBObj)));
-}
+    //only indices are recorded, the model matrix itself is read from the transform buffer
+    ObjectPushConstants push_constants;
+    push_constants.TransformIndex = TransformIndex_;
+    push_constants.MaterialIndex = Material_->GetMaterialIndex();
 
-void IVRRenderObject::UpdateLightMVPUB(uint32_t swapchain_image_index, glm::mat4 light_view, glm::mat4 light_proj)
-{
-    LightMVPUBObj.Model = Model_->GetTransform().GetModelMatrix();
-	LightMVPUBObj.LightView = light_view;
-	LightMVPUBObj.LightProjection = light_proj;
-	
-    ShadowmapMaterial_->GetLightMVPUB(swapchain_image_index)->WriteToUniformBuffer(&LightMVPUBObj, static_cast<VkDeviceSize>(sizeof(ShadowMapLightMVPUBObj)));
-}
-
-void IVRRenderObject::AssignLightMVPUBToMaterialInstance()
-{
-    for (uint32_t i = 0; i < SwapchainImageCount_; i++)
-    {
-        Material_->AssignLightMVPUniformBuffers(ShadowmapMaterial_->GetLightMVPUB(i));
-    }
+    vkCmdPushConstants(command_buffer, pipeline_layout, stage_flags, 0, sizeof(ObjectPushConstants), &push_constants);
 }
 
 void IVRRenderObject::AssignShadowmapMaterial(std::shared_ptr<IVRShadowmapMaterial> shadowmap_material)
@@ -74,7 +74,7 @@ void IVRRenderpass::CreateRenderpass()
 	}
 }
 
-void IVRRenderpass::BeginRenderPass(VkCommandBuffer command_buffer, VkFramebuffer framebuffer, VkExtent2D extent)
+void IVRRenderpass::BeginRenderPass(VkCommandBuffer command_buffer, VkFramebuffer framebuffer, VkExtent2D extent, VkSubpassContents contents)
 {
 	VkRenderPassBeginInfo renderpass_begin_info{};
 	renderpass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -95,7 +95,7 @@ void IVRRenderpass::BeginRenderPass(VkCommandBuffer command_buffer, VkFramebuffe
 	renderpass_begin_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
 	renderpass_begin_info.pClearValues = clear_values.data();
 	
-	vkCmdBeginRenderPass(command_buffer, &renderpass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(command_buffer, &renderpass_begin_info, contents);
 }
 
 void IVRRenderpass::EndRenderPass(VkCommandBuffer command_buffer)
@@ -0,0 +1,54 @@
+#include "resolution_scaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+IVRResolutionScaler::IVRResolutionScaler(float target_frame_time_ms, float min_scale, float max_scale) :
+	TargetFrameTimeMs_(target_frame_time_ms), MinScale_(min_scale), MaxScale_(max_scale), Scale_(max_scale),
+	SmoothedFrameTimeMs_(0.0), HasSample_(false), FramesSinceChange_(0)
+{
+}
+
+bool IVRResolutionScaler::Update(double gpu_frame_time_ms)
+{
+	if (!HasSample_)
+	{
+		SmoothedFrameTimeMs_ = gpu_frame_time_ms;
+		HasSample_ = true;
+	}
+	else
+	{
+		SmoothedFrameTimeMs_ += SmoothingFactor_ * (gpu_frame_time_ms - SmoothedFrameTimeMs_);
+	}
+
+	FramesSinceChange_++;
+	if (FramesSinceChange_ < FramesBetweenChanges_ || SmoothedFrameTimeMs_ <= 0.0)
+	{
+		return false;
+	}
+
+	//gpu time is roughly proportional to the pixel count, so the scale that hits the target is scale * sqrt(target / current)
+	float ideal_scale = Scale_ * static_cast<float>(std::sqrt(TargetFrameTimeMs_ / SmoothedFrameTimeMs_));
+	float new_scale = Scale_;
+
+	if (SmoothedFrameTimeMs_ > TargetFrameTimeMs_)
+	{
+		//over budget : drop straight to the ideal scale (rounded down to a step)
+		new_scale = std::min(Scale_ - ScaleStep_, std::floor(ideal_scale / ScaleStep_) * ScaleStep_);
+	}
+	else if (SmoothedFrameTimeMs_ < TargetFrameTimeMs_ * IncreaseThreshold_)
+	{
+		//under budget : creep back up one step at a time
+		new_scale = std::min(Scale_ + ScaleStep_, ideal_scale);
+	}
+
+	new_scale = std::clamp(new_scale, MinScale_, MaxScale_);
+	if (std::fabs(new_scale - Scale_) < ScaleStep_ * 0.5f)
+	{
+		return false;
+	}
+
+	Scale_ = new_scale;
+	FramesSinceChange_ = 0;
+	return true;
+}
@@ -1,12 +1,11 @@
 #include "shadow_map.h"
 
-IVRShadowMap::IVRShadowMap(std::shared_ptr<IVRDeviceManager> device_manager,std::shared_ptr<IVRLightManager> light_manager, VkExtent2D swapchain_extent, uint32_t swapchain_image_count) :
-	DeviceManager_(device_manager), LightManager_(light_manager), SwapchainExtent_(swapchain_extent), SwapchainImageCount_(swapchain_image_count)
+IVRShadowMap::IVRShadowMap(std::shared_ptr<IVRDeviceManager> device_manager,std::shared_ptr<IVRLightManager> light_manager, VkExtent2D swapchain_extent, uint32_t frames_in_flight) :
+	DeviceManager_(device_manager), LightManager_(light_manager), SwapchainExtent_(swapchain_extent), FramesInFlight_(frames_in_flight)
 {
 	SMVertexShaderPath_ = IVRPath::GetCrossPlatformPath({ "shaders", "shadow_map.vert.spv" });
 	SMFragmentShaderPath_ = IVRPath::GetCrossPlatformPath({ "shaders", "shadow_map.frag.spv "});
 
-	CreateLightMVPUniformBuffers();
 	CreateDepthImage();
 	CreateRenderpass();
 	CreateFramebuffer();
@@ -15,17 +14,17 @@ IVRShadowMap::IVRShadowMap(std::shared_ptr<IVRDeviceManager> device_manager,std:
 
 void IVRShadowMap::CreateDepthImage()
 {
-	for (uint32_t i = 0; i < SwapchainImageCount_; i++)
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
 	{
-		DepthImages_.push_back(std::make_shared<IVRDepthImage>(DeviceManager_, SwapchainExtent_));
+		DepthImages_.push_back(std::make_shared<IVRDepthImage>(DeviceManager_, SwapchainExtent_, IVRMemoryCategory::ShadowMap));
 	}
 }
 
 void IVRShadowMap::CreateFramebuffer()
 {
-	SMFramebuffers_.resize(SwapchainImageCount_);
+	SMFramebuffers_.resize(FramesInFlight_);
 
-	for (uint32_t i = 0; i < SwapchainImageCount_; i++)
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
 	{
 		std::array<VkImageView, 1> attachments = {DepthImages_[i]->GetDepthImageView()};
 
@@ -44,19 +43,6 @@ void IVRShadowMap::CreateFramebuffer()
 	}
 }
 
-void IVRShadowMap::CreateLightMVPUniformBuffers()
-{
-	for (uint32_t i = 0; i < SwapchainImageCount_; i++)
-	{
-		std::shared_ptr<IVRUBManager> ub_manager = std::make_shared<IVRUBManager>(DeviceManager_, static_cast<VkDeviceSize>(sizeof(ShadowMapLightMVPUBObj)));
-		ShadowMapLightMVPUBObj ubo{};
-		ub_manager->WriteToUniformBuffer(&ubo, static_cast<VkDeviceSize>(sizeof(ShadowMapLightMVPUBObj)));
-		LightMVPUBObjs_.push_back(ubo);
-		LightMVPUBManagers_.push_back(ub_manager);
-	}
-}
-
-
 void IVRShadowMap::CreateRenderpass()
 {
 	IVRRenderpassConfig renderpass_config;
@@ -115,31 +101,19 @@ void IVRShadowMap::CreateRenderpass()
 void IVRShadowMap::CreatePipeline()
 {
 	PipelineCreator_ = std::make_shared<IVRPipelineCreator>(DeviceManager_);
-	IVRFixedFunctionPipelineConfig pipeline_config(SwapchainExtent_);
-
 	std::shared_ptr<IVRDescriptorManager> descriptor_manager = std::make_shared<IVRDescriptorManager>(DeviceManager_);
 	VkDescriptorSetLayout descriptor_set_layout = descriptor_manager->CreateDescriptorSetLayout(GetDescriptorSetInfo());
 
-	SMPipelineLayout_ = PipelineCreator_->CreatePipelineLayout(descriptor_set_layout);
-	SMPipeline_ = PipelineCreator_->CreatePipeline(SMRenderpass_, pipeline_config, SMPipelineLayout_, SMVertexShaderPath_, SMFragmentShaderPath_);
+	SMPipelineLayout_ = PipelineCreator_->CreatePipelineLayout(descriptor_set_layout, { GetPushConstantRange() });
+	for (uint32_t i = 0; i < static_cast<uint32_t>(IVRVertexLayout::Count); i++)
+	{
+		IVRFixedFunctionPipelineConfig pipeline_config(SwapchainExtent_);
+		pipeline_config.SetVertexLayout(static_cast<IVRVertexLayout>(i));
+		SMPipelines_.push_back(PipelineCreator_->CreatePipeline(SMRenderpass_, pipeline_config, SMPipelineLayout_, SMVertexShaderPath_, SMFragmentShaderPath_));
+	}
 		
 }
 
-void IVRShadowMap::UpdateLightMVPUB(uint32_t swapchain_index, glm::mat4& model_mat)
-{
-	LightMVPUBObjs_[swapchain_index].Model = model_mat;
-
-	LightMVPUBObjs_[swapchain_index].LightView = LightManager_->GetLight(0).GetLightView();
-
-	float fov = 90.0f;
-	float aspect_ratio = (float)2160 / 1440;
-	float near_plane = 0.1f;
-	float far_plane = 100.0f;
-	LightMVPUBObjs_[swapchain_index].LightProjection = LightManager_->GetLight(0).GetLightProjection(fov, aspect_ratio, near_plane, far_plane);
-
-	LightMVPUBManagers_[swapchain_index]->WriteToUniformBuffer(&LightMVPUBObjs_[swapchain_index], static_cast<VkDeviceSize>(sizeof(ShadowMapLightMVPUBObj)));
-}
-
 IVRDescriptorSetInfo IVRShadowMap::GetDescriptorSetInfo()
 {
 	IVRDescriptorSetInfo descriptor_set_info;
@@ -147,18 +121,37 @@ IVRDescriptorSetInfo IVRShadowMap::GetDescriptorSetInfo()
 	VkDescriptorSetLayoutBinding ubo_layout_binding{};
 	ubo_layout_binding.binding = 0;
 	ubo_layout_binding.descriptorCount = 1;
-	ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	ubo_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC; //the light's data in the uniform arena
 	ubo_layout_binding.pImmutableSamplers = nullptr;
-	ubo_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; //this uniform buffer will contain MVP matrix from the light's point of view
+	ubo_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT; //this uniform buffer will contain the view and projection matrices of the light
 
 	descriptor_set_info.DescriptorSetLayoutBindings.push_back(ubo_layout_binding);
 
+	VkDescriptorSetLayoutBinding transform_layout_binding{};
+	transform_layout_binding.binding = 1;
+	transform_layout_binding.descriptorCount = 1;
+	transform_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER; //the model matrices of every object (transform buffer)
+	transform_layout_binding.pImmutableSamplers = nullptr;
+	transform_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	descriptor_set_info.DescriptorSetLayoutBindings.push_back(transform_layout_binding);
+
 	return descriptor_set_info;
 }
 
-VkPipeline IVRShadowMap::GetPipeline()
+VkPushConstantRange IVRShadowMap::GetPushConstantRange()
+{
+	VkPushConstantRange push_constant_range{};
+	push_constant_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	push_constant_range.offset = 0;
+	push_constant_range.size = sizeof(ObjectPushConstants);
+
+	return push_constant_range;
+}
+
+VkPipeline IVRShadowMap::GetPipeline(IVRVertexLayout vertex_layout)
 {
-	return SMPipeline_;
+	return SMPipelines_[static_cast<uint32_t>(vertex_layout)];
 }
 
 VkPipelineLayout IVRShadowMap::GetPipelineLayout()
@@ -171,12 +164,12 @@ std::vector<std::shared_ptr<IVRDepthImage>> IVRShadowMap::GetDepthImages()
 	return DepthImages_;
 }
 
-void IVRShadowMap::BeginRenderPass(VkCommandBuffer command_buffer, uint32_t swapchain_index)
+void IVRShadowMap::BeginRenderPass(VkCommandBuffer command_buffer, uint32_t frame_index, VkSubpassContents contents)
 {
 	VkRenderPassBeginInfo renderpass_begin_info{};
 	renderpass_begin_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderpass_begin_info.renderPass = SMRenderpass_;
-	renderpass_begin_info.framebuffer = SMFramebuffers_[swapchain_index];
+	renderpass_begin_info.framebuffer = SMFramebuffers_[frame_index];
 	renderpass_begin_info.renderArea.offset = { 0, 0 };
 	renderpass_begin_info.renderArea.extent = { SwapchainExtent_.width, SwapchainExtent_.height };
 	VkClearValue clear_value{};
@@ -184,7 +177,7 @@ void IVRShadowMap::BeginRenderPass(VkCommandBuffer command_buffer, uint32_t swap
 	renderpass_begin_info.clearValueCount = 1;
 	renderpass_begin_info.pClearValues = &clear_value;
 
-	vkCmdBeginRenderPass(command_buffer, &renderpass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(command_buffer, &renderpass_begin_info, contents);
 
 }
 
@@ -1,9 +1,18 @@
 #include "shadowmap_material.h"
 
-IVRShadowmapMaterial::IVRShadowmapMaterial(std::shared_ptr<IVRDeviceManager> device_manager, IVRDescriptorSetInfo descriptor_set_info, uint32_t swapchain_image_count) :
-	DeviceManager_(device_manager), SMDescriptorSetInfo_(descriptor_set_info),	SwapchainImageCount_(swapchain_image_count)
+IVRShadowmapMaterial::IVRShadowmapMaterial(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRUniformArena> uniform_arena, uint32_t light_offset,
+	std::shared_ptr<IVRTransformBuffer> transform_buffer, IVRDescriptorSetInfo descriptor_set_info, uint32_t frames_in_flight) :
+	DeviceManager_(device_manager), UniformArena_(uniform_arena), LightOffset_(light_offset), TransformBuffer_(transform_buffer),
+	SMDescriptorSetInfo_(descriptor_set_info), FramesInFlight_(frames_in_flight)
 {
-	InitLightMVPUBs();
+}
+
+IVRShadowmapMaterial::~IVRShadowmapMaterial()
+{
+	if (SMDescriptorManager_ && !SMDescriptorSets_.empty())
+	{
+		SMDescriptorManager_->ReleaseDescriptorSets(SMDescriptorSets_);
+	}
 }
 
 IVRDescriptorSetInfo& IVRShadowmapMaterial::GetDescriptorSetInfo()
@@ -19,7 +28,7 @@ std::vector<VkDescriptorPoolSize> IVRShadowmapMaterial::GetDescriptorPoolSize()
 	{
 		VkDescriptorPoolSize pool_size{};
 		pool_size.type = binding.descriptorType;
-		pool_size.descriptorCount = binding.descriptorCount * SwapchainImageCount_;
+		pool_size.descriptorCount = binding.descriptorCount * FramesInFlight_;
 		
 		descriptor_pool_size.push_back(pool_size);
 	}
@@ -37,25 +46,39 @@ VkDescriptorSetLayout IVRShadowmapMaterial::GetDescriptorSetLayout()
 	return SMDescriptorSetLayout_;
 }
 
-void IVRShadowmapMaterial::AssignDescriptorSet(VkDescriptorSet descriptor_set)
+void IVRShadowmapMaterial::AssignDescriptorSet(VkDescriptorSet descriptor_set, std::shared_ptr<IVRDescriptorManager> descriptor_manager)
 {
 	SMDescriptorSets_.push_back(descriptor_set);
+	SMDescriptorManager_ = descriptor_manager;
 }
 
-void IVRShadowmapMaterial::WriteToDescriptorSet(uint32_t swapchain_index)
+void IVRShadowmapMaterial::WriteToDescriptorSet(uint32_t frame_index)
 {
 	std::vector<VkWriteDescriptorSet> write_descriptor_sets;
-	
-	for (VkDescriptorSetLayoutBinding& binding : SMDescriptorSetInfo_.DescriptorSetLayoutBindings)
+
+	//binding 0 : the light in the uniform arena, binding 1 : the transform buffer
+	std::vector<VkDescriptorBufferInfo> buffer_infos(SMDescriptorSetInfo_.DescriptorSetLayoutBindings.size());
+	for (uint32_t i = 0; i < SMDescriptorSetInfo_.DescriptorSetLayoutBindings.size(); i++)
 	{
-		VkDescriptorBufferInfo buffer_info;
-		buffer_info.buffer = LightMVPUBManagers_[swapchain_index]->GetBuffer();
-		buffer_info.offset = 0;
-		buffer_info.range = sizeof(ShadowMapLightMVPUBObj);
+		VkDescriptorSetLayoutBinding& binding = SMDescriptorSetInfo_.DescriptorSetLayoutBindings[i];
+
+		VkDescriptorBufferInfo& buffer_info = buffer_infos[i];
+		if (binding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+		{
+			buffer_info.buffer = TransformBuffer_->GetBuffer(frame_index);
+			buffer_info.offset = 0;
+			buffer_info.range = TransformBuffer_->GetBufferSize();
+		}
+		else
+		{
+			buffer_info.buffer = UniformArena_->GetBuffer(frame_index);
+			buffer_info.offset = 0; //the offset is given when binding the descriptor set
+			buffer_info.range = sizeof(ShadowMapLightUBObj);
+		}
 
 		VkWriteDescriptorSet write_descriptor_set{};
 		write_descriptor_set.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		write_descriptor_set.dstSet = SMDescriptorSets_[swapchain_index];
+		write_descriptor_set.dstSet = SMDescriptorSets_[frame_index];
 		write_descriptor_set.dstBinding = binding.binding;
 		write_descriptor_set.dstArrayElement = 0;
 		write_descriptor_set.descriptorType = binding.descriptorType;
@@ -70,23 +93,9 @@ void IVRShadowmapMaterial::WriteToDescriptorSet(uint32_t swapchain_index)
 	vkUpdateDescriptorSets(DeviceManager_->GetLogicalDevice(), static_cast<uint32_t>(write_descriptor_sets.size()), write_descriptor_sets.data(), 0, nullptr);
 }
 
-VkDescriptorSet IVRShadowmapMaterial::GetDescriptorSet(uint32_t swapchain_index)
-{
-	return SMDescriptorSets_[swapchain_index];
-}
-
-void IVRShadowmapMaterial::InitLightMVPUBs()
-{
-	for (uint32_t i = 0; i < SwapchainImageCount_; i++)
-	{
-		std::shared_ptr<IVRUBManager> light_mvp_ub = std::make_shared<IVRUBManager>(DeviceManager_, sizeof(ShadowMapLightMVPUBObj));
-		LightMVPUBManagers_.push_back(light_mvp_ub);
-	}
-}
-
-std::shared_ptr<IVRUBManager> IVRShadowmapMaterial::GetLightMVPUB(uint32_t swapchain_image_index)
+VkDescriptorSet IVRShadowmapMaterial::GetDescriptorSet(uint32_t frame_index)
 {
-	return LightMVPUBManagers_[swapchain_image_index];
+	return SMDescriptorSets_[frame_index];
 }
 
 
@@ -0,0 +1,98 @@
+#include "staging_ring.h"
+
+IVRStagingRing::IVRStagingRing(std::shared_ptr<IVRMemoryAllocator> allocator, VkDeviceSize size) :
+	Allocator_(allocator), Size_(size), Head_(0)
+{
+	IVRBufferUtilities::Spawn(Allocator_, Size_,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		IVRMemoryCategory::Staging, Buffer_, Allocation_);
+
+	IVR_LOG_INFO("Created a {:.2f} MB staging ring", Size_ / (1024.0 * 1024.0));
+}
+
+IVRStagingRing::~IVRStagingRing()
+{
+	IVRBufferUtilities::Destroy(Allocator_, Buffer_, Allocation_);
+}
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+bool IVRStagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	if (Regions_.empty())
+	{
+		Head_ = 0;
+	}
+
+	VkDeviceSize tail = Regions_.empty() ? Size_ : Regions_.front().Begin;
+	VkDeviceSize start = AlignUp(Head_, alignment);
+
+	if (Regions_.empty() || Head_ > tail)
+	{
+		//free space is [head, end of the ring) and then [0, tail), the second part only if nothing is in use
+		if (start + size > Size_)
+		{
+			start = 0;
+			if (size > (Regions_.empty() ? Size_ : tail))
+			{
+				return false;
+			}
+		}
+	}
+	else if (Head_ < tail)
+	{
+		//the ring has wrapped, free space is [head, tail)
+		if (start + size > tail)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		//head caught up with the tail : full
+		return false;
+	}
+
+	Regions_.push_back({ start, start + size, 0, false });
+	Head_ = start + size;
+	offset = start;
+	return true;
+}
+
+void IVRStagingRing::MarkSubmitted(uint64_t completion_value)
+{
+	//unsubmitted regions are always the newest ones
+	for (std::deque<Region>::reverse_iterator it = Regions_.rbegin(); it != Regions_.rend() && !it->IsSubmitted; ++it)
+	{
+		it->CompletionValue = completion_value;
+		it->IsSubmitted = true;
+	}
+}
+
+void IVRStagingRing::Reclaim(uint64_t completed_value)
+{
+	while (!Regions_.empty() && Regions_.front().IsSubmitted && Regions_.front().CompletionValue <= completed_value)
+	{
+		Regions_.pop_front();
+	}
+}
+
+bool IVRStagingRing::HasUnsubmittedRegions()
+{
+	return !Regions_.empty() && !Regions_.back().IsSubmitted;
+}
+
+bool IVRStagingRing::GetOldestCompletionValue(uint64_t& completion_value)
+{
+	if (Regions_.empty() || !Regions_.front().IsSubmitted)
+	{
+		return false;
+	}
+
+	completion_value = Regions_.front().CompletionValue;
+	return true;
+}
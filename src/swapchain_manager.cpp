@@ -29,8 +29,8 @@ SwapchainSupportDetails IVRSwapchainManager::QuerySwapchainSupport_(VkPhysicalDe
 }
 
 
-IVRSwapchainManager::IVRSwapchainManager(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRWindow> window) :
-    DeviceManager_(device_manager), Window_(window)
+IVRSwapchainManager::IVRSwapchainManager(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRWindow> window, VkPresentModeKHR preferred_present_mode) :
+    DeviceManager_(device_manager), Window_(window), PreferredPresentMode_(preferred_present_mode), PresentMode_(VK_PRESENT_MODE_FIFO_KHR)
 {
 }
 
@@ -81,16 +81,50 @@ VkPresentModeKHR IVRSwapchainManager::ChooseSwapPresentMode(const std::vector<Vk
 
     for(const auto& available_present_mode : available_present_modes)
     {
-        if(available_present_mode == VK_PRESENT_MODE_MAILBOX_KHR)
+        if(available_present_mode == PreferredPresentMode_)
         {
             return available_present_mode;
         }
     }
 
     //FIFO is guaranteed to be available
+    IVR_LOG_WARNING("Present mode {} is not supported by the surface, falling back to fifo", PresentModeToString(PreferredPresentMode_));
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+VkPresentModeKHR IVRSwapchainManager::PresentModeFromString(const std::string& name)
+{
+    if(name == "immediate")
+    {
+        return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    }
+    if(name == "mailbox")
+    {
+        return VK_PRESENT_MODE_MAILBOX_KHR;
+    }
+    if(name == "fifo")
+    {
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+    if(name == "fifo-relaxed")
+    {
+        return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    }
+    throw std::runtime_error("unknown present mode : " + name + " (expected immediate, mailbox, fifo or fifo-relaxed)");
+}
+
+std::string IVRSwapchainManager::PresentModeToString(VkPresentModeKHR present_mode)
+{
+    switch(present_mode)
+    {
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+        case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+        case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo-relaxed";
+        default: return "unknown";
+    }
+}
+
 VkExtent2D IVRSwapchainManager::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities)
 {
     /** 
@@ -116,6 +150,8 @@ void IVRSwapchainManager::CreateSwapchain()
 
     VkSurfaceFormatKHR surface_format = ChooseSwapSurfaceFormat(support_details.formats);
     VkPresentModeKHR present_mode = ChooseSwapPresentMode(support_details.presentModes);
+    PresentMode_ = present_mode;
+    IVR_LOG_INFO("Using the {} present mode", PresentModeToString(present_mode));
     VkExtent2D extent = ChooseSwapExtent(support_details.capabilities);
     
     SwapchainExtent_ = extent;
@@ -136,9 +172,10 @@ void IVRSwapchainManager::CreateSwapchain()
     createInfo.imageColorSpace = surface_format.colorSpace;
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1; // the number of layers each image consists of. Always 1 unless stereoscopic 3D application
-    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; //what kind of operations we will use the images in the swapchain for
+    createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT; //what kind of operations we will use the images in the swapchain for
     //VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT : this is when we are rendering directly to this image
     //VK_IMAGE_USAGE_TRANSFER_DST_BIT : when we render images to a separate image first (maybe to perform postprocessing) and then transfer it to the swapchain image
+    //(dynamic resolution renders the main pass at a lower resolution and blits it into the swapchain image)
 
 
     //There are two possible modes for image sharing
@@ -231,6 +268,11 @@ VkImageView IVRSwapchainManager::GetImageViewByIndex(uint16_t index)
     return SwapchainImageViews_[index];
 }
 
+std::vector<VkImageView> IVRSwapchainManager::GetImageViews()
+{
+    return SwapchainImageViews_;
+}
+
 VkFormat IVRSwapchainManager::GetSwapchainImageFormat()
 {
     return SwapchainImageFormat_;
@@ -1,7 +1,7 @@
 #include "sync_objects_manager.h"
 
-IVRSyncObjectsManager::IVRSyncObjectsManager(std::shared_ptr<IVRDeviceManager> device_manager) :
-	DeviceManager_(device_manager)
+IVRSyncObjectsManager::IVRSyncObjectsManager(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, uint32_t present_image_count) :
+	DeviceManager_(device_manager), FramesInFlight_(frames_in_flight), PresentImageCount_(present_image_count)
 {
 	CreateSemaphores();
 	CreateFences();
@@ -18,18 +18,61 @@ void IVRSyncObjectsManager::CreateSemaphores()
 	IVR_LOG_INFO("Creating semaphores...");
 	VkSemaphoreCreateInfo semaphore_create_info = {};
 	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	if (vkCreateSemaphore(DeviceManager_->GetLogicalDevice(), &semaphore_create_info, nullptr, &ImageAvailableSemaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(DeviceManager_->GetLogicalDevice(), &semaphore_create_info, nullptr, &RenderFinishedSemaphore) != VK_SUCCESS)
+
+	ImageAvailableSemaphores.resize(FramesInFlight_);
+	RenderFinishedSemaphores.resize(PresentImageCount_);
+
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
+	{
+		if (vkCreateSemaphore(DeviceManager_->GetLogicalDevice(), &semaphore_create_info, nullptr, &ImageAvailableSemaphores[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create semaphores!");
+		}
+	}
+
+	for (uint32_t i = 0; i < PresentImageCount_; i++)
 	{
-		throw std::runtime_error("failed to create semaphores!");
+		if (vkCreateSemaphore(DeviceManager_->GetLogicalDevice(), &semaphore_create_info, nullptr, &RenderFinishedSemaphores[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create semaphores!");
+		}
+	}
+
+	if (DeviceManager_->IsTimelineSemaphoreEnabled())
+	{
+		VkSemaphoreTypeCreateInfo timeline_create_info = {};
+		timeline_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		timeline_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		timeline_create_info.initialValue = 0;
+
+		VkSemaphoreCreateInfo frame_timeline_create_info = {};
+		frame_timeline_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		frame_timeline_create_info.pNext = &timeline_create_info;
+
+		if (vkCreateSemaphore(DeviceManager_->GetLogicalDevice(), &frame_timeline_create_info, nullptr, &FrameTimelineSemaphore) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the frame timeline semaphore!");
+		}
 	}
 }
 
 void IVRSyncObjectsManager::DestroySemaphores()
 {
 	IVR_LOG_INFO("Destroying semaphores...");
-	vkDestroySemaphore(DeviceManager_->GetLogicalDevice(), RenderFinishedSemaphore, nullptr);
-	vkDestroySemaphore(DeviceManager_->GetLogicalDevice(), ImageAvailableSemaphore, nullptr);
+	for (VkSemaphore semaphore : RenderFinishedSemaphores)
+	{
+		vkDestroySemaphore(DeviceManager_->GetLogicalDevice(), semaphore, nullptr);
+	}
+	for (VkSemaphore semaphore : ImageAvailableSemaphores)
+	{
+		vkDestroySemaphore(DeviceManager_->GetLogicalDevice(), semaphore, nullptr);
+	}
+
+	if (FrameTimelineSemaphore != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(DeviceManager_->GetLogicalDevice(), FrameTimelineSemaphore, nullptr);
+		FrameTimelineSemaphore = VK_NULL_HANDLE;
+	}
 }
 
 void IVRSyncObjectsManager::CreateFences()
@@ -37,17 +80,26 @@ void IVRSyncObjectsManager::CreateFences()
 	IVR_LOG_INFO("Creating fences...");
 	VkFenceCreateInfo fence_create_info = {};
 	fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-	if (vkCreateFence(DeviceManager_->GetLogicalDevice(), &fence_create_info, nullptr, &InFlightFence) != VK_SUCCESS)
+	fence_create_info.flags = VK_FENCE_CREATE_SIGNALED_BIT; //signaled so that the first wait on each frame does not block forever
+
+	InFlightFences.resize(FramesInFlight_);
+
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
 	{
-		throw std::runtime_error("failed to create fences!");
+		if (vkCreateFence(DeviceManager_->GetLogicalDevice(), &fence_create_info, nullptr, &InFlightFences[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create fences!");
+		}
 	}
 }
 
 void IVRSyncObjectsManager::DestroyFences()
 {
 	IVR_LOG_INFO("Destroying fences...");
-	vkDestroyFence(DeviceManager_->GetLogicalDevice(), InFlightFence, nullptr);
+	for (VkFence fence : InFlightFences)
+	{
+		vkDestroyFence(DeviceManager_->GetLogicalDevice(), fence, nullptr);
+	}
 }
 
 
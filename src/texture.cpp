@@ -13,6 +13,53 @@ IVRTexture::~IVRTexture()
     CleanUp();
 }
 
+IVRDecodedImage::~IVRDecodedImage()
+{
+    for (stbi_uc* pixels : Layers)
+    {
+        stbi_image_free(pixels);
+    }
+}
+
+std::shared_ptr<IVRDecodedImage> IVRDecodedImage::Decode(const std::vector<std::string>& paths)
+{
+    std::shared_ptr<IVRDecodedImage> image = std::make_shared<IVRDecodedImage>();
+
+    for (const std::string& path : paths)
+    {
+        int width, height, channels;
+        //STBI_rgb_alpha forces the image to be loaded with an alpha channel (this is for consistency between image formats)
+        stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+        if (pixels == nullptr)
+        {
+            IVR_LOG_ERROR("Failed to load texture image at path {}", path);
+            throw std::runtime_error("Failed to load texture image!");
+        }
+        //owned by the image from here on, freed by its destructor even if a later layer fails
+        image->Layers.push_back(pixels);
+
+        if (image->Layers.size() == 1)
+        {
+            image->Width = width;
+            image->Height = height;
+        }
+        else if (width != image->Width || height != image->Height)
+        {
+            IVR_LOG_ERROR("Texture image at path {} is {}x{}, the other layers are {}x{}", path, width, height, image->Width, image->Height);
+            throw std::runtime_error("Texture layers differ in size!");
+        }
+    }
+
+    return image;
+}
+
+std::shared_ptr<IVRDecodedImage> IVRTexture::TakeDecodedImage(const std::vector<std::string>& paths)
+{
+    std::shared_ptr<IVRDecodedImage> image = DecodedImage_ != nullptr ? DecodedImage_ : IVRDecodedImage::Decode(paths);
+    DecodedImage_.reset();
+    return image;
+}
+
 
 
 void IVRTexture::CreateTextureImageView()
@@ -105,8 +152,8 @@ VkImageView IVRTexture::GetTextureImageView()
 
 void IVRTexture::CleanUp()
 {
-    vkDestroySampler(DeviceManager_->GetLogicalDevice(), TextureSampler_, nullptr);
-    vkDestroyImageView(DeviceManager_->GetLogicalDevice(), TextureImageView_, nullptr);
-    vkDestroyImage(DeviceManager_->GetLogicalDevice(), TextureImage_, nullptr);
-    vkFreeMemory(DeviceManager_->GetLogicalDevice(), TextureImageMemory_, nullptr);
+    std::shared_ptr<IVRDeletionQueue> deletion_queue = DeviceManager_->GetDeletionQueue();
+    deletion_queue->ReleaseSampler(TextureSampler_);
+    deletion_queue->ReleaseImageView(TextureImageView_);
+    deletion_queue->ReleaseImage(TextureImage_, TextureImageAllocation_);
 }
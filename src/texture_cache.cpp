@@ -0,0 +1,87 @@
+#include "texture_cache.h"
+
+IVRTextureCache::IVRTextureCache(std::shared_ptr<IVRDeviceManager> device_manager) :
+	DeviceManager_(device_manager), CreatedCount_(0)
+{
+}
+
+IVRTextureKey IVRTextureCache::GetKey(const std::string& texture_path, bool is_cubemap)
+{
+	if (is_cubemap)
+	{
+		return { texture_path, VK_IMAGE_VIEW_TYPE_CUBE, IVRTextureCube::Format, IVRTextureCube::AddressMode };
+	}
+	return { texture_path, VK_IMAGE_VIEW_TYPE_2D, IVRTexture2D::Format, IVRTexture2D::AddressMode };
+}
+
+void IVRTextureCache::PruneExpired()
+{
+	for (std::map<IVRTextureKey, std::weak_ptr<IVRTexture>>::iterator it = Textures_.begin(); it != Textures_.end();)
+	{
+		if (it->second.expired())
+		{
+			it = Textures_.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+std::shared_ptr<IVRTexture> IVRTextureCache::Find(const std::string& texture_path, bool is_cubemap)
+{
+	std::map<IVRTextureKey, std::weak_ptr<IVRTexture>>::iterator it = Textures_.find(GetKey(texture_path, is_cubemap));
+	if (it == Textures_.end())
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<IVRTexture> texture = it->second.lock();
+	if (texture == nullptr)
+	{
+		Textures_.erase(it);
+	}
+	return texture;
+}
+
+std::shared_ptr<IVRTexture> IVRTextureCache::Acquire(const std::string& texture_path, bool is_cubemap, std::shared_ptr<IVRDecodedImage> decoded_image)
+{
+	std::shared_ptr<IVRTexture> texture = Find(texture_path, is_cubemap);
+	if (texture != nullptr)
+	{
+		return texture;
+	}
+
+	if (is_cubemap)
+	{
+		texture = std::make_shared<IVRTextureCube>(DeviceManager_, texture_path, decoded_image);
+	}
+	else
+	{
+		texture = std::make_shared<IVRTexture2D>(DeviceManager_, texture_path, decoded_image);
+	}
+
+	PruneExpired();
+	Textures_[GetKey(texture_path, is_cubemap)] = texture;
+	CreatedCount_++;
+	return texture;
+}
+
+uint32_t IVRTextureCache::GetTextureCount()
+{
+	PruneExpired();
+	return static_cast<uint32_t>(Textures_.size());
+}
+
+void IVRTextureCache::LogStats()
+{
+	PruneExpired();
+
+	long user_count = 0;
+	for (std::pair<const IVRTextureKey, std::weak_ptr<IVRTexture>>& texture : Textures_)
+	{
+		user_count += texture.second.use_count();
+	}
+	IVR_LOG_INFO("Texture cache : {} textures loaded for {} users, {} uploaded since creation", Textures_.size(), user_count, CreatedCount_);
+}
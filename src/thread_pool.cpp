@@ -0,0 +1,94 @@
+#include "thread_pool.h"
+
+IVRThreadPool::IVRThreadPool(uint32_t thread_count) :
+	ActiveTaskCount_(0), IsStopping_(false)
+{
+	if (thread_count == 0)
+	{
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		Workers_.emplace_back(&IVRThreadPool::WorkerLoop, this, i);
+	}
+}
+
+IVRThreadPool::~IVRThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex_);
+		IsStopping_ = true;
+	}
+	TaskAvailable_.notify_all();
+
+	for (std::thread& worker : Workers_)
+	{
+		worker.join();
+	}
+}
+
+void IVRThreadPool::Submit(std::function<void(uint32_t thread_index)> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex_);
+		Tasks_.push(task);
+	}
+	TaskAvailable_.notify_one();
+}
+
+void IVRThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(Mutex_);
+	AllTasksDone_.wait(lock, [this]() { return Tasks_.empty() && ActiveTaskCount_ == 0; });
+
+	if (FirstException_)
+	{
+		std::exception_ptr exception = FirstException_;
+		FirstException_ = nullptr;
+		std::rethrow_exception(exception);
+	}
+}
+
+void IVRThreadPool::WorkerLoop(uint32_t thread_index)
+{
+	while (true)
+	{
+		std::function<void(uint32_t)> task;
+		{
+			std::unique_lock<std::mutex> lock(Mutex_);
+			TaskAvailable_.wait(lock, [this]() { return IsStopping_ || !Tasks_.empty(); });
+
+			if (IsStopping_ && Tasks_.empty())
+			{
+				return;
+			}
+
+			task = std::move(Tasks_.front());
+			Tasks_.pop();
+			ActiveTaskCount_++;
+		}
+
+		try
+		{
+			task(thread_index);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(Mutex_);
+			if (!FirstException_)
+			{
+				FirstException_ = std::current_exception();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(Mutex_);
+			ActiveTaskCount_--;
+			if (Tasks_.empty() && ActiveTaskCount_ == 0)
+			{
+				AllTasksDone_.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,28 @@
+#include "transform_buffer.h"
+
+#include <algorithm>
+
+IVRTransformBuffer::IVRTransformBuffer(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, uint32_t capacity) :
+	Allocator_(device_manager->GetMemoryAllocator()), FramesInFlight_(frames_in_flight), Capacity_(std::max(capacity, 1u))
+{
+	Buffers_.resize(FramesInFlight_);
+	Allocations_.resize(FramesInFlight_);
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
+	{
+		//written by the cpu every frame and read once per vertex, so it stays in host visible memory like the uniform arena
+		IVRBufferUtilities::Spawn(Allocator_, GetBufferSize(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			IVRMemoryCategory::Uniform, Buffers_[i], Allocations_[i]);
+	}
+
+	IVR_LOG_INFO("Created a transform buffer for {} objects ({:.2f} KB per frame in flight)", Capacity_, GetBufferSize() / 1024.0);
+}
+
+IVRTransformBuffer::~IVRTransformBuffer()
+{
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
+	{
+		IVRBufferUtilities::Destroy(Allocator_, Buffers_[i], Allocations_[i]);
+	}
+}
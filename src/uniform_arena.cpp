@@ -0,0 +1,61 @@
+#include "uniform_arena.h"
+
+#include <algorithm>
+
+IVRUniformArena::IVRUniformArena(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, VkDeviceSize capacity) :
+	Allocator_(device_manager->GetMemoryAllocator()), FramesInFlight_(frames_in_flight), Capacity_(capacity), Head_(0), AllocationCount_(0)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(device_manager->GetPhysicalDevice(), &properties);
+	Alignment_ = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 16);
+
+	Buffers_.resize(FramesInFlight_);
+	Allocations_.resize(FramesInFlight_);
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
+	{
+		IVRBufferUtilities::Spawn(Allocator_, Capacity_,
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			IVRMemoryCategory::Uniform, Buffers_[i], Allocations_[i]);
+	}
+}
+
+IVRUniformArena::~IVRUniformArena()
+{
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
+	{
+		IVRBufferUtilities::Destroy(Allocator_, Buffers_[i], Allocations_[i]);
+	}
+}
+
+uint32_t IVRUniformArena::Allocate(VkDeviceSize size)
+{
+	VkDeviceSize offset = (Head_ + Alignment_ - 1) / Alignment_ * Alignment_;
+	if (offset + size > Capacity_)
+	{
+		throw std::runtime_error("IVRUniformArena::Allocate: the uniform arena is full");
+	}
+
+	Head_ = offset + size;
+	AllocationCount_++;
+	return static_cast<uint32_t>(offset);
+}
+
+void IVRUniformArena::Write(uint32_t frame_index, uint32_t offset, const void* data, VkDeviceSize size)
+{
+	memcpy(static_cast<char*>(Allocations_[frame_index].MappedData) + offset, data, static_cast<size_t>(size));
+}
+
+void IVRUniformArena::WriteAllFrames(uint32_t offset, const void* data, VkDeviceSize size)
+{
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
+	{
+		Write(i, offset, data, size);
+	}
+}
+
+void IVRUniformArena::LogStats()
+{
+	IVR_LOG_INFO("Uniform arena : {} allocations, {:.2f}/{:.2f} KB used per frame in flight", AllocationCount_,
+		Head_ / 1024.0, Capacity_ / 1024.0);
+}
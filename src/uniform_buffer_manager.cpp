@@ -14,21 +14,21 @@ IVRUBManager::~IVRUBManager()
 void IVRUBManager::CreateUniformBuffer()
 {
     IVRBufferUtilities::Spawn(
-        DeviceManager_->GetLogicalDevice(), DeviceManager_->GetPhysicalDevice(),
+        DeviceManager_->GetMemoryAllocator(),
         BufferSize_, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        UniformBuffer, UniformBuffersMemory);
+        IVRMemoryCategory::Uniform, UniformBuffer, UniformBufferAllocation);
         
-    vkMapMemory(DeviceManager_->GetLogicalDevice(), UniformBuffersMemory, 0, BufferSize_, 0, &UniformBuffersMapped);
-    //the buffer is now mapped to a memory that the host can write to
+    UniformBuffersMapped = UniformBufferAllocation.MappedData;
+    //the buffer is in a memory block that the allocator mapped for the host to write to
     //this mapping will stay for the application's lifetime (Persistent Mapping)
     
 }
 
 void IVRUBManager::DestroyUniformBuffer()
 {
-    vkDestroyBuffer(DeviceManager_->GetLogicalDevice(), UniformBuffer, nullptr);
-    vkFreeMemory(DeviceManager_->GetLogicalDevice(), UniformBuffersMemory, nullptr);
+    //frames in flight may still read it
+    DeviceManager_->GetDeletionQueue()->ReleaseBuffer(UniformBuffer, UniformBufferAllocation);
 }
 
 void IVRUBManager::WriteToUniformBuffer(void* source_memory, VkDeviceSize source_object_size)
@@ -0,0 +1,545 @@
+#include "upload_manager.h"
+
+#include <cstring>
+#include <algorithm>
+
+IVRUploadManager::IVRUploadManager(std::shared_ptr<IVRMemoryAllocator> allocator, std::shared_ptr<IVRStagingRing> staging_ring, uint32_t graphics_family, VkQueue graphics_queue,
+	uint32_t transfer_family, VkQueue transfer_queue, bool is_timeline_semaphore_enabled) :
+	Allocator_(allocator), StagingRing_(staging_ring), LogicalDevice_(allocator->GetLogicalDevice()), GraphicsFamily_(graphics_family), TransferFamily_(transfer_family),
+	GraphicsQueue_(graphics_queue), TransferQueue_(transfer_queue), IsDedicatedTransferEnabled_(false), IsTimelineEnabled_(is_timeline_semaphore_enabled),
+	GraphicsCommandPool_(VK_NULL_HANDLE), TransferCommandPool_(VK_NULL_HANDLE), UploadFence_(VK_NULL_HANDLE),
+	CopyTimeline_(VK_NULL_HANDLE), CopyTimelineValue_(0), AcquireTimeline_(VK_NULL_HANDLE), AcquireTimelineValue_(0),
+	CopyCommandBuffer_(VK_NULL_HANDLE), AcquireCommandBuffer_(VK_NULL_HANDLE), AcquireStages_(0),
+	IsBatchOpen_(false), BatchUploadCount_(0), BatchSubmissionCount_(0), BatchUploadedBytes_(0)
+{
+	//the graphics side acquire has to wait on the transfer side copy, which needs a semaphore that can be waited on from both the gpu and the cpu
+	IsDedicatedTransferEnabled_ = transfer_family != graphics_family && is_timeline_semaphore_enabled;
+
+	if (transfer_family != graphics_family && !is_timeline_semaphore_enabled)
+	{
+		IVR_LOG_WARNING("The device has a dedicated transfer queue but no timeline semaphores, uploads will use the graphics queue");
+	}
+
+	//a chunk always fits into the ring once the submissions before it have completed
+	MaxChunkSize_ = StagingRing_->GetSize() / 4;
+
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(Allocator_->GetPhysicalDevice(), &queue_family_count, nullptr);
+	std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(Allocator_->GetPhysicalDevice(), &queue_family_count, queue_families.data());
+	CopyGranularity_ = queue_families[IsDedicatedTransferEnabled_ ? TransferFamily_ : GraphicsFamily_].minImageTransferGranularity;
+
+	VkCommandPoolCreateInfo pool_info{};
+	pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_info.queueFamilyIndex = GraphicsFamily_;
+
+	if (vkCreateCommandPool(LogicalDevice_, &pool_info, nullptr, &GraphicsCommandPool_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create the upload command pool!");
+	}
+
+	if (IsDedicatedTransferEnabled_)
+	{
+		IVR_LOG_INFO("Uploading on the dedicated transfer queue family {}", TransferFamily_);
+
+		pool_info.queueFamilyIndex = TransferFamily_;
+		if (vkCreateCommandPool(LogicalDevice_, &pool_info, nullptr, &TransferCommandPool_) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the transfer command pool!");
+		}
+	}
+	else
+	{
+		IVR_LOG_INFO("Uploading on the graphics queue");
+	}
+
+	if (IsTimelineEnabled_)
+	{
+		CopyTimeline_ = CreateTimeline();
+		if (IsDedicatedTransferEnabled_)
+		{
+			AcquireTimeline_ = CreateTimeline();
+		}
+	}
+	else
+	{
+		VkFenceCreateInfo fence_create_info{};
+		fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(LogicalDevice_, &fence_create_info, nullptr, &UploadFence_) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create the upload fence!");
+		}
+	}
+}
+
+IVRUploadManager::~IVRUploadManager()
+{
+	if (IsBatchOpen_)
+	{
+		EndBatch();
+	}
+	WaitIdle();
+
+	if (CopyTimeline_ != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(LogicalDevice_, CopyTimeline_, nullptr);
+	}
+	if (AcquireTimeline_ != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(LogicalDevice_, AcquireTimeline_, nullptr);
+	}
+	if (UploadFence_ != VK_NULL_HANDLE)
+	{
+		vkDestroyFence(LogicalDevice_, UploadFence_, nullptr);
+	}
+	if (TransferCommandPool_ != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(LogicalDevice_, TransferCommandPool_, nullptr);
+	}
+	vkDestroyCommandPool(LogicalDevice_, GraphicsCommandPool_, nullptr);
+}
+
+VkSemaphore IVRUploadManager::CreateTimeline()
+{
+	VkSemaphoreTypeCreateInfo timeline_create_info{};
+	timeline_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	timeline_create_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	timeline_create_info.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphore_create_info{};
+	semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphore_create_info.pNext = &timeline_create_info;
+
+	VkSemaphore timeline;
+	if (vkCreateSemaphore(LogicalDevice_, &semaphore_create_info, nullptr, &timeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create an upload timeline semaphore!");
+	}
+	return timeline;
+}
+
+void IVRUploadManager::UploadToBuffer(const void* data, VkDeviceSize size, VkBuffer dst_buffer, VkDeviceSize dst_offset, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access,
+	bool is_shared)
+{
+	//nothing to copy, and a buffer barrier may not have a size of 0
+	if (size == 0)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(Mutex_);
+
+	BeginRecording();
+
+	for (VkDeviceSize chunk_offset = 0; chunk_offset < size; chunk_offset += MaxChunkSize_)
+	{
+		VkDeviceSize chunk_size = std::min(MaxChunkSize_, size - chunk_offset);
+		VkDeviceSize staging_offset = AllocateStaging(chunk_size);
+		memcpy(static_cast<char*>(StagingRing_->GetMappedData()) + staging_offset, static_cast<const char*>(data) + chunk_offset, static_cast<size_t>(chunk_size));
+
+		//AllocateStaging may have submitted the previous chunks, the copy goes into whatever command buffer is open now
+		VkBufferCopy copy_region{};
+		copy_region.srcOffset = staging_offset;
+		copy_region.dstOffset = dst_offset + chunk_offset;
+		copy_region.size = chunk_size;
+		vkCmdCopyBuffer(CopyCommandBuffer_, StagingRing_->GetBuffer(), dst_buffer, 1, &copy_region);
+	}
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.buffer = dst_buffer;
+	barrier.offset = dst_offset;
+	barrier.size = size;
+	barrier.srcQueueFamilyIndex = IsDedicatedTransferEnabled_ && !is_shared ? TransferFamily_ : VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = IsDedicatedTransferEnabled_ && !is_shared ? GraphicsFamily_ : VK_QUEUE_FAMILY_IGNORED;
+
+	if (IsDedicatedTransferEnabled_ && !is_shared)
+	{
+		//release : makes the copy available, the access that uses the buffer is only known (and only valid) on the acquiring queue
+		//the copies of chunks that went out in earlier submissions on the same queue are in the barrier's first scope too
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(CopyCommandBuffer_, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	EndUpload(size, [&](VkCommandBuffer command_buffer) {
+		//a shared buffer needs no acquire, the timeline semaphore wait already makes the copy visible to the graphics queue
+		if (IsDedicatedTransferEnabled_ && is_shared)
+		{
+			return;
+		}
+
+		//acquire (or, on a single queue, the plain transfer write -> read dependency)
+		barrier.srcAccessMask = IsDedicatedTransferEnabled_ ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dst_access;
+		//the acquire's first scope is the stage the timeline semaphore wait blocks, so the two chain together
+		vkCmdPipelineBarrier(command_buffer, IsDedicatedTransferEnabled_ ? dst_stage : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TRANSFER_BIT), dst_stage,
+			0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}, dst_stage);
+}
+
+void IVRUploadManager::UploadToImage(const std::vector<const void*>& layers, VkDeviceSize layer_size, VkImage image, uint32_t width, uint32_t height)
+{
+	//nothing to copy (the image is then left in the UNDEFINED layout)
+	if (layers.empty() || layer_size == 0 || width == 0 || height == 0)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(Mutex_);
+
+	uint32_t layer_count = static_cast<uint32_t>(layers.size());
+
+	//layers larger than a chunk are copied a band of rows at a time. Band offsets have to be multiples of the queue's transfer granularity
+	//(a granularity of 0 only allows whole images)
+	VkDeviceSize row_size = layer_size / height;
+	uint32_t rows_per_chunk = static_cast<uint32_t>(std::min<VkDeviceSize>(height, MaxChunkSize_ / row_size));
+	if (CopyGranularity_.height == 0)
+	{
+		rows_per_chunk = height;
+	}
+	else if (rows_per_chunk < height)
+	{
+		rows_per_chunk -= rows_per_chunk % CopyGranularity_.height;
+	}
+
+	if (rows_per_chunk == 0 || row_size * rows_per_chunk > MaxChunkSize_)
+	{
+		throw std::runtime_error("image is too large to be uploaded through the staging ring");
+	}
+
+	BeginRecording();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = layer_count;
+
+	//the image has no contents yet, so it does not need to be acquired by the transfer queue family before the copy
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(CopyCommandBuffer_, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	for (uint32_t layer = 0; layer < layer_count; layer++)
+	{
+		for (uint32_t row = 0; row < height; row += rows_per_chunk)
+		{
+			uint32_t row_count = std::min(rows_per_chunk, height - row);
+			VkDeviceSize chunk_size = row_size * row_count;
+			VkDeviceSize staging_offset = AllocateStaging(chunk_size);
+			memcpy(static_cast<char*>(StagingRing_->GetMappedData()) + staging_offset, static_cast<const char*>(layers[layer]) + row_size * row,
+				static_cast<size_t>(chunk_size));
+
+			VkBufferImageCopy region{};
+			region.bufferOffset = staging_offset;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = 0;
+			region.imageSubresource.baseArrayLayer = layer;
+			region.imageSubresource.layerCount = 1;
+			region.imageOffset = { 0, static_cast<int32_t>(row), 0 };
+			region.imageExtent = { width, row_count, 1 };
+			vkCmdCopyBufferToImage(CopyCommandBuffer_, StagingRing_->GetBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		}
+	}
+
+	//the transition to the sampled layout is part of the ownership transfer, release and acquire must both specify it
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcQueueFamilyIndex = IsDedicatedTransferEnabled_ ? TransferFamily_ : VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = IsDedicatedTransferEnabled_ ? GraphicsFamily_ : VK_QUEUE_FAMILY_IGNORED;
+
+	if (IsDedicatedTransferEnabled_)
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(CopyCommandBuffer_, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+
+	EndUpload(layer_size * layer_count, [&](VkCommandBuffer command_buffer) {
+		barrier.srcAccessMask = IsDedicatedTransferEnabled_ ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, IsDedicatedTransferEnabled_ ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+}
+
+std::vector<uint32_t> IVRUploadManager::GetSharedQueueFamilies()
+{
+	if (!IsDedicatedTransferEnabled_)
+	{
+		return {};
+	}
+	return { GraphicsFamily_, TransferFamily_ };
+}
+
+void IVRUploadManager::BeginBatch()
+{
+	std::lock_guard<std::mutex> lock(Mutex_);
+
+	if (IsBatchOpen_)
+	{
+		throw std::runtime_error("an upload batch is already open");
+	}
+
+	IsBatchOpen_ = true;
+	BatchUploadCount_ = 0;
+	BatchSubmissionCount_ = 0;
+	BatchUploadedBytes_ = 0;
+}
+
+void IVRUploadManager::EndBatch()
+{
+	std::lock_guard<std::mutex> lock(Mutex_);
+
+	if (!IsBatchOpen_)
+	{
+		throw std::runtime_error("there is no open upload batch to end");
+	}
+	IsBatchOpen_ = false;
+
+	if (CopyCommandBuffer_ != VK_NULL_HANDLE)
+	{
+		SubmitRecording();
+	}
+
+	if (BatchUploadCount_ > 0)
+	{
+		IVR_LOG_INFO("Uploaded {} resources ({:.2f} MB) in {} submissions", BatchUploadCount_, BatchUploadedBytes_ / (1024.0 * 1024.0), BatchSubmissionCount_);
+	}
+}
+
+VkCommandBuffer IVRUploadManager::BeginCommands(VkCommandPool command_pool)
+{
+	VkCommandBufferAllocateInfo alloc_info{};
+	alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	alloc_info.commandPool = command_pool;
+	alloc_info.commandBufferCount = 1;
+
+	VkCommandBuffer command_buffer;
+	if (vkAllocateCommandBuffers(LogicalDevice_, &alloc_info, &command_buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate an upload command buffer!");
+	}
+
+	VkCommandBufferBeginInfo begin_info{};
+	begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(command_buffer, &begin_info);
+
+	return command_buffer;
+}
+
+void IVRUploadManager::BeginRecording()
+{
+	if (CopyCommandBuffer_ == VK_NULL_HANDLE)
+	{
+		CopyCommandBuffer_ = BeginCommands(IsDedicatedTransferEnabled_ ? TransferCommandPool_ : GraphicsCommandPool_);
+	}
+	if (IsDedicatedTransferEnabled_ && AcquireCommandBuffer_ == VK_NULL_HANDLE)
+	{
+		AcquireCommandBuffer_ = BeginCommands(GraphicsCommandPool_);
+	}
+}
+
+VkDeviceSize IVRUploadManager::AllocateStaging(VkDeviceSize size)
+{
+	VkDeviceSize offset;
+	while (!StagingRing_->Allocate(size, StagingAlignment_, offset))
+	{
+		uint64_t oldest_value;
+		if (StagingRing_->GetOldestCompletionValue(oldest_value))
+		{
+			//the staging data is only read by the copies
+			WaitForValue(CopyTimeline_, oldest_value);
+			ReleaseFinished();
+		}
+		else
+		{
+			//the ring is full of chunks that are only recorded so far, submit them and carry on in new command buffers
+			SubmitRecording();
+			BeginRecording();
+		}
+	}
+	return offset;
+}
+
+void IVRUploadManager::EndUpload(VkDeviceSize size, const std::function<void(VkCommandBuffer)>& record_acquire, VkPipelineStageFlags acquire_stage)
+{
+	//single queue : the read barrier follows the copy in the same command buffer
+	record_acquire(IsDedicatedTransferEnabled_ ? AcquireCommandBuffer_ : CopyCommandBuffer_);
+	AcquireStages_ |= acquire_stage;
+
+	if (IsBatchOpen_)
+	{
+		BatchUploadCount_++;
+		BatchUploadedBytes_ += size;
+		return;
+	}
+
+	SubmitRecording();
+}
+
+void IVRUploadManager::SubmitRecording()
+{
+	vkEndCommandBuffer(CopyCommandBuffer_);
+
+	VkCommandPool copy_command_pool = IsDedicatedTransferEnabled_ ? TransferCommandPool_ : GraphicsCommandPool_;
+	uint64_t copy_value = ++CopyTimelineValue_;
+
+	VkTimelineSemaphoreSubmitInfo copy_timeline_info{};
+	copy_timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	copy_timeline_info.signalSemaphoreValueCount = 1;
+	copy_timeline_info.pSignalSemaphoreValues = &copy_value;
+
+	VkSubmitInfo copy_submit_info{};
+	copy_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	copy_submit_info.commandBufferCount = 1;
+	copy_submit_info.pCommandBuffers = &CopyCommandBuffer_;
+	if (IsTimelineEnabled_)
+	{
+		copy_submit_info.pNext = &copy_timeline_info;
+		copy_submit_info.signalSemaphoreCount = 1;
+		copy_submit_info.pSignalSemaphores = &CopyTimeline_;
+	}
+
+	if (vkQueueSubmit(IsDedicatedTransferEnabled_ ? TransferQueue_ : GraphicsQueue_, 1, &copy_submit_info, UploadFence_) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to submit an upload!");
+	}
+
+	//the staging chunks recorded so far are free once the copy has completed
+	StagingRing_->MarkSubmitted(copy_value);
+	BatchSubmissionCount_++;
+
+	if (!IsTimelineEnabled_)
+	{
+		//unlike vkQueueWaitIdle this does not wait for frames that were submitted before the upload
+		vkWaitForFences(LogicalDevice_, 1, &UploadFence_, VK_TRUE, UINT64_MAX);
+		vkResetFences(LogicalDevice_, 1, &UploadFence_);
+		vkFreeCommandBuffers(LogicalDevice_, copy_command_pool, 1, &CopyCommandBuffer_);
+	}
+	else
+	{
+		PendingCommandBuffers_.push_back({ CopyCommandBuffer_, copy_command_pool, copy_value, false });
+	}
+	CopyCommandBuffer_ = VK_NULL_HANDLE;
+
+	//when the ring filled up before the first resource of the recording was finished there is nothing to acquire yet,
+	//the acquire command buffer then stays open for the next recording
+	if (AcquireCommandBuffer_ != VK_NULL_HANDLE && AcquireStages_ != 0)
+	{
+		vkEndCommandBuffer(AcquireCommandBuffer_);
+
+		//the acquire waits on the copy timeline and signals its own : the graphics queue may run it long after later copies completed
+		uint64_t acquire_value = ++AcquireTimelineValue_;
+
+		VkTimelineSemaphoreSubmitInfo acquire_timeline_info{};
+		acquire_timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		acquire_timeline_info.waitSemaphoreValueCount = 1;
+		acquire_timeline_info.pWaitSemaphoreValues = &copy_value;
+		acquire_timeline_info.signalSemaphoreValueCount = 1;
+		acquire_timeline_info.pSignalSemaphoreValues = &acquire_value;
+
+		VkSubmitInfo acquire_submit_info{};
+		acquire_submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquire_submit_info.pNext = &acquire_timeline_info;
+		acquire_submit_info.waitSemaphoreCount = 1;
+		acquire_submit_info.pWaitSemaphores = &CopyTimeline_;
+		acquire_submit_info.pWaitDstStageMask = &AcquireStages_;
+		acquire_submit_info.commandBufferCount = 1;
+		acquire_submit_info.pCommandBuffers = &AcquireCommandBuffer_;
+		acquire_submit_info.signalSemaphoreCount = 1;
+		acquire_submit_info.pSignalSemaphores = &AcquireTimeline_;
+
+		if (vkQueueSubmit(GraphicsQueue_, 1, &acquire_submit_info, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit an upload acquire to the graphics queue!");
+		}
+
+		PendingCommandBuffers_.push_back({ AcquireCommandBuffer_, GraphicsCommandPool_, acquire_value, true });
+		AcquireCommandBuffer_ = VK_NULL_HANDLE;
+	}
+	AcquireStages_ = 0;
+
+	ReleaseFinished();
+}
+
+uint64_t IVRUploadManager::GetCompletedValue(VkSemaphore timeline, uint64_t last_value)
+{
+	if (!IsTimelineEnabled_ || timeline == VK_NULL_HANDLE)
+	{
+		//every submission has been waited for
+		return last_value;
+	}
+
+	uint64_t completed_value = 0;
+	vkGetSemaphoreCounterValue(LogicalDevice_, timeline, &completed_value);
+	return completed_value;
+}
+
+void IVRUploadManager::WaitForValue(VkSemaphore timeline, uint64_t value)
+{
+	if (!IsTimelineEnabled_ || timeline == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	VkSemaphoreWaitInfo wait_info{};
+	wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	wait_info.semaphoreCount = 1;
+	wait_info.pSemaphores = &timeline;
+	wait_info.pValues = &value;
+	vkWaitSemaphores(LogicalDevice_, &wait_info, UINT64_MAX);
+}
+
+void IVRUploadManager::ReleaseFinished()
+{
+	uint64_t completed_copy_value = GetCompletedValue(CopyTimeline_, CopyTimelineValue_);
+	uint64_t completed_acquire_value = GetCompletedValue(AcquireTimeline_, AcquireTimelineValue_);
+
+	StagingRing_->Reclaim(completed_copy_value);
+
+	std::vector<PendingCommandBuffer> still_pending;
+	for (const PendingCommandBuffer& pending : PendingCommandBuffers_)
+	{
+		if (pending.TimelineValue <= (pending.IsAcquire ? completed_acquire_value : completed_copy_value))
+		{
+			vkFreeCommandBuffers(LogicalDevice_, pending.CommandPool, 1, &pending.CommandBuffer);
+		}
+		else
+		{
+			still_pending.push_back(pending);
+		}
+	}
+	PendingCommandBuffers_.swap(still_pending);
+}
+
+void IVRUploadManager::WaitIdle()
+{
+	std::lock_guard<std::mutex> lock(Mutex_);
+
+	//an acquire command buffer left open with nothing recorded into it (an upload failed after filling the ring)
+	if (AcquireCommandBuffer_ != VK_NULL_HANDLE && CopyCommandBuffer_ == VK_NULL_HANDLE)
+	{
+		vkEndCommandBuffer(AcquireCommandBuffer_);
+		vkFreeCommandBuffers(LogicalDevice_, GraphicsCommandPool_, 1, &AcquireCommandBuffer_);
+		AcquireCommandBuffer_ = VK_NULL_HANDLE;
+	}
+
+	WaitForValue(CopyTimeline_, CopyTimelineValue_);
+	WaitForValue(AcquireTimeline_, AcquireTimelineValue_);
+	ReleaseFinished();
+}
@@ -1,8 +1,13 @@
 #include "world.h"
+#include "ivr_path.h"
 
-IVRWorld::IVRWorld(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t swapchain_image_count) :
-	DeviceManager_(device_manager), SwapchainImageCount_(swapchain_image_count)
+IVRWorld::IVRWorld(std::shared_ptr<IVRDeviceManager> device_manager, uint32_t frames_in_flight, uint32_t loading_thread_count, std::string scene_directory) :
+	DeviceManager_(device_manager), FramesInFlight_(frames_in_flight), LoadingThreadCount_(loading_thread_count), SceneDirectory_(scene_directory), StructureVersion_(0)
 {
+	if (SceneDirectory_.empty())
+	{
+		SceneDirectory_ = IVRPath::GetCrossPlatformPath({ "scene" });
+	}
 }
 
 //runs in the beginning
@@ -12,15 +17,48 @@ void IVRWorld::Init()
 	
 	DescriptorManager_ = std::make_shared<IVRDescriptorManager>(DeviceManager_);
 	SMDescriptorManager_ = std::make_shared<IVRDescriptorManager>(DeviceManager_);
-	LightManager_ = std::make_shared<IVRLightManager>(DeviceManager_, SwapchainImageCount_);
+	LightManager_ = std::make_shared<IVRLightManager>(DeviceManager_, FramesInFlight_);
 
 	SetupCamera();
 	
-	IVRWorldLoader world_loader(DeviceManager_, LightManager_, Camera_, SwapchainImageCount_);
+	for (uint32_t i = 0; i < static_cast<uint32_t>(IVRVertexLayout::Count); i++)
+	{
+		MeshArenas_.push_back(std::make_shared<IVRMeshArena>(DeviceManager_, IVRModel::GetVertexStride(static_cast<IVRVertexLayout>(i))));
+	}
+	ModelRegistry_ = std::make_shared<IVRModelRegistry>(DeviceManager_, MeshArenas_);
+	TextureCache_ = std::make_shared<IVRTextureCache>(DeviceManager_);
+	UniformArena_ = std::make_shared<IVRUniformArena>(DeviceManager_, FramesInFlight_, UniformArenaSize_);
+	CameraUBOffset_ = UniformArena_->Allocate(sizeof(CameraUBObj));
+	LightUBOffset_ = UniformArena_->Allocate(sizeof(ShadowMapLightUBObj));
+	MaterialTable_ = std::make_shared<IVRMaterialTable>(DeviceManager_, FramesInFlight_, MaterialTableCapacity_);
+
+	IVRWorldLoader world_loader(DeviceManager_, ModelRegistry_, TextureCache_, UniformArena_, MaterialTable_, LightManager_, Camera_, FramesInFlight_, SceneDirectory_,
+		LoadingThreadCount_);
 
 	LightManager_->SetupLights(world_loader.LoadLightsFromJson());
+
+	//the geometry and textures of the whole scene are uploaded in one submission (one per staging ring full of data)
+	DeviceManager_->GetUploadManager()->BeginBatch();
 	BaseMaterials_ = world_loader.LoadBaseMaterialsFromJson();
 	RenderObjects_ = world_loader.LoadRenderObjectsFromJson();
+	MaterialTable_->FlushAll();
+	DeviceManager_->GetUploadManager()->EndBatch();
+	ModelRegistry_->LogStats();
+	TextureCache_->LogStats();
+	for (std::shared_ptr<IVRMeshArena>& mesh_arena : MeshArenas_)
+	{
+		mesh_arena->LogStats();
+	}
+	MaterialTable_->LogStats();
+
+	//render objects are never added after loading, the transform index is the position in RenderObjects_
+	TransformBuffer_ = std::make_shared<IVRTransformBuffer>(DeviceManager_, FramesInFlight_, static_cast<uint32_t>(RenderObjects_.size()));
+	for (uint32_t i = 0; i < RenderObjects_.size(); i++)
+	{
+		RenderObjects_[i]->SetTransformIndex(i);
+		RenderObjects_[i]->GetMaterialInstance()->AssignFrameUniformOffsets(CameraUBOffset_, LightUBOffset_);
+		RenderObjects_[i]->GetMaterialInstance()->AssignTransformBuffer(TransformBuffer_);
+	}
 	OrganizeRenderObjectsByBaseMaterial();
 	
 	CreateDescriptorSetLayoutsForBaseMaterials();
@@ -36,25 +74,38 @@ void IVRWorld::PostShadowMapperInit()
 	CreateShadowMapMaterialDescriptorSets();
 	WriteShadowMapMaterialDescriptorSets();
 
-	//sharing light mvp uniform buffer from shadow map materials to base materials
-	for (std::shared_ptr<IVRRenderObject> render_object : RenderObjects_)
-	{
-		render_object->AssignLightMVPUBToMaterialInstance();
-	}
 	WriteDescriptorSets(); //the material descriptor sets (which also include the depth texture from the shadow map)
+	MarkStructureChanged();
+	UniformArena_->LogStats();
 }
 
 //runs every frame
-void IVRWorld::Update(float dt, uint32_t swapchain_index)
+void IVRWorld::Update(float dt, uint32_t frame_index)
 {
 	Camera_->MoveCamera(dt);
-	LightManager_->TransformLightsByViewMatrix(Camera_->GetViewMatrix(), swapchain_index);
-	for (std::shared_ptr<IVRRenderObject> render_object : RenderObjects_)
+	LightManager_->TransformLightsByViewMatrix(Camera_->GetViewMatrix(), frame_index);
+
+	//the per frame uniform writes, every object reads these
+	CameraUBObj camera_ubobj;
+	camera_ubobj.View = Camera_->GetViewMatrix();
+	camera_ubobj.Proj = Camera_->GetProjectionMatrix();
+	UniformArena_->Write(frame_index, CameraUBOffset_, &camera_ubobj, sizeof(CameraUBObj));
+
+	ShadowMapLightUBObj light_ubobj;
+	light_ubobj.LightView = LightManager_->GetLight(0).GetLightView();
+	light_ubobj.LightProjection = LightManager_->GetLight(0).GetLightProjection(Camera_->FieldOfView, Camera_->AspectRatio, Camera_->NearPlane, Camera_->FarPlane);
+	UniformArena_->Write(frame_index, LightUBOffset_, &light_ubobj, sizeof(ShadowMapLightUBObj));
+
+	//every object's model matrix, in one front to back pass over the frame's transform buffer
+	ObjectTransform* transforms = TransformBuffer_->GetMappedTransforms(frame_index);
+	for (size_t i = 0; i < RenderObjects_.size(); i++)
 	{
-		render_object->UpdateMVPMatrixUB(swapchain_index);
-		render_object->UpdateLightMVPUB(swapchain_index, LightManager_->GetLight(0).GetLightView(), 
-			LightManager_->GetLight(0).GetLightProjection(Camera_->FieldOfView, Camera_->AspectRatio, Camera_->NearPlane, Camera_->FarPlane));
+		transforms[i] = ObjectTransform::FromModelMatrix(RenderObjects_[i]->GetModelMatrix());
 	}
+
+	//uploads the entries of materials edited since this frame index last ran (nothing most frames) into this frame's copy,
+	//which the frame that last used it (its fence was waited on) no longer reads
+	MaterialTable_->Flush(frame_index);
 }
 
 
@@ -81,6 +132,7 @@ void IVRWorld::OrganizeRenderObjectsByBaseMaterial()
 		std::shared_ptr<IVRBaseMaterial> base_material = render_object->GetMaterialInstance()->GetBaseMaterial();
 		BaseMaterialRenderObjectMap_[base_material].push_back(render_object);
 	}
+	MarkStructureChanged();
 }
 
 std::unordered_map<std::shared_ptr<IVRBaseMaterial>, std::vector<std::shared_ptr<IVRRenderObject>>>& IVRWorld::GetBaseMaterialRenderObjectMap()
@@ -141,17 +193,17 @@ void IVRWorld::CreateDescriptorSets()
 
 	std::vector<VkDescriptorPoolSize> pool_sizes = CountPoolSizes();
 
-	DescriptorManager_->CreateDescriptorPool(pool_sizes, RenderObjects_.size() * SwapchainImageCount_); 
+	DescriptorManager_->CreateDescriptorPool(pool_sizes, RenderObjects_.size() * FramesInFlight_); 
 	//*IMP* Note : this is incorrect because the same material can be used by multiple render objects. 
 	//So the pool size should be calculated by looping over materials and not render objects
 	
 	//create descriptor set for each material
 	for (std::shared_ptr<IVRRenderObject> render_object : RenderObjects_)
 	{
-		for (uint32_t i = 0; i < SwapchainImageCount_; i++) 
+		for (uint32_t i = 0; i < FramesInFlight_; i++) 
 		{
 			VkDescriptorSet descriptor_set = DescriptorManager_->CreateDescriptorSet(render_object->GetMaterialInstance()->GetBaseMaterial()->GetDescriptorSetLayout());
-			render_object->GetMaterialInstance()->AssignDescriptorSet(descriptor_set);
+			render_object->GetMaterialInstance()->AssignDescriptorSet(descriptor_set, DescriptorManager_);
 		}
 	}
 }
@@ -162,7 +214,7 @@ void IVRWorld::WriteDescriptorSets()
 	//for each render object
 	for (std::shared_ptr<IVRRenderObject> render_object : RenderObjects_)
 	{
-		for (uint32_t i = 0; i < SwapchainImageCount_; i++)
+		for (uint32_t i = 0; i < FramesInFlight_; i++)
 		{
 			render_object->GetMaterialInstance()->WriteToDescriptorSet(i);
 		}
@@ -171,65 +223,42 @@ void IVRWorld::WriteDescriptorSets()
 
 void IVRWorld::InitShadowMapMaterials(IVRDescriptorSetInfo descriptor_set_info)
 {
+	ShadowmapMaterial_ = std::make_shared<IVRShadowmapMaterial>(DeviceManager_, UniformArena_, LightUBOffset_, TransformBuffer_,
+		descriptor_set_info, FramesInFlight_);
 	for (std::shared_ptr<IVRRenderObject> render_object : RenderObjects_)
 	{
-		std::shared_ptr<IVRShadowmapMaterial> sm_mat = std::make_shared<IVRShadowmapMaterial>(DeviceManager_, descriptor_set_info, SwapchainImageCount_);
-		render_object->AssignShadowmapMaterial(sm_mat);
+		render_object->AssignShadowmapMaterial(ShadowmapMaterial_);
 	}
 }
 
 void IVRWorld::AssignDescriptorSetLayoutToShadowMapMaterials()
 {
-	for (std::shared_ptr<IVRRenderObject> render_object : RenderObjects_)
-	{
-		std::shared_ptr<IVRShadowmapMaterial> sm_mat = render_object->GetShadowmapMaterial();
-		sm_mat->AssignDescriptorSetLayout(DescriptorManager_->CreateDescriptorSetLayout(sm_mat->GetDescriptorSetInfo()));
-	}
+	ShadowmapMaterial_->AssignDescriptorSetLayout(DescriptorManager_->CreateDescriptorSetLayout(ShadowmapMaterial_->GetDescriptorSetInfo()));
 }
 
 std::vector<VkDescriptorPoolSize> IVRWorld::CountShadowMapMaterialPoolSize()
 {
-	std::vector<VkDescriptorPoolSize> pool_sizes;
-
-	for (std::shared_ptr<IVRRenderObject> render_object : RenderObjects_)
-	{
-		std::shared_ptr<IVRShadowmapMaterial> sm_mat = render_object->GetShadowmapMaterial();
-		
-		for (VkDescriptorPoolSize pool_size : sm_mat->GetDescriptorPoolSize())
-		{
-			pool_sizes.push_back(pool_size);
-		}
-	}
-	return pool_sizes;
+	return ShadowmapMaterial_->GetDescriptorPoolSize();
 }
 
 void IVRWorld::CreateShadowMapMaterialDescriptorSets()
 {
 	std::vector<VkDescriptorPoolSize> pool_sizes = CountShadowMapMaterialPoolSize();
 	
-	SMDescriptorManager_->CreateDescriptorPool(pool_sizes, RenderObjects_.size() * SwapchainImageCount_);
+	SMDescriptorManager_->CreateDescriptorPool(pool_sizes, FramesInFlight_);
 	
-	for (std::shared_ptr<IVRRenderObject> render_object : RenderObjects_)
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
 	{
-		std::shared_ptr<IVRShadowmapMaterial> sm_mat = render_object->GetShadowmapMaterial();
-		
-		for (uint32_t i = 0; i < SwapchainImageCount_; i++)
-		{
-			VkDescriptorSet descriptor_set = SMDescriptorManager_->CreateDescriptorSet(sm_mat->GetDescriptorSetLayout());
-			sm_mat->AssignDescriptorSet(descriptor_set);
-		}
+		VkDescriptorSet descriptor_set = SMDescriptorManager_->CreateDescriptorSet(ShadowmapMaterial_->GetDescriptorSetLayout());
+		ShadowmapMaterial_->AssignDescriptorSet(descriptor_set, SMDescriptorManager_);
 	}
 }
 
 void IVRWorld::WriteShadowMapMaterialDescriptorSets()
 {
-	for (std::shared_ptr<IVRRenderObject> render_object : RenderObjects_)
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
 	{
-		std::shared_ptr<IVRShadowmapMaterial> sm_mat = render_object->GetShadowmapMaterial();
-		for (uint32_t i = 0; i < SwapchainImageCount_; i++)
-		{
-			sm_mat->WriteToDescriptorSet(i);
-		}
+		ShadowmapMaterial_->WriteToDescriptorSet(i);
 	}
 }
 
@@ -237,7 +266,7 @@ void IVRWorld::AssignShadowMapDepthTextures(std::vector<std::shared_ptr<IVRDepth
 {
 	std::vector<std::shared_ptr<IVRTextureDepth>> depth_textures;
 
-	for (uint32_t i = 0; i < SwapchainImageCount_; i++)
+	for (uint32_t i = 0; i < FramesInFlight_; i++)
 	{
 		depth_textures.push_back(std::make_shared<IVRTextureDepth>(DeviceManager_, depth_images[i]));
 	}
@@ -1,24 +1,38 @@
 #include "world_loader.h"
 #include "ivr_path.h"
+#include "thread_pool.h"
 
 #include <fstream>
 #include <string>
+#include <map>
 
 
-IVRWorldLoader::IVRWorldLoader(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRLightManager> light_manager, 
-								std::shared_ptr<IVRCamera> camera, uint32_t swapchain_image_count) :
-	DeviceManager_(device_manager), LightManager_(light_manager), SwapchainImageCount_(swapchain_image_count), Camera_(camera)
+IVRWorldLoader::IVRWorldLoader(std::shared_ptr<IVRDeviceManager> device_manager, std::shared_ptr<IVRModelRegistry> model_registry, std::shared_ptr<IVRTextureCache> texture_cache, std::shared_ptr<IVRUniformArena> uniform_arena,
+								std::shared_ptr<IVRMaterialTable> material_table, std::shared_ptr<IVRLightManager> light_manager, std::shared_ptr<IVRCamera> camera,
+								uint32_t frames_in_flight, std::string scene_directory, uint32_t loading_thread_count) :
+	DeviceManager_(device_manager), ModelRegistry_(model_registry), TextureCache_(texture_cache), UniformArena_(uniform_arena), MaterialTable_(material_table), LightManager_(light_manager), FramesInFlight_(frames_in_flight), Camera_(camera), SceneDirectory_(scene_directory),
+	LoadingThreadCount_(loading_thread_count)
 {
 }
 
+std::ifstream IVRWorldLoader::OpenSceneFile(const std::string& file_name)
+{
+	std::string file_path = (std::filesystem::path(SceneDirectory_) / file_name).string();
+	std::ifstream file(file_path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("failed to open scene file : " + file_path);
+	}
+	return file;
+}
+
 IVRWorldLoader::~IVRWorldLoader()
 {
 }
 
 std::vector<std::shared_ptr<IVRBaseMaterial>> IVRWorldLoader::LoadBaseMaterialsFromJson()
 {
-	std::string base_materials_path = IVRPath::GetCrossPlatformPath({ "scene", "base_materials.json" });
-	std::ifstream base_materials_file = std::ifstream(base_materials_path);
+	std::ifstream base_materials_file = OpenSceneFile("base_materials.json");
 	nlohmann::json base_materials_json_data = nlohmann::json::parse(base_materials_file);
 
 	std::vector<std::shared_ptr<IVRBaseMaterial>> base_materials;
@@ -33,9 +47,11 @@ std::vector<std::shared_ptr<IVRBaseMaterial>> IVRWorldLoader::LoadBaseMaterialsF
 		uint32_t texture_count = base_material["texture_count"];
 		std::string default_texture = base_material["default_texture"];
 		bool is_cubemap = name == "cubemap";
+		//the vertex shader has to read the same layout
+		IVRVertexLayout vertex_layout = IVRModel::VertexLayoutFromString(base_material.value("vertex_layout", "full"));
 
 		std::shared_ptr<IVRBaseMaterial> material = std::make_shared<IVRBaseMaterial>(name, vertex_shader_path, fragment_shader_path, default_texture, 
-																						LightManager_->GetLightCount(), texture_count, SwapchainImageCount_, is_cubemap);
+																						LightManager_->GetLightCount(), texture_count, FramesInFlight_, is_cubemap, vertex_layout);
 		base_materials.push_back(material);
 		NameBaseMaterialMap_[name] = material;
 	}
@@ -48,14 +64,92 @@ std::vector<std::shared_ptr<IVRRenderObject>>  IVRWorldLoader::LoadRenderObjects
 {
 	std::vector<std::shared_ptr<IVRRenderObject>> render_objects;
 
-	std::string objects_path = IVRPath::GetCrossPlatformPath({"scene", "objects.json"});
-
-	std::ifstream object_file(objects_path);
+	std::ifstream object_file = OpenSceneFile("objects.json");
 	nlohmann::json objects_json_data = nlohmann::json::parse(object_file);
 
+	//loading runs in two stages :
+	//cpu stage : the models are parsed (or mapped from their mesh cache) and processed, and the textures decoded, on the loading threads
+	//gpu stage : in the order of objects.json, each model is uploaded and its material instance and render object created on this thread
+	//(the caller batches the uploads), so the arenas, the material table and the render object order do not depend on thread timing
+	//every model file (and texture) is prepared once however many objects use it, the objects then share the model
+	std::map<std::pair<std::string, IVRVertexLayout>, std::shared_ptr<IVRModel>> scene_models;
+	std::vector<std::pair<std::string, IVRVertexLayout>> models_to_prepare; //not loaded yet. In order of first use
+	std::unordered_map<std::string, std::shared_ptr<IVRDecodedImage>> decoded_images;
+	std::vector<std::pair<std::string, bool>> texture_paths; //path, is cubemap. Not in the texture cache, in order of first use
+	std::vector<std::shared_ptr<IVRTexture>> scene_textures; //already cached, kept alive until the material instances hold them
+
+	for (uint32_t i = 0; i < objects_json_data.size(); i++)
+	{
+		nlohmann::json& object = objects_json_data[i];
+		if (object["type"] != "3d_model" && object["type"] != "skybox")
+		{
+			continue;
+		}
+
+		std::string model_path = object["model_path"];
+		std::string material_name = object["material"];
+		//the mesh is stored in the vertex layout its material's shaders read
+		std::pair<std::string, IVRVertexLayout> model_key(model_path, NameBaseMaterialMap_[material_name]->GetVertexLayout());
+		if (scene_models.find(model_key) == scene_models.end())
+		{
+			//models some other object already uses are kept alive until the objects of this scene hold them
+			std::shared_ptr<IVRModel> loaded_model = ModelRegistry_->Find(model_key.first, model_key.second);
+			scene_models[model_key] = loaded_model;
+			if (loaded_model == nullptr)
+			{
+				models_to_prepare.push_back(model_key);
+			}
+		}
+
+		bool is_cubemap = material_name == "cubemap";
+		for (const std::string& texture_name : GetTextureNames(object))
+		{
+			std::string texture_path = IVRMaterialInstance::GetTexturePath(texture_name, is_cubemap);
+			//every path is decoded once, objects sharing a texture share it. Textures already in the cache are not decoded at all
+			if (decoded_images.emplace(texture_path, nullptr).second)
+			{
+				std::shared_ptr<IVRTexture> cached_texture = TextureCache_->Find(texture_path, is_cubemap);
+				if (cached_texture != nullptr)
+				{
+					scene_textures.push_back(cached_texture);
+				}
+				else
+				{
+					texture_paths.push_back({ texture_path, is_cubemap });
+				}
+			}
+		}
+	}
+
+	{
+		IVRThreadPool loading_pool(LoadingThreadCount_);
+		IVR_LOG_INFO("Preparing {} models and decoding {} textures on {} loading threads", models_to_prepare.size(), texture_paths.size(), loading_pool.GetThreadCount());
+
+		//every task writes only its own slot (the maps' entries all exist already, so they are not modified)
+		for (const std::pair<std::string, IVRVertexLayout>& model_key : models_to_prepare)
+		{
+			std::shared_ptr<IVRModel>& model = scene_models.at(model_key);
+			loading_pool.Submit([this, &model, model_key](uint32_t) {
+				model = ModelRegistry_->PrepareModel(model_key.first, model_key.second);
+			});
+		}
+
+		for (const std::pair<std::string, bool>& texture_path : texture_paths)
+		{
+			std::shared_ptr<IVRDecodedImage>& decoded_image = decoded_images.at(texture_path.first);
+			loading_pool.Submit([&decoded_image, texture_path](uint32_t) {
+				std::vector<std::string> paths = texture_path.second ? IVRTextureCube::GetFacePaths(texture_path.first) : std::vector<std::string>{ texture_path.first };
+				decoded_image = IVRDecodedImage::Decode(paths);
+			});
+		}
+
+		//rethrows the first failure, the models that were prepared are dropped without having been uploaded
+		loading_pool.Wait();
+	}
+
 	for (uint32_t i = 0; i < objects_json_data.size(); i++)
 	{
-		nlohmann::json object = objects_json_data[i];
+		nlohmann::json& object = objects_json_data[i];
 
 		std::shared_ptr<IVRModel> model;
 		std::shared_ptr<IVRMaterialInstance> material;
@@ -63,23 +157,21 @@ std::vector<std::shared_ptr<IVRRenderObject>>  IVRWorldLoader::LoadRenderObjects
 
 		if (object["type"] == "3d_model" || object["type"] == "skybox")
 		{
-			std::string name = object["name"];
 			std::string model_path = object["model_path"];
-			model = std::make_shared<IVRModel>(DeviceManager_, name, model_path);
-
-			model->SetPosition(glm::vec3(object["transform"]["position"][0], object["transform"]["position"][1], object["transform"]["position"][2]));
-			model->SetRotation(glm::vec3(object["transform"]["rotation"][0], object["transform"]["rotation"][1], object["transform"]["rotation"][2]));
-			model->SetScale(glm::vec3(object["transform"]["scale"][0], object["transform"]["scale"][1], object["transform"]["scale"][2]));
-			
 			std::string material_name = object["material"];
 
-			nlohmann::json material_properties = object["material_properties"];
-			//textures
-			std::vector<std::string> texture_names = material_properties["textures"];
-			if (texture_names.size() == 0)
+			IVRVertexLayout vertex_layout = NameBaseMaterialMap_[material_name]->GetVertexLayout();
+			model = scene_models.at({ model_path, vertex_layout });
+			if (!model->IsUploaded())
 			{
-				texture_names.push_back(NameBaseMaterialMap_[material_name]->GetDefaultTexture());
+				//the first object using a prepared model uploads it, the following ones share it
+				model = ModelRegistry_->Add(model_path, vertex_layout, model);
+				scene_models[{ model_path, vertex_layout }] = model;
 			}
+
+			nlohmann::json material_properties = object["material_properties"];
+			//textures
+			std::vector<std::string> texture_names = GetTextureNames(object);
 			//material properties
 			MaterialPropertiesUBObj material_properties_ubobj;
 
@@ -96,12 +188,15 @@ std::vector<std::shared_ptr<IVRRenderObject>>  IVRWorldLoader::LoadRenderObjects
 				material_properties_ubobj.SpecularPower = material_properties["specular_power"];
 			}
 
-			material = std::make_shared<IVRMaterialInstance>(DeviceManager_, NameBaseMaterialMap_[material_name], texture_names, material_properties_ubobj, SwapchainImageCount_,
-														LightManager_->GetAllLightUBs());
+			material = std::make_shared<IVRMaterialInstance>(DeviceManager_, UniformArena_, MaterialTable_, TextureCache_, NameBaseMaterialMap_[material_name], texture_names, material_properties_ubobj, FramesInFlight_,
+														LightManager_->GetAllLightUBs(), decoded_images);
 			
 
 			if (model != nullptr && material != nullptr) {
-				render_object = std::make_shared<IVRRenderObject>(model, material, Camera_, SwapchainImageCount_);
+				render_object = std::make_shared<IVRRenderObject>(model, material, Camera_, FramesInFlight_);
+				render_object->SetPosition(glm::vec3(object["transform"]["position"][0], object["transform"]["position"][1], object["transform"]["position"][2]));
+				render_object->SetRotation(glm::vec3(object["transform"]["rotation"][0], object["transform"]["rotation"][1], object["transform"]["rotation"][2]));
+				render_object->SetScale(glm::vec3(object["transform"]["scale"][0], object["transform"]["scale"][1], object["transform"]["scale"][2]));
 				render_objects.push_back(render_object);
 			}
 			else {
@@ -121,11 +216,20 @@ std::vector<std::shared_ptr<IVRRenderObject>>  IVRWorldLoader::LoadRenderObjects
 	return render_objects;
 }
 
-std::vector<IVRLight>&& IVRWorldLoader::LoadLightsFromJson()
+std::vector<std::string> IVRWorldLoader::GetTextureNames(nlohmann::json& object)
 {
-	std::string lights_path = IVRPath::GetCrossPlatformPath({ "scene", "lights.json" });
+	std::vector<std::string> texture_names = object["material_properties"]["textures"];
+	if (texture_names.size() == 0)
+	{
+		std::string material_name = object["material"];
+		texture_names.push_back(NameBaseMaterialMap_[material_name]->GetDefaultTexture());
+	}
+	return texture_names;
+}
 
-	std::ifstream lights_file(lights_path);
+std::vector<IVRLight>&& IVRWorldLoader::LoadLightsFromJson()
+{
+	std::ifstream lights_file = OpenSceneFile("lights.json");
 	nlohmann::json lights_json_data = nlohmann::json::parse(lights_file);
 
 	for (uint32_t i = 0; i < lights_json_data.size(); i++)
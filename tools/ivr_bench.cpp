@@ -0,0 +1,278 @@
+//ivr_bench : renders a scene along a scripted camera path for a fixed number of frames and reports frame time statistics as json
+//the camera path and the time step are fixed, so two runs of the same engine version render exactly the same frames
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "json.hpp"
+
+#include "ivr_engine.h"
+#include "world.h"
+#include "camera_path.h"
+
+struct IVRBenchOptions {
+	IVREngineConfig EngineConfig;
+
+	std::string SceneDirectory; //empty means the default scene folder
+	std::string CameraPathFile; //empty means an orbit around the origin
+	std::string OutputFile; //empty means stdout (which the engine also logs to)
+
+	uint32_t FrameCount = 1000;
+	uint32_t WarmupFrameCount = 60; //rendered but left out of the statistics (pipeline caches, driver warmup, ...)
+	float CameraPathLoops = 1.0f; //how many times the camera goes around the path over FrameCount frames
+};
+
+static IVRBenchOptions ParseCommandLine(int argc, char** argv)
+{
+	IVRBenchOptions options;
+	options.EngineConfig.IsHeadless = true;
+	options.EngineConfig.IsProfilingEnabled = true; //gpu times come from the profiler timestamps
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+
+		if (arg == "--windowed")
+		{
+			options.EngineConfig.IsHeadless = false;
+		}
+		else if (arg == "--scene" && has_value)
+		{
+			options.SceneDirectory = argv[++i];
+		}
+		else if (arg == "--camera-path" && has_value)
+		{
+			options.CameraPathFile = argv[++i];
+		}
+		else if (arg == "--output" && has_value)
+		{
+			options.OutputFile = argv[++i];
+		}
+		else if (arg == "--frames" && has_value)
+		{
+			options.FrameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--warmup" && has_value)
+		{
+			options.WarmupFrameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--loops" && has_value)
+		{
+			options.CameraPathLoops = std::stof(argv[++i]);
+		}
+		else if (arg == "--cache-command-buffers")
+		{
+			options.EngineConfig.IsCommandBufferCachingEnabled = true;
+		}
+		else if (arg == "--dynamic-resolution" && has_value)
+		{
+			options.EngineConfig.IsDynamicResolutionEnabled = true;
+			options.EngineConfig.TargetFrameTimeMs = 1000.0f / std::stof(argv[++i]);
+		}
+		else if (arg == "--min-resolution-scale" && has_value)
+		{
+			options.EngineConfig.MinResolutionScale = std::stof(argv[++i]);
+		}
+		else if (arg == "--recording-threads" && has_value)
+		{
+			options.EngineConfig.RecordingThreadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--present-mode" && has_value)
+		{
+			options.EngineConfig.PresentMode = IVRSwapchainManager::PresentModeFromString(argv[++i]);
+		}
+		else if (arg == "--max-queued-frames" && has_value)
+		{
+			options.EngineConfig.MaxQueuedFrames = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--width" && has_value)
+		{
+			options.EngineConfig.Width = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else if (arg == "--height" && has_value)
+		{
+			options.EngineConfig.Height = static_cast<uint32_t>(std::stoul(argv[++i]));
+		}
+		else
+		{
+			throw std::runtime_error("unknown or incomplete command line argument : " + arg +
+				"\nusage : ivr_bench [--scene <dir>] [--camera-path <file.json>] [--frames <count>] [--warmup <count>] [--loops <count>]"
+				" [--width <px>] [--height <px>] [--recording-threads <count>] [--cache-command-buffers] [--dynamic-resolution <target fps>] [--min-resolution-scale <scale>]"
+				" [--present-mode immediate|mailbox|fifo|fifo-relaxed] [--max-queued-frames <count>] [--windowed] [--output <file.json>]");
+		}
+	}
+
+	if (options.FrameCount == 0)
+	{
+		throw std::runtime_error("--frames must be at least 1");
+	}
+
+	return options;
+}
+
+//mean and nearest rank percentiles
+static nlohmann::json ComputeStats(std::vector<double> values)
+{
+	nlohmann::json stats;
+	stats["samples"] = values.size();
+	if (values.empty())
+	{
+		return stats;
+	}
+
+	std::sort(values.begin(), values.end());
+
+	double sum = 0.0;
+	for (double value : values)
+	{
+		sum += value;
+	}
+
+	auto percentile = [&values](double p) {
+		size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+		return values[std::min(std::max(rank, (size_t)1), values.size()) - 1];
+	};
+
+	stats["mean"] = sum / values.size();
+	stats["min"] = values.front();
+	stats["p50"] = percentile(50.0);
+	stats["p95"] = percentile(95.0);
+	stats["p99"] = percentile(99.0);
+	stats["max"] = values.back();
+	return stats;
+}
+
+int main(int argc, char** argv)
+{
+	IVRBenchOptions options = ParseCommandLine(argc, argv);
+
+	std::shared_ptr<IVREngine> engine = std::make_shared<IVREngine>(options.EngineConfig);
+	std::shared_ptr<IVRWorld> world = std::make_shared<IVRWorld>(engine->GetDeviceManager(), engine->GetMaxFramesInFlight(), options.SceneDirectory);
+	world->Init();
+	engine->SetWorld(world);
+	engine->PostWorldInit();
+
+	IVRCameraPath camera_path = options.CameraPathFile.empty() ?
+		IVRCameraPath::CreateOrbit(glm::vec3(0.0f), 8.0f, 3.0f, 8) : IVRCameraPath::LoadFromJson(options.CameraPathFile);
+	world->GetCamera()->IsInputEnabled = false;
+
+	//a fixed time step keeps world updates independent of how fast the frames are rendered
+	const float fixed_dt = 1.0f / 60.0f;
+
+	std::vector<double> frame_times_ms; //wall time of the whole frame, including waiting for the gpu
+	std::vector<double> cpu_times_ms; //world update, recording and submission, without waiting for the gpu
+	std::vector<double> draw_call_counts;
+	std::vector<double> input_to_submit_ms; //from setting the camera of a frame to submitting it
+
+	uint32_t total_frames = options.WarmupFrameCount + options.FrameCount;
+	std::chrono::high_resolution_clock::time_point previous_frame_end = std::chrono::high_resolution_clock::now();
+
+	for (uint32_t frame = 0; frame < total_frames; frame++)
+	{
+		if (!engine->IsHeadless())
+		{
+			if (glfwWindowShouldClose(engine->GetWindow()->GetGLFWWindow()))
+			{
+				IVR_LOG_WARNING("Window was closed after {} frames, the results only cover the frames rendered so far", frame);
+				break;
+			}
+			glfwPollEvents();
+		}
+
+		engine->QueryForSwapchainIndex();
+		std::chrono::high_resolution_clock::time_point cpu_start = std::chrono::high_resolution_clock::now();
+
+		//same order as the app : record, then sample the "input" (the camera path) right before the update and submission
+		engine->RecordFrame();
+		IVRCameraPathPoint path_point = camera_path.Evaluate(options.CameraPathLoops * frame / total_frames);
+		world->GetCamera()->LookAt(path_point.Position, path_point.Target);
+		engine->MarkInputSampled();
+		world->Update(fixed_dt, engine->GetCurrentFrameIndex());
+		engine->SubmitFrame();
+
+		std::chrono::high_resolution_clock::time_point frame_end = std::chrono::high_resolution_clock::now();
+
+		if (frame >= options.WarmupFrameCount)
+		{
+			frame_times_ms.push_back(std::chrono::duration<double, std::milli>(frame_end - previous_frame_end).count());
+			cpu_times_ms.push_back(std::chrono::duration<double, std::milli>(frame_end - cpu_start).count());
+			draw_call_counts.push_back(engine->GetLastFrameDrawCallCount());
+			input_to_submit_ms.push_back(engine->GetLastInputToSubmitMs());
+		}
+		previous_frame_end = frame_end;
+	}
+
+	vkDeviceWaitIdle(engine->GetDeviceManager()->GetLogicalDevice());
+	engine->GetProfiler()->CollectAllGPUResults();
+
+	//gpu frames are collected in submission order apart from the last few, which are in flight when the loop ends
+	std::vector<double> gpu_times_ms = engine->GetProfiler()->GetGPUFrameTimesMs();
+	gpu_times_ms.erase(gpu_times_ms.begin(), gpu_times_ms.begin() + std::min<size_t>(options.WarmupFrameCount, gpu_times_ms.size()));
+
+	nlohmann::json results;
+	results["scene"] = options.SceneDirectory.empty() ? "default" : options.SceneDirectory;
+	results["camera_path"] = options.CameraPathFile.empty() ? "orbit" : options.CameraPathFile;
+	results["width"] = engine->GetRenderExtent().width;
+	results["height"] = engine->GetRenderExtent().height;
+	results["headless"] = engine->IsHeadless();
+	results["frames_in_flight"] = engine->GetMaxFramesInFlight();
+	results["recording_threads"] = engine->GetRecordingThreadCount();
+	results["present_mode"] = engine->IsHeadless() ? "none" : IVRSwapchainManager::PresentModeToString(engine->GetSwapchainManager()->GetPresentMode());
+	results["max_queued_frames"] = engine->GetMaxQueuedFrames();
+	results["command_buffer_caching"] = options.EngineConfig.IsCommandBufferCachingEnabled;
+	results["final_render_width"] = engine->GetScaledRenderExtent().width;
+	results["final_render_height"] = engine->GetScaledRenderExtent().height;
+	results["warmup_frames"] = options.WarmupFrameCount;
+	results["frame_ms"] = ComputeStats(frame_times_ms);
+	results["cpu_ms"] = ComputeStats(cpu_times_ms);
+	results["gpu_ms"] = ComputeStats(gpu_times_ms);
+	results["draw_calls"] = ComputeStats(draw_call_counts);
+	results["input_to_submit_ms"] = ComputeStats(input_to_submit_ms);
+
+	IVRMemoryStats memory_stats = engine->GetDeviceManager()->GetMemoryAllocator()->GetStats();
+	results["gpu_memory"]["allocations"] = memory_stats.AllocationCount;
+	results["gpu_memory"]["used_mb"] = memory_stats.UsedBytes / (1024.0 * 1024.0);
+	results["gpu_memory"]["blocks"] = memory_stats.BlockCount;
+	results["gpu_memory"]["block_mb"] = memory_stats.BlockBytes / (1024.0 * 1024.0);
+	results["gpu_memory"]["dedicated_allocations"] = memory_stats.DedicatedAllocationCount;
+	results["gpu_memory"]["dedicated_mb"] = memory_stats.DedicatedBytes / (1024.0 * 1024.0);
+	for (size_t i = 0; i < memory_stats.Categories.size(); i++)
+	{
+		nlohmann::json& category = results["gpu_memory"]["categories"][IVRMemoryAllocator::GetCategoryName(static_cast<IVRMemoryCategory>(i))];
+		category["allocations"] = memory_stats.Categories[i].AllocationCount;
+		category["used_mb"] = memory_stats.Categories[i].UsedBytes / (1024.0 * 1024.0);
+		category["peak_mb"] = memory_stats.Categories[i].PeakBytes / (1024.0 * 1024.0);
+	}
+	for (const IVRHeapBudget& heap : engine->GetDeviceManager()->GetMemoryAllocator()->GetHeapBudgets())
+	{
+		results["gpu_memory"]["heaps"].push_back({
+			{ "device_local", heap.IsDeviceLocal },
+			{ "budget_mb", heap.BudgetBytes / (1024.0 * 1024.0) },
+			{ "usage_mb", heap.UsageBytes / (1024.0 * 1024.0) },
+			{ "allocated_mb", heap.AllocatedBytes / (1024.0 * 1024.0) }
+		});
+	}
+
+	if (options.OutputFile.empty())
+	{
+		std::cout << results.dump(4) << std::endl;
+	}
+	else
+	{
+		std::ofstream output_file(options.OutputFile);
+		if (!output_file.is_open())
+		{
+			throw std::runtime_error("failed to open " + options.OutputFile + " for writing");
+		}
+		output_file << results.dump(4) << std::endl;
+		IVR_LOG_INFO("Wrote benchmark results to {}", options.OutputFile);
+	}
+
+	return 0;
+}